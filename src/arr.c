@@ -154,6 +154,8 @@ static inline void _arr_free(struct xxxid_stats_arr *pa,int freeitem) {
 	}
 	if (pa->sor)
 		free(pa->sor);
+	if (pa->act)
+		free(pa->act);
 	free(pa);
 }
 
@@ -166,6 +168,8 @@ inline void arr_free_noitem(struct xxxid_stats_arr *pa) {
 }
 
 inline void arr_sort(struct xxxid_stats_arr *pa,int (*cb)(const void *a,const void *b)) {
+	uint64_t t;
+
 	if (!pa)
 		return;
 	if (pa->sor)
@@ -178,6 +182,8 @@ inline void arr_sort(struct xxxid_stats_arr *pa,int (*cb)(const void *a,const vo
 		return;
 
 	memcpy(pa->sor,pa->arr,pa->length*sizeof *pa->arr);
+	t=prof_start();
 	qsort(pa->sor,pa->length,sizeof *pa->sor,cb);
+	prof_end(PROF_SORT,t);
 }
 
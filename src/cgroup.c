@@ -0,0 +1,306 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// the cgroup v2 paths are interned and the tasks refer to them by id; an id
+// is released only when no exited task or group row can refer to it anymore
+#define CG_HASH 4096 // hash buckets
+#define CG_KEEP (HISTORY_CNT+2) // cycles to keep an unused path
+#define CG_REFRESH 8 // cycles between rereading the cgroup of a known process
+
+struct cg_ent {
+	struct cg_ent *next; // hash chain
+	char *path;
+	uint32_t hash;
+	int id;
+	unsigned long seen; // last cycle with a task in it
+	int ios_ok; // ios_r and ios_w are valid
+	uint64_t ios_r; // io.stat at the last cgroup_iostat
+	uint64_t ios_w;
+	int psi_fd; // io.pressure kept open, -1 before the first use, -2 if missing
+};
+
+static struct cg_ent *cg_hash[CG_HASH];
+static struct cg_ent **cg_ent=NULL; // by id-1
+static int cg_cnt=0;
+static int cg_sz=0;
+static int *cg_free=NULL; // released ids
+static int cg_nfree=0;
+static unsigned long cg_cycle=0;
+static char *cg_root=NULL; // cgroup2 mount point
+static int cg_root_done=0;
+
+static inline uint32_t cg_hashstr(const char *s) {
+	uint32_t h=2166136261U;
+
+	while (*s)
+		h=(h^(uint8_t)*s++)*16777619U;
+	return h;
+}
+
+static inline struct cg_ent *cg_lookup(const char *path,uint32_t h) {
+	struct cg_ent *e;
+
+	for (e=cg_hash[h%CG_HASH];e;e=e->next)
+		if (e->hash==h&&!strcmp(e->path,path))
+			return e;
+	return NULL;
+}
+
+static inline int cg_intern(const char *path) {
+	uint32_t h=cg_hashstr(path);
+	struct cg_ent *e=cg_lookup(path,h);
+	int id;
+
+	if (e)
+		return e->id;
+	if (!cg_nfree&&cg_cnt==cg_sz) {
+		int nsz=cg_sz?cg_sz*2:PROC_LIST_SZ_INC;
+		struct cg_ent **n;
+		int *f;
+
+		n=realloc(cg_ent,nsz*sizeof *n);
+		if (!n)
+			return 0;
+		cg_ent=n;
+		f=realloc(cg_free,nsz*sizeof *f);
+		if (!f)
+			return 0;
+		cg_free=f;
+		cg_sz=nsz;
+	}
+	e=calloc(1,sizeof *e);
+	if (!e)
+		return 0;
+	e->path=strdup(path);
+	if (!e->path) {
+		free(e);
+		return 0;
+	}
+	id=cg_nfree?cg_free[--cg_nfree]:++cg_cnt;
+	e->hash=h;
+	e->id=id;
+	e->psi_fd=-1;
+	e->next=cg_hash[h%CG_HASH];
+	cg_hash[h%CG_HASH]=e;
+	cg_ent[id-1]=e;
+	return id;
+}
+
+static inline void cg_release(struct cg_ent *e) {
+	struct cg_ent **pe;
+
+	for (pe=&cg_hash[e->hash%CG_HASH];*pe;pe=&(*pe)->next)
+		if (*pe==e) {
+			*pe=e->next;
+			break;
+		}
+	cg_ent[e->id-1]=NULL;
+	cg_free[cg_nfree++]=e->id;
+	if (e->psi_fd>=0)
+		close(e->psi_fd);
+	free(e->path);
+	free(e);
+}
+
+// the cgroup v2 line of /proc/<pid>/cgroup is "0::<path>"
+static inline int cg_read(pid_t pid) {
+	char buf[PATH_MAX+64];
+	char path[32];
+	char *l,*e;
+	ssize_t n;
+	int fd;
+
+	snprintf(path,sizeof path,"%d/cgroup",pid);
+	fd=openat(proc_dirfd(),path,O_RDONLY|O_CLOEXEC);
+	if (fd==-1)
+		return 0;
+	n=read(fd,buf,sizeof buf-1);
+	close(fd);
+	if (n<=0)
+		return 0;
+	buf[n]=0;
+	for (l=buf;l&&*l;l=e?e+1:NULL) {
+		e=strchr(l,'\n');
+		if (e)
+			*e=0;
+		if (!strncmp(l,"0::",3))
+			return cg_intern(l+3);
+	}
+	return 0;
+}
+
+static inline struct cg_ent *cg_byid(int id) {
+	if (id<1||id>cg_cnt)
+		return NULL;
+	return cg_ent[id-1];
+}
+
+// each process is looked up once per cycle and its threads follow it; a
+// known process keeps its cgroup and is reread only every CG_REFRESH cycles
+inline void cgroup_resolve(struct xxxid_stats_arr *a,struct xxxid_stats_arr *pt) {
+	struct cg_ent *e;
+	int i;
+
+	cg_cycle++;
+	for (i=0;i<a->length;i++) {
+		struct xxxid_stats *s=a->arr[i];
+		struct xxxid_stats *p;
+
+		if (s->pid!=s->tid&&(p=arr_find(a,s->pid))&&p->cgroup) // main process is already done, it has a lower tid
+			s->cgroup=p->cgroup;
+		else if (s->pid==s->tid&&(p=arr_find(pt,s->tid))&&p->pid==s->pid&&p->cgroup&&cg_byid(p->cgroup)&&(cg_cycle+s->pid)%CG_REFRESH)
+			s->cgroup=p->cgroup;
+		else
+			s->cgroup=cg_read(s->pid);
+		if ((e=cg_byid(s->cgroup)))
+			e->seen=cg_cycle;
+	}
+	for (i=0;i<cg_cnt;i++)
+		if ((e=cg_ent[i])&&cg_cycle-e->seen>CG_KEEP)
+			cg_release(e);
+}
+
+inline int cgroup_find(const char *path) {
+	struct cg_ent *e=cg_lookup(path,cg_hashstr(path));
+
+	return e?e->id:0;
+}
+
+inline const char *cgroup_path(int id) {
+	struct cg_ent *e=cg_byid(id);
+
+	return e?e->path:"?";
+}
+
+static inline const char *cg_mount(void) {
+	char *l=NULL;
+	size_t sz=0;
+	FILE *f;
+
+	if (cg_root_done)
+		return cg_root;
+	cg_root_done=1;
+	f=fopen("/proc/self/mountinfo","r");
+	if (!f)
+		return NULL;
+	while (getline(&l,&sz,f)>0) {
+		char mp[PATH_MAX];
+		char *t=strstr(l," - ");
+
+		if (!t||strncmp(t," - cgroup2 ",11))
+			continue;
+		if (sscanf(l,"%*s %*s %*s %*s %4095s",mp)==1) {
+			cg_root=strdup(mp);
+			break;
+		}
+	}
+	free(l);
+	fclose(f);
+	return cg_root;
+}
+
+// bytes read and written by the cgroup since the previous call, as charged
+// by the kernel; it includes the exited tasks and the writeback
+inline int cgroup_iostat(int id,uint64_t *rbytes,uint64_t *wbytes) {
+	struct cg_ent *e=cg_byid(id);
+	const char *root=cg_mount();
+	char path[PATH_MAX];
+	uint64_t r=0,w=0;
+	char buf[8192];
+	char *l,*t;
+	ssize_t n;
+	int fd;
+
+	if (!e||!root)
+		return -1;
+	if (snprintf(path,sizeof path,"%s%s/io.stat",root,e->path)>=(int)sizeof path)
+		return -1;
+	fd=open(path,O_RDONLY|O_CLOEXEC);
+	if (fd==-1)
+		return -1;
+	n=read(fd,buf,sizeof buf-1);
+	close(fd);
+	if (n<0)
+		return -1;
+	buf[n]=0;
+	// MAJ:MIN rbytes=N wbytes=N rios=N wios=N dbytes=N dios=N
+	for (l=buf;*l;l=t) {
+		char *v;
+
+		t=strchr(l,'\n');
+		if (t)
+			*t++=0;
+		else
+			t=l+strlen(l);
+		if ((v=strstr(l," rbytes=")))
+			r+=strtoull(v+8,NULL,10);
+		if ((v=strstr(l," wbytes=")))
+			w+=strtoull(v+8,NULL,10);
+	}
+	*rbytes=e->ios_ok&&r>=e->ios_r?r-e->ios_r:0;
+	*wbytes=e->ios_ok&&w>=e->ios_w?w-e->ios_w:0;
+	e->ios_ok=1;
+	e->ios_r=r;
+	e->ios_w=w;
+	return 0;
+}
+
+// total us of io.pressure some stall of the cgroup
+inline int cgroup_psi(int id,uint64_t *some_t) {
+	struct cg_ent *e=cg_byid(id);
+	const char *root=cg_mount();
+	double some10,full10;
+	char path[PATH_MAX];
+	uint64_t full_t;
+	char buf[256];
+
+	if (!e||!root||e->psi_fd==-2)
+		return -1;
+	if (e->psi_fd==-1) {
+		if (snprintf(path,sizeof path,"%s%s/io.pressure",root,e->path)>=(int)sizeof path)
+			return -1;
+		e->psi_fd=open(path,O_RDONLY|O_CLOEXEC);
+		if (e->psi_fd==-1) {
+			e->psi_fd=-2;
+			return -1;
+		}
+	}
+	if (psi_read(e->psi_fd,buf,sizeof buf))
+		return -1;
+	return psi_parse(buf,&some10,&full10,some_t,&full_t);
+}
+
+inline void cgroup_fini(void) {
+	int i;
+
+	for (i=0;i<cg_cnt;i++)
+		if (cg_ent[i])
+			cg_release(cg_ent[i]);
+	free(cg_ent);
+	free(cg_free);
+	free(cg_root);
+	cg_ent=NULL;
+	cg_free=NULL;
+	cg_root=NULL;
+	cg_cnt=cg_sz=cg_nfree=0;
+	cg_root_done=0;
+}
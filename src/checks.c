@@ -42,7 +42,10 @@ inline int system_checks(void) {
 			if (cap[CAP_TO_INDEX(CAP_NET_ADMIN)].effective&CAP_TO_MASK(CAP_NET_ADMIN))
 				root_or_netadm=1;
 	}
-	if (!root_or_netadm) {
+	// without privileges netlink is not usable, use /proc/<pid>/io instead
+	if (!root_or_netadm&&params.collector==E_COL_AUTO)
+		params.collector=E_COL_PROCIO;
+	if (!root_or_netadm&&params.collector==E_COL_NETLINK) {
 		printf(
 			"The Linux kernel interfaces that iotop relies on now require root privileges\n"
 			"or the NET_ADMIN capability. This change occurred because a security issue\n"
@@ -57,7 +60,10 @@ inline int system_checks(void) {
 			"Be warned that this will also allow other users to run it and get access to\n"
 			"information that normally should not be available to them.\n"
 			"\n"
-			"Please do not file bugs on iotop about this.\n");
+			"Please do not file bugs on iotop about this.\n"
+			"\n"
+			"Running with --collector=procio shows the I/O of the own processes only\n"
+			"and does not require privileges.\n");
 
 		return EACCES;
 	}
@@ -195,6 +195,7 @@ inline int config_file_save(void) {
 	if (config.f.kilobytes)
 		fprintf(cf,"--kilobytes\n");
 	// --timestamp is ignored
+	// --format is ignored
 	// --quiet is ignored
 	// --fullcmdline
 	if (config.f.fullcmdline)
@@ -226,6 +227,30 @@ inline int config_file_save(void) {
 	// --hide-command
 	if (config.f.hidecmd)
 		fprintf(cf,"--hide-command\n");
+	// --net-write
+	if (config.f.netwrite)
+		fprintf(cf,"--net-write\n");
+	// --logical
+	if (config.f.logical)
+		fprintf(cf,"--logical\n");
+	// --delays
+	if (config.f.delays)
+		fprintf(cf,"--delays\n");
+	// --devices
+	if (config.f.devices)
+		fprintf(cf,"--devices\n");
+	// --psi
+	if (config.f.psi)
+		fprintf(cf,"--psi\n");
+	// --offenders
+	if (config.f.offenders)
+		fprintf(cf,"--offenders=%s\n",hitters_key_name());
+	// --percentiles
+	if (config.f.pctl)
+		fprintf(cf,"--percentiles=%d\n",config.f.pctl);
+	// --trigger is ignored
+	// --ring is ignored
+	// --burst is ignored
 	// --dead-x
 	if (config.f.deadx)
 		fprintf(cf,"--dead-x\n");
@@ -249,6 +274,20 @@ inline int config_file_save(void) {
 		fprintf(cf,"--grtype=rw\n");
 	if (config.f.grtype==E_GR_SW)
 		fprintf(cf,"--grtype=sw\n");
+	if (config.f.grtype==E_GR_NW)
+		fprintf(cf,"--grtype=nw\n");
+	if (config.f.grtype==E_GR_CPU)
+		fprintf(cf,"--grtype=cpu\n");
+	if (config.f.grtype==E_GR_MEM)
+		fprintf(cf,"--grtype=mem\n");
+	if (config.f.grtype==E_GR_THRASH)
+		fprintf(cf,"--grtype=thrash\n");
+	if (config.f.grtype==E_GR_COMPACT)
+		fprintf(cf,"--grtype=compact\n");
+	if (config.f.grtype==E_GR_WPCOPY)
+		fprintf(cf,"--grtype=wpcopy\n");
+	if (config.f.grtype==E_GR_IRQ)
+		fprintf(cf,"--grtype=irq\n");
 	// --si
 	if (config.f.base==1000)
 		fprintf(cf,"--si\n");
@@ -263,6 +302,33 @@ inline int config_file_save(void) {
 	// --inverse
 	if (config.f.inverse)
 		fprintf(cf,"--inverse\n");
+	// --sampling
+	if (config.f.sampling)
+		fprintf(cf,"--sampling\n");
+	// --collector
+	if (params.collector==E_COL_NETLINK)
+		fprintf(cf,"--collector=netlink\n");
+	if (params.collector==E_COL_PROCIO)
+		fprintf(cf,"--collector=procio\n");
+	// --collector-bench is ignored
+	// --record is ignored
+	// --replay is ignored
+	// --replay-from is ignored
+	// --export is ignored
+	// --export-top is ignored
+	// --daemon is ignored
+	// --attach is ignored
+	// --group
+	if (params.group==E_GRP_CGROUP)
+		fprintf(cf,"--group=cgroup\n");
+	if (params.group==E_GRP_USER)
+		fprintf(cf,"--group=user\n");
+	// --cgroup is ignored
+	// --cgroup-iostat
+	if (params.cgroup_iostat)
+		fprintf(cf,"--cgroup-iostat\n");
+	// --profile is ignored
+	// --bench is ignored
 	if (params.search_regx_ok&&params.search_str&&strlen(params.search_str))
 		fprintf(cf,"--filter=%s\n",params.search_str);
 
@@ -0,0 +1,219 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BSIZ 4096
+#define SECTOR 512 // diskstats counts 512 byte sectors regardless of the device
+
+// /proc/diskstats counters after major, minor and name
+enum {
+	DS_RD_IOS,
+	DS_RD_MERGES,
+	DS_RD_SECTORS,
+	DS_RD_TICKS, // ms
+	DS_WR_IOS,
+	DS_WR_MERGES,
+	DS_WR_SECTORS,
+	DS_WR_TICKS, // ms
+	DS_IN_FLIGHT,
+	DS_IO_TICKS, // ms with at least one request in flight
+	DS_TIME_IN_QUEUE, // ms weighted by the requests in flight
+	DS_MAX
+};
+
+struct ds_dev {
+	struct dev_stats s;
+	int major;
+	int minor;
+	int whole; // a disk in /sys/block, partitions are not shown
+	int seen; // present in the last read
+	int have_c; // c holds the counters of a previous read
+	uint64_t c[DS_MAX];
+};
+
+static struct ds_dev *ds_dev=NULL;
+static int ds_cnt=0;
+static int ds_sz=0;
+static int ds_fd=-1; // kept open, reread from the start on each update
+static char *ds_buf=NULL; // reused between the updates
+static ssize_t ds_bs=0;
+static int64_t ds_ts=0; // monotime of the last read
+
+static inline struct ds_dev *ds_find(int major,int minor,const char *name) {
+	char path[64];
+	struct ds_dev *d;
+	int i;
+
+	for (i=0;i<ds_cnt;i++)
+		if (ds_dev[i].major==major&&ds_dev[i].minor==minor&&!strcmp(ds_dev[i].s.name,name))
+			return ds_dev+i;
+	if (ds_cnt==ds_sz) {
+		int nsz=ds_sz?ds_sz*2:16;
+
+		d=realloc(ds_dev,nsz*sizeof *d);
+		if (!d)
+			return NULL;
+		ds_dev=d;
+		ds_sz=nsz;
+	}
+	d=ds_dev+ds_cnt++;
+	memset(d,0,sizeof *d);
+	d->major=major;
+	d->minor=minor;
+	snprintf(d->s.name,sizeof d->s.name,"%s",name);
+	snprintf(path,sizeof path,"/sys/block/%s",name);
+	d->whole=!access(path,F_OK); // a symlink to the device
+	return d;
+}
+
+static inline double ds_delta(uint64_t c,uint64_t p) {
+	return c>=p?c-p:0;
+}
+
+static inline void ds_rates(struct ds_dev *d,const uint64_t *c,double time_s) {
+	struct dev_stats *s=&d->s;
+	double ios;
+
+	memmove(s->hist+1,s->hist,sizeof s->hist-sizeof *s->hist);
+	if (!d->have_c) {
+		s->read=s->write=s->rio=s->wio=s->aqu=s->util=s->await=0;
+		s->hist[0]=0;
+		return;
+	}
+	s->read=ds_delta(c[DS_RD_SECTORS],d->c[DS_RD_SECTORS])*SECTOR/time_s;
+	s->write=ds_delta(c[DS_WR_SECTORS],d->c[DS_WR_SECTORS])*SECTOR/time_s;
+	s->rio=ds_delta(c[DS_RD_IOS],d->c[DS_RD_IOS])/time_s;
+	s->wio=ds_delta(c[DS_WR_IOS],d->c[DS_WR_IOS])/time_s;
+	s->aqu=ds_delta(c[DS_TIME_IN_QUEUE],d->c[DS_TIME_IN_QUEUE])/(time_s*1000.0);
+	s->util=ds_delta(c[DS_IO_TICKS],d->c[DS_IO_TICKS])/(time_s*10.0);
+	if (s->util>100)
+		s->util=100;
+	ios=ds_delta(c[DS_RD_IOS],d->c[DS_RD_IOS])+ds_delta(c[DS_WR_IOS],d->c[DS_WR_IOS]);
+	s->await=ios?(ds_delta(c[DS_RD_TICKS],d->c[DS_RD_TICKS])+ds_delta(c[DS_WR_TICKS],d->c[DS_WR_TICKS]))/ios:0;
+	s->hist[0]=s->read+s->write;
+}
+
+// read /proc/diskstats and compute the rates since the previous call
+inline int diskstats_update(void) {
+	int64_t now=monotime();
+	double time_s;
+	ssize_t bp=0;
+	char *l,*e;
+	int i,n;
+
+	if (replaying()) // the devices are not recorded
+		return -1;
+	if (ds_fd==-1)
+		ds_fd=open("/proc/diskstats",O_RDONLY|O_CLOEXEC);
+	if (ds_fd==-1)
+		return -1;
+	for (;;) {
+		ssize_t r;
+
+		if (bp==ds_bs) {
+			char *t=realloc(ds_buf,ds_bs+BSIZ+1);
+
+			if (!t)
+				return -1;
+			ds_buf=t;
+			ds_bs+=BSIZ;
+		}
+		r=pread(ds_fd,ds_buf+bp,ds_bs-bp,bp);
+		if (r<0)
+			return -1;
+		if (!r)
+			break;
+		bp+=r;
+	}
+	ds_buf[bp]=0;
+
+	time_s=timediff_in_s(ds_ts,now);
+	ds_ts=now;
+	for (i=0;i<ds_cnt;i++)
+		ds_dev[i].seen=0;
+	for (l=ds_buf;*l;l=e) {
+		uint64_t c[DS_MAX]={0};
+		int major,minor;
+		struct ds_dev *d;
+		char name[32];
+
+		e=strchr(l,'\n');
+		if (e)
+			*e++=0;
+		else
+			e=l+strlen(l);
+		if (sscanf(l,"%d %d %31s %n",&major,&minor,name,&n)<3)
+			continue;
+		// the fields after time_in_queue (discard and flush) are not used
+		for (l+=n,i=0;i<DS_MAX&&*l;i++)
+			c[i]=strtoull(l,&l,10);
+		if (i<DS_MAX)
+			continue;
+		d=ds_find(major,minor,name);
+		if (!d)
+			continue;
+		d->seen=1;
+		ds_rates(d,c,time_s);
+		memcpy(d->c,c,sizeof d->c);
+		d->have_c=1;
+	}
+	// drop the removed devices
+	for (i=n=0;i<ds_cnt;i++)
+		if (ds_dev[i].seen)
+			ds_dev[n++]=ds_dev[i];
+	ds_cnt=n;
+	return 0;
+}
+
+// only the disks that have done any I/O are shown
+static inline int ds_shown(struct ds_dev *d) {
+	return d->whole&&d->have_c&&(d->c[DS_RD_IOS]||d->c[DS_WR_IOS]);
+}
+
+inline int diskstats_count(void) {
+	int i,n=0;
+
+	for (i=0;i<ds_cnt;i++)
+		if (ds_shown(ds_dev+i))
+			n++;
+	return n;
+}
+
+inline struct dev_stats *diskstats_get(int idx) {
+	int i;
+
+	for (i=0;i<ds_cnt;i++)
+		if (ds_shown(ds_dev+i)&&!idx--)
+			return &ds_dev[i].s;
+	return NULL;
+}
+
+inline void diskstats_fini(void) {
+	if (ds_fd!=-1)
+		close(ds_fd);
+	ds_fd=-1;
+	free(ds_buf);
+	ds_buf=NULL;
+	ds_bs=0;
+	free(ds_dev);
+	ds_dev=NULL;
+	ds_cnt=ds_sz=0;
+	ds_ts=0;
+}
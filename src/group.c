@@ -0,0 +1,272 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// a group row stands for all the tasks of a group; its counters are the
+// counters of the previous row of the group plus the deltas of the member
+// tasks, so they never go back when tasks exit and create_diff computes the
+// rates and the history of the row as for any task
+
+struct gd_ent {
+	struct xxxid_stats *g;
+	int iostat; // DISK READ and WRITE come from io.stat
+};
+
+static struct gd_ent *gd_tab=NULL; // open addressing by group id
+static int gd_sz=0;
+static int gd_cnt=0;
+
+static inline int gd_key(e_group group,struct xxxid_stats *s) {
+	switch (group) {
+		case E_GRP_NONE:
+			break;
+		case E_GRP_CGROUP:
+			return s->cgroup;
+		case E_GRP_USER:
+			return s->euid;
+	}
+	return 0;
+}
+
+static inline int gd_grow(void) {
+	struct gd_ent *o=gd_tab;
+	int osz=gd_sz;
+	int i;
+
+	gd_sz=gd_sz?gd_sz*2:PROC_LIST_SZ_INC;
+	gd_tab=calloc(gd_sz,sizeof *gd_tab);
+	if (!gd_tab) {
+		gd_tab=o;
+		gd_sz=osz;
+		return -1;
+	}
+	for (i=0;i<osz;i++)
+		if (o[i].g) {
+			unsigned h=(unsigned)o[i].g->tid*2654435761U;
+
+			while (gd_tab[h&(gd_sz-1)].g)
+				h++;
+			gd_tab[h&(gd_sz-1)]=o[i];
+		}
+	free(o);
+	return 0;
+}
+
+static inline struct gd_ent *gd_find(int key) {
+	unsigned h=(unsigned)key*2654435761U;
+
+	for (;;h++) {
+		struct gd_ent *e=gd_tab+(h&(gd_sz-1));
+
+		if (!e->g||e->g->tid==key)
+			return e;
+	}
+}
+
+static inline uint64_t gd_delta(uint64_t c,uint64_t p) {
+	return c>=p?c-p:0; // counters never go back unless the tid is reused
+}
+
+// the row of a new group continues the counters of its previous row
+static inline struct xxxid_stats *gd_new(const struct fetch_ctx *f,int key,struct xxxid_stats *t,struct xxxid_stats_arr *ps,int *iostat) {
+	struct xxxid_stats *g=calloc(1,sizeof *g);
+	struct xxxid_stats *o;
+	const char *name="?";
+
+	if (!g)
+		return NULL;
+	o=arr_find(ps,key);
+	if (o&&o->group==f->group) {
+		g->read_bytes=o->read_bytes;
+		g->write_bytes=o->write_bytes;
+		g->cancelled_write_bytes=o->cancelled_write_bytes;
+		g->read_char=o->read_char;
+		g->write_char=o->write_char;
+		g->read_syscalls=o->read_syscalls;
+		g->write_syscalls=o->write_syscalls;
+		g->swapin_delay_total=o->swapin_delay_total;
+		g->blkio_delay_total=o->blkio_delay_total;
+		memcpy(g->delay_total,o->delay_total,sizeof g->delay_total);
+	}
+	g->pid=g->tid=key;
+	g->group=f->group;
+	g->euid=t->euid;
+	g->io_prio=t->io_prio;
+	g->error_i=t->error_i;
+	g->cgroup=t->cgroup;
+	switch (f->group) {
+		case E_GRP_NONE:
+			break;
+		case E_GRP_CGROUP: {
+			uint64_t r,w;
+
+			name=cgroup_path(key);
+			if (f->psi)
+				cgroup_psi(key,&g->psi_total);
+			*iostat=f->cgroup_iostat&&!cgroup_iostat(key,&r,&w);
+			if (*iostat) {
+				g->read_bytes+=r;
+				g->write_bytes+=w;
+			}
+			break;
+		}
+		case E_GRP_USER:
+			if (t->pw_name)
+				name=t->pw_name;
+			break;
+	}
+	g->cmdline_long=strdup(name);
+	g->cmdline_short=strdup(name);
+	g->pw_name=strdup(t->pw_name?t->pw_name:"?");
+	if (!g->cmdline_long||!g->cmdline_short||!g->pw_name) {
+		free_stats(g);
+		return NULL;
+	}
+	return g;
+}
+
+static inline int gd_cmp(const void *a,const void *b) {
+	const struct xxxid_stats *pa=*(struct xxxid_stats * const *)a;
+	const struct xxxid_stats *pb=*(struct xxxid_stats * const *)b;
+
+	return pa->tid<pb->tid?-1:pa->tid>pb->tid;
+}
+
+// one pass over the tasks; a is the current and pt the previous task list,
+// ps are the previous group rows
+inline struct xxxid_stats_arr *group_data(const struct fetch_ctx *f,struct xxxid_stats_arr *a,struct xxxid_stats_arr *pt,struct xxxid_stats_arr *ps) {
+	struct xxxid_stats_arr *ga=arr_alloc();
+	struct xxxid_stats **rows;
+	int i,j,n=0;
+
+	if (!ga)
+		return NULL;
+	if (gd_tab)
+		memset(gd_tab,0,gd_sz*sizeof *gd_tab);
+	gd_cnt=0;
+
+	for (i=0;i<a->length;i++) {
+		struct xxxid_stats *t=a->arr[i];
+		struct xxxid_stats *p,*g;
+		struct gd_ent *e;
+		int key;
+
+		if (filter1(t))
+			continue;
+		key=gd_key(f->group,t);
+		if ((gd_cnt+1)*2>gd_sz&&gd_grow())
+			break;
+		e=gd_find(key);
+		if (!e->g) {
+			e->g=gd_new(f,key,t,ps,&e->iostat);
+			if (!e->g)
+				continue;
+			gd_cnt++;
+		}
+		g=e->g;
+		g->tasks++;
+		if (t->pid==t->tid)
+			g->procs++;
+		if (g->euid!=t->euid&&g->euid!=-1) { // mixed users
+			g->euid=-1;
+			free(g->pw_name);
+			g->pw_name=strdup("*");
+		}
+
+		p=arr_find(pt,t->tid);
+		if (!p||p->pid!=t->pid||p->error_x||t->error_x) // new tasks start from zero as in create_diff
+			continue;
+		if (!e->iostat) {
+			g->read_bytes+=gd_delta(t->read_bytes,p->read_bytes);
+			g->write_bytes+=gd_delta(t->write_bytes,p->write_bytes);
+		}
+		g->cancelled_write_bytes+=gd_delta(t->cancelled_write_bytes,p->cancelled_write_bytes);
+		g->read_char+=gd_delta(t->read_char,p->read_char);
+		g->write_char+=gd_delta(t->write_char,p->write_char);
+		g->read_syscalls+=gd_delta(t->read_syscalls,p->read_syscalls);
+		g->write_syscalls+=gd_delta(t->write_syscalls,p->write_syscalls);
+		// the delays of a group are the ones of its most delayed task, the
+		// _p fields collect the maximums until the end of the pass
+		g->swapin_delay_total_p=mymax(g->swapin_delay_total_p,gd_delta(t->swapin_delay_total,p->swapin_delay_total));
+		g->blkio_delay_total_p=mymax(g->blkio_delay_total_p,gd_delta(t->blkio_delay_total,p->blkio_delay_total));
+		for (j=0;j<DLY_MAX;j++)
+			g->delay_total_p[j]=mymax(g->delay_total_p[j],gd_delta(t->delay_total[j],p->delay_total[j]));
+	}
+
+	rows=gd_cnt?malloc(gd_cnt*sizeof *rows):NULL;
+	for (i=0;i<gd_sz;i++) {
+		struct xxxid_stats *g=gd_tab[i].g;
+
+		if (!g)
+			continue;
+		g->swapin_delay_total+=g->swapin_delay_total_p;
+		g->blkio_delay_total+=g->blkio_delay_total_p;
+		for (j=0;j<DLY_MAX;j++)
+			g->delay_total[j]+=g->delay_total_p[j];
+		// group rows have no threads, both views show the same values
+		g->swapin_delay_total_p=g->swapin_delay_total;
+		g->blkio_delay_total_p=g->blkio_delay_total;
+		g->read_bytes_p=g->read_bytes;
+		g->write_bytes_p=g->write_bytes;
+		g->cancelled_write_bytes_p=g->cancelled_write_bytes;
+		memcpy(g->delay_total_p,g->delay_total,sizeof g->delay_total_p);
+		for (j=0;j<LIO_MAX;j++)
+			g->lio_p[j]=lio_counter(g,j);
+		if (rows)
+			rows[n++]=g;
+		else
+			free_stats(g);
+	}
+	// adding in order of the ids appends at the end of the array
+	if (rows) {
+		qsort(rows,n,sizeof *rows,gd_cmp);
+		for (i=0;i<n;i++)
+			if (arr_add(ga,rows[i]))
+				free_stats(rows[i]);
+		free(rows);
+	}
+	return ga;
+}
+
+inline const char *group_name(void) {
+	switch (params.group) {
+		case E_GRP_NONE:
+			break;
+		case E_GRP_CGROUP:
+			return "cgroup";
+		case E_GRP_USER:
+			return "user";
+	}
+	return "task";
+}
+
+// leave the group view and show the tasks of a group row
+inline void group_drill(struct xxxid_stats *g) {
+	switch (g->group) {
+		case E_GRP_NONE:
+			return;
+		case E_GRP_CGROUP:
+			if (params.cgroup)
+				free(params.cgroup);
+			params.cgroup=strdup(g->cmdline_long);
+			break;
+		case E_GRP_USER:
+			params.user_id=g->euid;
+			break;
+	}
+	params.group=E_GRP_NONE;
+}
@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+// --percentiles: the values of each interval of a task in log buckets, each
+// power of two is split in HG_SUB buckets (HDR histogram style), so that a
+// percentile is off by less than 1/HG_SUB/2 of its value; the values below
+// HG_SUB have a bucket each
+
+#include "iotop.h"
+
+#include <stdlib.h>
+
+#define HG_SUB 8
+#define HG_MAXV ((1ULL<<41)-1) // 2 TiB/s, the last bucket takes all above
+#define HG_BUCKETS (HG_SUB*39) // the bucket of HG_MAXV is the last one
+#define HG_PCT_SCALE 100 // delays are kept in 1/100 of a percent
+
+struct histo {
+	uint32_t n; // intervals
+	uint32_t cnt[HG_MAX][HG_BUCKETS];
+};
+
+static inline int hg_idx(double v) {
+	uint64_t x;
+	int s;
+
+	if (v<0.5)
+		return 0;
+	x=v>=(double)HG_MAXV?HG_MAXV:(uint64_t)(v+0.5);
+	for (s=0;x>>s>=2*HG_SUB;s++)
+		;
+	return s*HG_SUB+(int)(x>>s);
+}
+
+// the middle of the bucket
+static inline double hg_value(int i) {
+	uint64_t lo,w;
+
+	if (i<2*HG_SUB)
+		return i;
+	lo=(uint64_t)(HG_SUB+i%HG_SUB)<<(i/HG_SUB-1);
+	w=1ULL<<(i/HG_SUB-1);
+	return lo+(w-1)/2.0;
+}
+
+// one interval of a task; nothing is allocated until the task does I/O
+inline void histo_add(struct histo **ph,double read,double write,double blkio) {
+	struct histo *h=*ph;
+
+	if (!h) {
+		if (read<0.5&&write<0.5&&blkio*HG_PCT_SCALE<0.5)
+			return;
+		h=calloc(1,sizeof *h);
+		if (!h)
+			return;
+		*ph=h;
+	}
+	h->n++;
+	h->cnt[HG_READ][hg_idx(read)]++;
+	h->cnt[HG_WRITE][hg_idx(write)]++;
+	h->cnt[HG_BLKIO][hg_idx(blkio*HG_PCT_SCALE)]++;
+}
+
+// the value under which pct percent of the intervals are
+inline double histo_pct(const struct histo *h,int v,int pct) {
+	uint64_t rank,sum=0;
+	int i;
+
+	if (!h||!h->n||v<0||v>=HG_MAX)
+		return 0;
+	rank=((uint64_t)h->n*pct+99)/100;
+	if (!rank)
+		rank=1;
+	for (i=0;i<HG_BUCKETS;i++) {
+		sum+=h->cnt[v][i];
+		if (sum>=rank)
+			break;
+	}
+	if (i==HG_BUCKETS)
+		i--;
+	return v==HG_BLKIO?hg_value(i)/HG_PCT_SCALE:hg_value(i);
+}
+
+inline unsigned histo_count(const struct histo *h) {
+	return h?h->n:0;
+}
@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+// the I/O of the exited tasks summed per command, user or cgroup in a fixed
+// number of counters (Space-Saving): a key that has no counter takes the one
+// with the smallest count and inherits that count as its possible error, so
+// any key with more than 1/HH_SLOTS of all bytes is always kept and no count
+// is off by more than its err
+
+#include "iotop.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HH_SLOTS 64
+
+static struct hh_stats hh[HH_SLOTS];
+static uint32_t hh_hash[HH_SLOTS];
+static int hh_ord[HH_SLOTS]; // hh by bytes, biggest first
+static int hh_cnt=0;
+static int hh_dirty=0; // hh_ord needs a sort
+static struct hh_stats hh_all; // all exited tasks, bytes is exact here
+
+static inline uint32_t hh_fnv(const char *s) {
+	uint32_t h=2166136261u;
+
+	while (*s)
+		h=(h^(unsigned char)*s++)*16777619u;
+	return h;
+}
+
+static inline const char *hh_key(const struct xxxid_stats *s) {
+	const char *k;
+
+	switch (params.hh_key) {
+		default:
+		case E_HH_CMD:
+			k=s->cmdline_short;
+			break;
+		case E_HH_USER:
+			k=s->pw_name;
+			break;
+		case E_HH_CGROUP:
+			k=s->cgroup?cgroup_path(s->cgroup):NULL;
+			break;
+	}
+	return k&&*k?k:"?";
+}
+
+// a task is gone, its counters are the total of its life
+inline void hitters_exit(const struct xxxid_stats *s) {
+	uint64_t r=s->read_bytes;
+	uint64_t w=s->write_bytes;
+	const char *k;
+	uint32_t h;
+	int i,m;
+
+	if (s->error_x)
+		return;
+	hh_all.tasks++;
+	hh_all.read+=r;
+	hh_all.write+=w;
+	hh_all.bytes+=r+w;
+	if (!r&&!w) // not an offender, keep the counters for the ones that are
+		return;
+	k=hh_key(s);
+	h=hh_fnv(k);
+	for (i=0;i<hh_cnt;i++)
+		if (hh_hash[i]==h&&!strncmp(hh[i].key,k,sizeof hh[i].key-1))
+			break;
+	if (i==hh_cnt) {
+		if (hh_cnt<HH_SLOTS) {
+			hh_ord[hh_cnt]=hh_cnt;
+			memset(hh+hh_cnt,0,sizeof *hh);
+			hh_cnt++;
+		} else {
+			for (i=m=0;i<hh_cnt;i++)
+				if (hh[i].bytes<hh[m].bytes)
+					m=i;
+			i=m;
+			hh[i].err=hh[i].bytes;
+			hh[i].read=hh[i].write=hh[i].tasks=0;
+		}
+		snprintf(hh[i].key,sizeof hh[i].key,"%s",k);
+		hh_hash[i]=h;
+	}
+	hh[i].bytes+=r+w;
+	hh[i].read+=r;
+	hh[i].write+=w;
+	hh[i].tasks++;
+	hh_dirty=1;
+}
+
+static int hh_cmp(const void *a,const void *b) {
+	const struct hh_stats *x=hh+*(const int *)a;
+	const struct hh_stats *y=hh+*(const int *)b;
+
+	if (x->bytes!=y->bytes)
+		return x->bytes<y->bytes?1:-1;
+	return strcmp(x->key,y->key);
+}
+
+inline int hitters_count(void) {
+	return hh_cnt;
+}
+
+// idx-th biggest key; NULL past the end
+inline const struct hh_stats *hitters_get(int idx) {
+	if (idx<0||idx>=hh_cnt)
+		return NULL;
+	if (hh_dirty) {
+		qsort(hh_ord,hh_cnt,sizeof *hh_ord,hh_cmp);
+		hh_dirty=0;
+	}
+	return hh+hh_ord[idx];
+}
+
+inline const struct hh_stats *hitters_total(void) {
+	return &hh_all;
+}
+
+inline const char *hitters_key_name(void) {
+	switch (params.hh_key) {
+		default:
+		case E_HH_CMD:
+			return "cmd";
+		case E_HH_USER:
+			return "user";
+		case E_HH_CGROUP:
+			return "cgroup";
+	}
+}
+
+inline void hitters_fini(void) {
+	memset(&hh_all,0,sizeof hh_all);
+	hh_cnt=0;
+	hh_dirty=0;
+}
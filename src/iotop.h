@@ -25,6 +25,7 @@ You should have received a copy of the GNU General Public License along with thi
 #endif
 
 #include <regex.h>
+#include <time.h>
 #include <stdint.h>
 #include <sys/types.h>
 
@@ -38,10 +39,41 @@ typedef enum {
 	E_GR_W,
 	E_GR_RW,
 	E_GR_SW,
+	E_GR_NW,
+	E_GR_CPU, // E_GR_CPU..E_GR_IRQ are in the order of DLY_*
+	E_GR_MEM,
+	E_GR_THRASH,
+	E_GR_COMPACT,
+	E_GR_WPCOPY,
+	E_GR_IRQ,
 	E_GR_MIN=E_GR_IO,
-	E_GR_MAX=E_GR_SW,
+	E_GR_MAX=E_GR_IRQ,
 } e_grtype;
 
+typedef enum {
+	E_COL_AUTO, // netlink when available, procio otherwise
+	E_COL_NETLINK,
+	E_COL_PROCIO,
+} e_collector;
+
+typedef enum {
+	E_GRP_NONE, // a row per task
+	E_GRP_CGROUP, // a row per cgroup v2
+	E_GRP_USER, // a row per effective user
+} e_group;
+
+typedef enum {
+	E_FMT_TEXT, // fixed width columns
+	E_FMT_JSON, // one JSON object per line
+	E_FMT_CSV,
+} e_format;
+
+typedef enum {
+	E_HH_CMD, // the program name of the exited tasks
+	E_HH_USER,
+	E_HH_CGROUP,
+} e_hhkey;
+
 typedef union {
 	struct _flags {
 		int batch_mode;
@@ -76,6 +108,14 @@ typedef union {
 		int base; // 1000 or 1024
 		int threshold; // 1..10
 		int norenice;
+		int sampling; // query idle tasks less often
+		int logical; // show logical I/O columns
+		int netwrite; // show NET WRITE column
+		int delays; // show CPU..IRQ delay columns
+		int devices; // show the block device panel
+		int psi; // show the pressure stall information
+		int offenders; // show the I/O of the exited tasks
+		int pctl; // percentile of the READ, WRITE and IO P columns, 0 hides them
 	} f;
 	int opts[24];
 } config_t;
@@ -89,6 +129,26 @@ typedef struct {
 	regex_t search_regx; // search regex
 	int search_regx_ok; // search regex compiles ok
 	ucell *search_uc; // utf cell array
+	e_collector collector; // data source for per task counters
+	int collector_bench; // compare collector cost and exit
+	e_format format; // batch output format
+	char *record_file; // append samples to this file
+	char *replay_file; // read samples from this file instead of the system
+	int replay_from; // start the replay that many seconds into the recording
+	char *ring_file; // keep the last samples in memory and write them to this file on a trigger
+	int ring_size; // samples kept
+	int burst_s; // sample faster for that long after the ring is written
+	int burst_ms; // at this interval
+	char *daemon_name; // publish the samples in this shared memory segment
+	char *attach; // show the samples of the daemon with this shared memory segment
+	char *export_addr; // serve OpenMetrics on this address instead of showing the data
+	int export_top; // processes exported individually, the rest is aggregated
+	e_group group; // show a row per group of tasks instead of a row per task
+	char *cgroup; // only the tasks of this cgroup v2
+	int cgroup_iostat; // DISK READ and WRITE of the cgroups come from their io.stat
+	int profile; // time the phases of each cycle
+	int bench; // number of synthetic tasks instead of the system ones
+	e_hhkey hh_key; // what the I/O of the exited tasks is summed by
 } params_t;
 
 extern config_t config;
@@ -99,14 +159,48 @@ extern unsigned taskstats_ver;
 #define IOTOP_TASKSTATS_MINVER 4
 #define IOTOP_TASKSTATS_VERSION 15
 
+// logical I/O, as seen by read/write syscalls, including page cache hits
+enum {
+	LIO_RCHAR,
+	LIO_WCHAR,
+	LIO_SYSCR,
+	LIO_SYSCW,
+	LIO_MAX
+};
+
+// taskstats delays besides swapin and blkio
+enum {
+	DLY_CPU, // waiting for a CPU on the run queue
+	DLY_MEM, // direct memory reclaim (freepages)
+	DLY_THRASH, // thrashing page cache
+	DLY_COMPACT, // memory compaction
+	DLY_WPCOPY, // write-protect copy
+	DLY_IRQ, // IRQ/SOFTIRQ
+	DLY_MAX
+};
+
+// the values kept in the histograms of histo.c
+enum {
+	HG_READ, // bytes/s
+	HG_WRITE,
+	HG_BLKIO, // % of the time
+	HG_MAX
+};
+
+// rules of --trigger
+#define TRIGGER_MAX 8
+
 #define HISTORY_POS 60
 #define HISTORY_CNT (HISTORY_POS*2)
 
 struct xxxid_stats_arr {
 	struct xxxid_stats **arr;
 	struct xxxid_stats **sor;
+	struct xxxid_stats **act; // the tasks with I/O in the interval, see create_diff
 	int length;
 	int size;
+	int act_len;
+	int act_size;
 };
 
 struct xxxid_stats {
@@ -116,12 +210,22 @@ struct xxxid_stats {
 	uint64_t blkio_delay_total; // nanoseconds
 	uint64_t read_bytes;
 	uint64_t write_bytes;
+	uint64_t delay_total[DLY_MAX]; // nanoseconds
+	uint64_t read_char; // logical I/O, includes page cache hits
+	uint64_t write_char;
+	uint64_t read_syscalls;
+	uint64_t write_syscalls;
+	uint64_t cancelled_write_bytes; // truncated dirty page cache
 	uint64_t swapin_delay_total_p; // aggregated data from all threads
 	uint64_t blkio_delay_total_p; // used for process view
 	uint64_t read_bytes_p;
 	uint64_t write_bytes_p;
+	uint64_t cancelled_write_bytes_p;
+	uint64_t delay_total_p[DLY_MAX];
+	uint64_t lio_p[LIO_MAX]; // aggregated read_char..write_syscalls
 	uint64_t ts_s; // start timestamp for accum-bw
 	uint64_t ts_e; // end timestamp for accum-bw
+	uint64_t ts_smp; // timestamp of the last query of this task
 
 	double blkio_val;
 	double swapin_val;
@@ -141,6 +245,25 @@ struct xxxid_stats {
 	double read_val_abw_p;
 	double write_val_abw_p;
 
+	double nwrite_val; // write_bytes not cancelled by truncation
+	double nwrite_val_acc;
+	double nwrite_val_abw;
+	double nwrite_val_p;
+	double nwrite_val_acc_p;
+	double nwrite_val_abw_p;
+	double cwrite_val; // cancelled_write_bytes per second
+	double cwrite_val_p;
+
+	double delay_val[DLY_MAX]; // percentage of time
+	double delay_val_p[DLY_MAX];
+
+	double lio_val[LIO_MAX]; // logical I/O per second
+	double lio_acc[LIO_MAX];
+	double lio_abw[LIO_MAX];
+	double lio_val_p[LIO_MAX];
+	double lio_acc_p[LIO_MAX];
+	double lio_abw_p[LIO_MAX];
+
 	int io_prio;
 
 	int euid;
@@ -153,15 +276,33 @@ struct xxxid_stats {
 	uint8_t sihist[HISTORY_CNT]; // swapin history data
 	double readhist[HISTORY_CNT]; // read history data
 	double writehist[HISTORY_CNT]; // write history data
+	double netwhist[HISTORY_CNT]; // net write history data
+	uint8_t dlyhist[DLY_MAX][HISTORY_CNT]; // delay history data
 
 	uint8_t iohist_p[HISTORY_CNT]; // io history data (aggregated in main process)
 	uint8_t sihist_p[HISTORY_CNT]; // swapin history data (aggregated in main process)
 	double readhist_p[HISTORY_CNT]; // read history data (aggregated in main process)
 	double writehist_p[HISTORY_CNT]; // write history data (aggregated in main process)
+	double netwhist_p[HISTORY_CNT]; // net write history data (aggregated in main process)
+	uint8_t dlyhist_p[DLY_MAX][HISTORY_CNT]; // delay history data (aggregated in main process)
 
 	int exited; // exited>0 shows for how many refresh cycles the process is gone
-	int error_x; // netlink api did not return valid data
+	int idle; // for how many refresh cycles the task did not do any I/O
+	int stale; // data is copied from the previous cycle instead of queried (--sampling)
+	int error_x; // collector did not return valid data
 	int error_i; // get_ioprio did not return valid data
+	int cgroup; // id of the cgroup v2 of the process, see cgroup.c
+	e_group group; // E_GRP_NONE for tasks, the kind of group for group rows
+	int tasks; // tasks and processes aggregated in a group row
+	int procs;
+	uint64_t psi_total; // us of io.pressure some stall of a cgroup row
+	double psi_val; // % of the time with io.pressure some stall
+	struct histo *hist; // the values of each interval, NULL until the task does I/O
+	struct histo *hist_p; // the same for the aggregated values of a process
+	int hist_in; // the current interval is already in hist and hist_p
+	double pctl_val[HG_MAX]; // the --percentiles values of hist
+	double pctl_val_p[HG_MAX]; // and of hist_p
+	uint8_t trig_run[TRIGGER_MAX]; // intervals in a row over the limit of each --trigger rule
 	// there is no point to keep in memory data for processes exited before HISTORY_CNT cycles
 	struct xxxid_stats_arr *threads;
 };
@@ -182,16 +323,65 @@ struct act_stats {
 	uint8_t have_o;
 };
 
-inline void nl_init(void);
+inline int nl_init(void);
 inline void nl_fini(void);
 
 inline int nl_xxxid_info(pid_t tid,pid_t pid,struct xxxid_stats *stats);
 
+typedef int (*xxxid_info_cb)(pid_t tid,pid_t pid,struct xxxid_stats *stats);
+
+struct collector {
+	const char *name;
+	int (*init)(void); // 0 on success
+	void (*fini)(void);
+	void (*cycle)(void); // called once before each /proc walk, can be NULL
+	xxxid_info_cb info;
+	int has_delays; // provides swapin_delay_total and blkio_delay_total
+};
+
+extern const struct collector *collector;
+
+inline int collector_start(void);
+inline void collector_init(void);
+inline void collector_fini(void);
+inline void collector_bench(void);
+
 typedef int (*filter_callback)(struct xxxid_stats *);
 typedef int (*filter_callback_w)(struct xxxid_stats *,int width);
 
-inline struct xxxid_stats_arr *fetch_data(filter_callback);
+// what fetch_data, group_data and create_diff read and what they keep from
+// one cycle to the next; iotop has one that fetch_params fills from config
+// and params, each libiotop context has its own
+struct fetch_ctx {
+	const struct collector *col;
+	int sampling; // query idle tasks less often
+	int pctl; // percentile of the histograms, 0 for none
+	int syscalls; // the exact syscall counts are needed
+	int offenders; // feed the exited tasks to the heavy hitters
+	e_hhkey hh_key;
+	e_group group;
+	const char *cgroup; // only the tasks of this cgroup
+	int cgroup_iostat; // the disk I/O of the cgroup rows is taken from io.stat
+	int psi; // read the pressure of the cgroup rows
+	unsigned long sample_cycle;
+	int sample_skipped;
+	int sample_have_vm;
+	uint64_t sample_pgin;
+	uint64_t sample_pgou;
+	struct xxxid_stats_arr *group_tasks; // the tasks behind the group rows of the last fetch_data
+};
+
+inline struct fetch_ctx *fetch_params(void);
+inline void fetch_fini(struct fetch_ctx *f);
+inline const struct collector *collector_open(e_collector c);
+inline struct xxxid_stats_arr *fetch_data(struct fetch_ctx *f,filter_callback filter,struct xxxid_stats_arr *ps);
+inline struct xxxid_stats_arr *task_data(struct xxxid_stats_arr *cs);
 inline void free_stats(struct xxxid_stats *s);
+inline uint64_t lio_counter(const struct xxxid_stats *s,int i);
+inline int delay_available(int i);
+inline int delay_kernel(int i);
+inline unsigned taskstats_version(void);
+inline void taskstats_version_set(unsigned v);
 
 typedef void (*view_loop)(void);
 typedef void (*view_init)(void);
@@ -201,6 +391,15 @@ inline void view_batch_loop(void);
 inline void view_batch_init(void);
 inline void view_batch_fini(void);
 
+inline void view_export_loop(void);
+inline void view_export_init(void);
+inline void view_export_fini(void);
+inline int export_open(const char *addr);
+
+inline void view_daemon_loop(void);
+inline void view_daemon_init(void);
+inline void view_daemon_fini(void);
+
 inline void view_curses_loop(void);
 inline void view_curses_init(void);
 inline void view_curses_fini(void);
@@ -212,15 +411,18 @@ inline int masked_sort_by(int isforward);
 
 /* utils.c */
 
+struct u8buf { // the output of u8fmt, grows on demand and is kept between the calls
+	char *p;
+	size_t sz;
+};
+
 inline void read_cmdlines(int pid,char **cmd_long,char **cmd_short,char **cmd_comm);
 
 inline int64_t monotime(void);
+inline uint64_t monotime_ns(void);
 inline char *u8strpadt(const char *s,ssize_t len);
 inline char *esc_low_ascii(char *p);
-
-typedef void (*pg_cb)(pid_t pid,pid_t tid,struct xxxid_stats_arr *hint1,filter_callback hint2);
-inline void pidgen_cb(pg_cb cb,struct xxxid_stats_arr *hint1,filter_callback hint2);
-
+inline const char *u8fmt(struct u8buf *b,const char *s,ssize_t len,int esc);
 
 inline int is_a_dir(const char *p);
 inline int is_a_file(const char *p);
@@ -228,6 +430,80 @@ inline int is_a_process(pid_t tid);
 
 inline double timediff_in_s(uint64_t sta,uint64_t end);
 
+/* pidgen.c */
+
+typedef void (*pg_cb)(pid_t pid,pid_t tid,struct xxxid_stats_arr *hint1,filter_callback hint2);
+inline void pidgen_cb(pg_cb cb,struct xxxid_stats_arr *hint1,filter_callback hint2);
+inline int proc_dirfd(void);
+inline void pidgen_fini(void);
+
+/* obuf.c */
+
+inline void obuf_flush(void);
+inline void obuf_put(const char *s,size_t len);
+inline void obuf_str(const char *s);
+inline void obuf_chr(char c);
+inline void obuf_u64(uint64_t v);
+inline void obuf_i64(int64_t v);
+inline void obuf_i64w(int64_t v,int width);
+inline void obuf_strw(const char *s,int width);
+inline void obuf_printf(const char *fmt,...);
+inline void obuf_fix(double v,int prec);
+inline void obuf_fixw(double v,int prec,int width);
+inline void obuf_json(const char *s);
+inline void obuf_csv(const char *s);
+inline void obuf_capture(void);
+inline char *obuf_captured(size_t *len);
+
+/* record.c */
+
+inline int record_open(const char *path);
+inline void record_close(void);
+inline void record_frame(struct xxxid_stats_arr *cs,uint64_t pgin,uint64_t pgou,uint64_t ts);
+inline int ring_open(void);
+inline void ring_flush(void);
+inline void ring_signal(void);
+inline const struct collector *replay_open(const char *path);
+inline void replay_close(void);
+inline int replay_eof(void);
+inline int replay_fill(struct xxxid_stats_arr *a,filter_callback filter,void (*add)(struct xxxid_stats_arr *,struct xxxid_stats *,filter_callback));
+inline int replay_vm_counters(uint64_t *pgpgin,uint64_t *pgpgou);
+inline uint64_t replay_time(void);
+inline uint64_t replay_period(void);
+inline void replay_seek(int frames);
+inline int replay_seeked(void);
+inline int replay_speed(int faster);
+inline void wall_time(struct timespec *ts);
+inline int replaying(void);
+inline int daemon_open(const char *name);
+inline void daemon_close(void);
+inline void daemon_publish(struct xxxid_stats_arr *cs,uint64_t pgin,uint64_t pgou,uint64_t ts);
+inline const struct collector *attach_open(const char *name);
+inline void attach_close(void);
+
+/* cgroup.c */
+
+inline void cgroup_resolve(struct xxxid_stats_arr *a,struct xxxid_stats_arr *pt);
+inline int cgroup_find(const char *path);
+inline const char *cgroup_path(int id);
+inline int cgroup_psi(int id,uint64_t *some_t);
+inline int cgroup_iostat(int id,uint64_t *rbytes,uint64_t *wbytes);
+inline void cgroup_fini(void);
+
+/* group.c */
+
+inline struct xxxid_stats_arr *group_data(const struct fetch_ctx *f,struct xxxid_stats_arr *a,struct xxxid_stats_arr *pt,struct xxxid_stats_arr *ps);
+inline const char *group_name(void);
+inline void group_drill(struct xxxid_stats *g);
+
+/* procio.c */
+
+inline int procio_init(void);
+inline void procio_fini(void);
+inline void procio_cycle(void);
+inline int procio_xxxid_info(pid_t tid,pid_t pid,struct xxxid_stats *stats);
+inline int procio_syscalls(pid_t tid,pid_t pid,struct xxxid_stats *stats);
+
 /* ioprio.c */
 
 enum {
@@ -251,8 +527,23 @@ enum {
 	SORT_BY_USER,
 	SORT_BY_READ,
 	SORT_BY_WRITE,
+	SORT_BY_NWRITE,
 	SORT_BY_SWAPIN,
 	SORT_BY_IO,
+	SORT_BY_DCPU, // SORT_BY_DCPU..SORT_BY_DIRQ are in the order of DLY_*
+	SORT_BY_DMEM,
+	SORT_BY_DTHRASH,
+	SORT_BY_DCOMPACT,
+	SORT_BY_DWPCOPY,
+	SORT_BY_DIRQ,
+	SORT_BY_LREAD,
+	SORT_BY_LWRITE,
+	SORT_BY_SYSCR,
+	SORT_BY_SYSCW,
+	SORT_BY_PSI,
+	SORT_BY_PREAD, // SORT_BY_PREAD..SORT_BY_PIO are in the order of HG_*
+	SORT_BY_PWRITE,
+	SORT_BY_PIO,
 	SORT_BY_GRAPH,
 	SORT_BY_COMMAND,
 	SORT_BY_MAX
@@ -274,7 +565,139 @@ inline int ioprio2prio(int ioprio);
 
 /* vmstat.c */
 
+enum {
+	VM_PGPGIN, // bytes
+	VM_PGPGOUT,
+	VM_PSWPIN, // bytes
+	VM_PSWPOUT,
+	VM_PGMAJFAULT, // count
+	VM_DIRTY, // bytes
+	VM_WRITEBACK,
+	VM_MAX
+};
+
+struct vm_pressure {
+	double swapin; // bytes/s
+	double swapout;
+	double majfault; // faults/s
+	uint64_t dirty; // bytes
+	uint64_t writeback;
+};
+
+inline int get_vm_stats(uint64_t *v);
 inline int get_vm_counters(uint64_t *pgpgin,uint64_t *pgpgou);
+inline void vm_pressure_update(void);
+inline const struct vm_pressure *vm_pressure_get(void);
+inline void vmstat_fini(void);
+
+/* diskstats.c */
+
+struct dev_stats {
+	char name[32];
+	double read; // bytes/s
+	double write;
+	double rio; // requests/s
+	double wio;
+	double aqu; // average queue depth
+	double util; // % of the time with requests in flight
+	double await; // average ms per request
+	double hist[HISTORY_CNT]; // read+write history data
+};
+
+inline int diskstats_update(void);
+inline int diskstats_count(void);
+inline struct dev_stats *diskstats_get(int idx);
+inline void diskstats_fini(void);
+
+/* psi.c */
+
+enum {
+	PSI_IO,
+	PSI_MEM,
+	PSI_MAX
+};
+
+struct psi_stats {
+	double some; // % of the time some tasks stalled in the last interval
+	double full; // % of the time all tasks stalled in the last interval
+	double some10; // the kernel averages over 10 seconds
+	double full10;
+	double hist[HISTORY_CNT]; // some history data
+};
+
+inline int psi_parse(char *buf,double *some10,double *full10,uint64_t *some_t,uint64_t *full_t);
+inline int psi_read(int fd,char *buf,size_t sz);
+inline int psi_update(void);
+inline const struct psi_stats *psi_get(int res);
+inline void psi_fini(void);
+
+/* prof.c */
+
+enum {
+	PROF_PIDGEN, // the /proc walk and the per task work not in the other phases
+	PROF_COLLECT, // the collector query of a task
+	PROF_CMDLINE,
+	PROF_FILTER,
+	PROF_DIFF,
+	PROF_SORT,
+	PROF_RENDER,
+	PROF_MAX
+};
+
+struct prof_stats {
+	uint64_t cnt;
+	uint64_t total; // ns, without the nested phases
+	uint64_t max;
+};
+
+inline uint64_t prof_start(void);
+inline void prof_end(int phase,uint64_t start);
+inline const struct prof_stats *prof_get(int phase);
+inline const char *prof_phase(int phase);
+inline void prof_reset(void);
+inline void prof_line(char *buf,size_t len,int phase);
+inline void prof_summary(void);
+
+/* hitters.c */
+
+struct hh_stats {
+	char key[64];
+	uint64_t bytes; // read+write, includes err
+	uint64_t err; // at most that much of bytes belongs to keys evicted before
+	uint64_t read; // of the tasks counted since the key got its counter
+	uint64_t write;
+	uint64_t tasks;
+};
+
+inline void hitters_exit(const struct xxxid_stats *s);
+inline int hitters_count(void);
+inline const struct hh_stats *hitters_get(int idx);
+inline const struct hh_stats *hitters_total(void);
+inline const char *hitters_key_name(void);
+inline void hitters_fini(void);
+
+/* histo.c */
+
+inline void histo_add(struct histo **ph,double read,double write,double blkio);
+inline double histo_pct(const struct histo *h,int v,int pct);
+inline unsigned histo_count(const struct histo *h);
+
+/* trigger.c */
+
+inline int trigger_add(const char *spec);
+inline int trigger_count(void);
+inline uint64_t trigger_period(void);
+inline void trigger_capture(int sec,int ms);
+inline void trigger_check(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,uint64_t ts);
+inline void trigger_fini(void);
+
+/* synth.c */
+
+inline const struct collector *synth_open(int tasks);
+inline void synth_fill(struct xxxid_stats_arr *a,filter_callback filter,void (*add)(struct xxxid_stats_arr *,struct xxxid_stats *,filter_callback));
+inline uint64_t synth_time(void);
+inline int synth_vm_counters(uint64_t *pgpgin,uint64_t *pgpgou);
+inline void synth_report(void);
 
 /* checks.c */
 
@@ -291,12 +714,19 @@ inline void arr_sort(struct xxxid_stats_arr *pa,int (*cb)(const void *a,const vo
 
 #define HEADER1_FORMAT "  Total DISK READ: %7.2f %s%s |   Total DISK WRITE: %7.2f %s%s"
 #define HEADER2_FORMAT "Current DISK READ: %7.2f %s%s | Current DISK WRITE: %7.2f %s%s"
+#define VMSTAT_FORMAT "     SWAP IN: %7.2f %s | SWAP OUT: %7.2f %s | MAJ FAULTS: %7.1f/s | DIRTY: %7.2f %s | WRITEBACK: %7.2f %s"
+#define PSI_FORMAT " IO PRESSURE: some %6.2f %% full %6.2f %%%s | MEM PRESSURE: some %6.2f %% full %6.2f %%%s"
 
 inline void calc_total(struct xxxid_stats_arr *cs,double *read,double *write);
 inline void calc_a_total(struct act_stats *act,double *read,double *write,double time_s);
 inline void humanize_val(double *value,char *str,int allow_accum);
+inline void vm_pressure_line(char *buf,size_t len,const struct vm_pressure *p);
+inline void humanize_cnt(double *value,char *str,int allow_accum);
+inline double lio_value(const struct xxxid_stats *s,int i);
+inline double pctl_value(const struct xxxid_stats *s,int i);
+inline int column_hidden(int col);
 inline int iotop_sort_cb(const void *a,const void *b);
-inline int create_diff(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,double time_s,uint64_t ts_c,filter_callback_w cb,int width,int *cnt);
+inline int create_diff(const struct fetch_ctx *f,struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,double time_s,uint64_t ts_c,filter_callback_w cb,int width,int *cnt);
 inline int value2scale(double val,double mx);
 inline int filter1(struct xxxid_stats *s);
 
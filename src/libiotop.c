@@ -0,0 +1,321 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+#include "libiotop.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the command line of iotop; the collection code takes its settings from a
+// struct fetch_ctx, the library keeps these at their defaults
+int maxpidlen=5;
+unsigned taskstats_ver=0; // 0=no warning, any version above the biggest known one will print a warning after exit
+config_t config={0};
+params_t params={0};
+
+struct iotop_task {
+	struct xxxid_stats *s;
+	int p; // use the values aggregated in the process
+};
+
+struct iotop_snap {
+	struct xxxid_stats_arr *cs;
+	struct iotop_task *t;
+	int n;
+	int ref; // the context keeps the last one as the base of the next diff
+	double time_s;
+	double totals[4]; // task read, write, disk read, write
+};
+
+struct iotop_ctx {
+	struct iotop_opts o;
+	struct fetch_ctx f;
+	struct iotop_snap *last;
+	struct act_stats act;
+};
+
+static int lib_ctx=0; // open contexts, the last one frees the /proc walk buffers
+
+inline void iotop_opts_init(struct iotop_opts *o) {
+	memset(o,0,sizeof *o);
+	o->collector=IOTOP_COLLECTOR_AUTO;
+	o->pid=-1;
+	o->uid=-1;
+}
+
+inline iotop_ctx *iotop_open(const struct iotop_opts *o) {
+	iotop_ctx *c;
+
+	if (!o||o->collector<IOTOP_COLLECTOR_AUTO||o->collector>IOTOP_COLLECTOR_PROCIO) {
+		errno=EINVAL;
+		return NULL;
+	}
+	c=calloc(1,sizeof *c);
+	if (!c)
+		return NULL;
+	c->o=*o;
+	switch (o->collector) {
+		case IOTOP_COLLECTOR_NETLINK:
+			c->f.col=collector_open(E_COL_NETLINK);
+			break;
+		case IOTOP_COLLECTOR_PROCIO:
+			c->f.col=collector_open(E_COL_PROCIO);
+			break;
+		default:
+			c->f.col=collector_open(E_COL_AUTO);
+			break;
+	}
+	if (!c->f.col) {
+		free(c);
+		errno=ENODEV;
+		return NULL;
+	}
+	c->f.sampling=o->sampling;
+	c->f.syscalls=1; // IOTOP_SYSCR and IOTOP_SYSCW are exact
+	lib_ctx++;
+	return c;
+}
+
+inline void iotop_close(iotop_ctx *c) {
+	if (!c)
+		return;
+	if (c->last)
+		iotop_snap_free(c->last);
+	fetch_fini(&c->f);
+	c->f.col->fini();
+	free(c);
+	if (!--lib_ctx)
+		pidgen_fini();
+}
+
+inline int iotop_available(const iotop_ctx *c,int value) {
+	if (value<0||value>=IOTOP_VALUE_MAX)
+		return 0;
+	if (value>=IOTOP_SWAPIN&&!c->f.col->has_delays)
+		return 0;
+	if (value>=IOTOP_DCPU)
+		return delay_kernel(value-IOTOP_DCPU);
+	return 1;
+}
+
+// filter1 with the options of the context
+static inline int lib_skip(const iotop_ctx *c,const struct xxxid_stats *s) {
+	if (!s->cmdline_long||!s->cmdline_short)
+		return 1;
+	if (c->o.uid!=-1&&s->euid!=c->o.uid)
+		return 1;
+	if (c->o.pid!=-1&&s->tid!=c->o.pid)
+		return 1;
+	return 0;
+}
+
+inline iotop_snap *iotop_sample(iotop_ctx *c) {
+	struct xxxid_stats_arr *ps=c->last?c->last->cs:NULL;
+	iotop_snap *s=calloc(1,sizeof *s);
+	int i;
+
+	if (!s)
+		return NULL;
+	s->cs=fetch_data(&c->f,NULL,ps);
+	if (!s->cs) {
+		free(s);
+		errno=ENOMEM;
+		return NULL;
+	}
+	c->act.read_bytes_o=c->act.read_bytes;
+	c->act.write_bytes_o=c->act.write_bytes;
+	c->act.ts_o=c->act.ts_c;
+	c->act.have_o=ps!=NULL;
+	get_vm_counters(&c->act.read_bytes,&c->act.write_bytes);
+	c->act.ts_c=monotime();
+	s->time_s=ps?timediff_in_s(c->act.ts_o,c->act.ts_c):0;
+	create_diff(&c->f,s->cs,ps,s->time_s,c->act.ts_c,NULL,0,NULL);
+	calc_a_total(&c->act,s->totals+2,s->totals+3,s->time_s);
+
+	// exited tasks are kept in the data for their history only
+	s->t=malloc((s->cs->length+1)*sizeof *s->t);
+	if (!s->t) {
+		arr_free(s->cs);
+		free(s);
+		errno=ENOMEM;
+		return NULL;
+	}
+	for (i=0;i<s->cs->length;i++) {
+		struct xxxid_stats *x=s->cs->arr[i];
+
+		if (x->exited||lib_skip(c,x))
+			continue;
+		s->totals[0]+=x->read_val;
+		s->totals[1]+=x->write_val;
+		if (c->o.processes&&x->pid!=x->tid)
+			continue;
+		s->t[s->n].s=x;
+		s->t[s->n].p=c->o.processes;
+		s->n++;
+	}
+
+	if (c->last)
+		iotop_snap_free(c->last);
+	c->last=s;
+	s->ref=2;
+	return s;
+}
+
+inline void iotop_snap_free(iotop_snap *s) {
+	if (!s||--s->ref)
+		return;
+	arr_free(s->cs);
+	free(s->t);
+	free(s);
+}
+
+inline double iotop_snap_interval(const iotop_snap *s) {
+	return s->time_s;
+}
+
+inline void iotop_snap_totals(const iotop_snap *s,double *task_read,double *task_write,double *disk_read,double *disk_write) {
+	if (task_read)
+		*task_read=s->totals[0];
+	if (task_write)
+		*task_write=s->totals[1];
+	if (disk_read)
+		*disk_read=s->totals[2];
+	if (disk_write)
+		*disk_write=s->totals[3];
+}
+
+inline const iotop_task *iotop_snap_next(const iotop_snap *s,int *it) {
+	if (*it<0||*it>=s->n)
+		return NULL;
+	return s->t+(*it)++;
+}
+
+inline pid_t iotop_task_pid(const iotop_task *t) {
+	return t->s->pid;
+}
+
+inline pid_t iotop_task_tid(const iotop_task *t) {
+	return t->s->tid;
+}
+
+inline int iotop_task_uid(const iotop_task *t) {
+	return t->s->euid;
+}
+
+inline const char *iotop_task_user(const iotop_task *t) {
+	return t->s->pw_name;
+}
+
+inline const char *iotop_task_comm(const iotop_task *t) {
+	return t->s->cmdline_comm?t->s->cmdline_comm:t->s->cmdline_short;
+}
+
+inline const char *iotop_task_cmdline(const iotop_task *t) {
+	return t->s->cmdline_long;
+}
+
+inline int iotop_task_ioprio(const iotop_task *t) {
+	return t->s->io_prio;
+}
+
+inline uint64_t iotop_task_counter(const iotop_task *t,int value) {
+	struct xxxid_stats *s=t->s;
+	int p=t->p;
+
+	switch (value) {
+		case IOTOP_READ:
+			return p?s->read_bytes_p:s->read_bytes;
+		case IOTOP_WRITE:
+			return p?s->write_bytes_p:s->write_bytes;
+		case IOTOP_NWRITE: {
+			uint64_t w=p?s->write_bytes_p:s->write_bytes;
+			uint64_t c=p?s->cancelled_write_bytes_p:s->cancelled_write_bytes;
+
+			return w>c?w-c:0;
+		}
+		case IOTOP_RCHAR:
+		case IOTOP_WCHAR:
+		case IOTOP_SYSCR:
+		case IOTOP_SYSCW:
+			return p?s->lio_p[value-IOTOP_RCHAR]:lio_counter(s,value-IOTOP_RCHAR);
+		case IOTOP_SWAPIN:
+			return p?s->swapin_delay_total_p:s->swapin_delay_total;
+		case IOTOP_BLKIO:
+			return p?s->blkio_delay_total_p:s->blkio_delay_total;
+		case IOTOP_DCPU:
+		case IOTOP_DMEM:
+		case IOTOP_DTHRASH:
+		case IOTOP_DCOMPACT:
+		case IOTOP_DWPCOPY:
+		case IOTOP_DIRQ:
+			return p?s->delay_total_p[value-IOTOP_DCPU]:s->delay_total[value-IOTOP_DCPU];
+	}
+	return 0;
+}
+
+inline double iotop_task_rate(const iotop_task *t,int value) {
+	struct xxxid_stats *s=t->s;
+	int p=t->p;
+
+	switch (value) {
+		case IOTOP_READ:
+			return p?s->read_val_p:s->read_val;
+		case IOTOP_WRITE:
+			return p?s->write_val_p:s->write_val;
+		case IOTOP_NWRITE:
+			return p?s->nwrite_val_p:s->nwrite_val;
+		case IOTOP_RCHAR:
+		case IOTOP_WCHAR:
+		case IOTOP_SYSCR:
+		case IOTOP_SYSCW:
+			return p?s->lio_val_p[value-IOTOP_RCHAR]:s->lio_val[value-IOTOP_RCHAR];
+		case IOTOP_SWAPIN:
+			return p?s->swapin_val_p:s->swapin_val;
+		case IOTOP_BLKIO:
+			return p?s->blkio_val_p:s->blkio_val;
+		case IOTOP_DCPU:
+		case IOTOP_DMEM:
+		case IOTOP_DTHRASH:
+		case IOTOP_DCOMPACT:
+		case IOTOP_DWPCOPY:
+		case IOTOP_DIRQ:
+			return p?s->delay_val_p[value-IOTOP_DCPU]:s->delay_val[value-IOTOP_DCPU];
+	}
+	return 0;
+}
+
+inline int iotop_task_history_bytes(const iotop_task *t,int value,double *out,int n) {
+	const double *h;
+
+	switch (value) {
+		case IOTOP_READ:
+			h=t->p?t->s->readhist_p:t->s->readhist;
+			break;
+		case IOTOP_WRITE:
+			h=t->p?t->s->writehist_p:t->s->writehist;
+			break;
+		case IOTOP_NWRITE:
+			h=t->p?t->s->netwhist_p:t->s->netwhist;
+			break;
+		default:
+			return -1;
+	}
+	if (n>HISTORY_CNT)
+		n=HISTORY_CNT;
+	if (n<0)
+		n=0;
+	memcpy(out,h,n*sizeof *out);
+	return n;
+}
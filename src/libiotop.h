@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#ifndef __LIBIOTOP_H__
+#define __LIBIOTOP_H__
+
+// libiotop - the data collection of iotop as a library
+//
+// a context collects samples; each sample is diffed against the previous one
+// of the same context and is returned as a snapshot that stays valid until
+// it is freed, independently of the context and of the other snapshots; the
+// next sample takes over the percentile histograms of the previous snapshot,
+// after that the snapshot keeps its values but no histogram state
+//
+// each context has its own options, collector and sampling state, contexts
+// of the same collector share its socket and buffers; the library is not
+// thread safe, use all contexts from a single thread; only the iotop_*
+// symbols are exported from libiotop.a
+//
+//	struct iotop_opts o;
+//	iotop_ctx *c;
+//
+//	iotop_opts_init(&o);
+//	c=iotop_open(&o);
+//	for (;;) {
+//		iotop_snap *s=iotop_sample(c);
+//		const iotop_task *t;
+//		int it=0;
+//
+//		while ((t=iotop_snap_next(s,&it)))
+//			printf("%d %f\n",iotop_task_pid(t),iotop_task_rate(t,IOTOP_READ));
+//		iotop_snap_free(s);
+//		sleep(1);
+//	}
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define LIBIOTOP_API_VERSION 1
+
+typedef struct iotop_ctx iotop_ctx;
+typedef struct iotop_snap iotop_snap;
+typedef struct iotop_task iotop_task;
+
+enum {
+	IOTOP_COLLECTOR_AUTO, // netlink when available, procio otherwise
+	IOTOP_COLLECTOR_NETLINK, // taskstats, requires root or CAP_NET_ADMIN
+	IOTOP_COLLECTOR_PROCIO, // /proc/<pid>/io, the own tasks only without privileges
+};
+
+struct iotop_opts {
+	int collector; // IOTOP_COLLECTOR_*
+	int processes; // aggregate the threads in their process
+	int sampling; // query idle tasks less often
+	pid_t pid; // only this task, -1 for all
+	int uid; // only the tasks of this user, -1 for all
+};
+
+// per task values
+enum {
+	IOTOP_READ, // block device bytes
+	IOTOP_WRITE,
+	IOTOP_NWRITE, // written bytes not cancelled by truncation
+	IOTOP_RCHAR, // syscall bytes and counts, including page cache hits
+	IOTOP_WCHAR,
+	IOTOP_SYSCR,
+	IOTOP_SYSCW,
+	IOTOP_SWAPIN, // delays in nanoseconds, the rate is percentage of time
+	IOTOP_BLKIO,
+	IOTOP_DCPU,
+	IOTOP_DMEM,
+	IOTOP_DTHRASH,
+	IOTOP_DCOMPACT,
+	IOTOP_DWPCOPY,
+	IOTOP_DIRQ,
+	IOTOP_VALUE_MAX
+};
+
+void iotop_opts_init(struct iotop_opts *o);
+
+// NULL with errno set on failure
+iotop_ctx *iotop_open(const struct iotop_opts *o);
+void iotop_close(iotop_ctx *c);
+// the value is provided by the collector and the kernel
+int iotop_available(const iotop_ctx *c,int value);
+
+// collect and diff against the previous sample; the first one has no rates
+iotop_snap *iotop_sample(iotop_ctx *c);
+void iotop_snap_free(iotop_snap *s);
+// seconds since the previous sample
+double iotop_snap_interval(const iotop_snap *s);
+// read and write bytes/s of all tasks and of the block devices
+void iotop_snap_totals(const iotop_snap *s,double *task_read,double *task_write,double *disk_read,double *disk_write);
+// iterate with *it set to 0 at first; NULL at the end
+const iotop_task *iotop_snap_next(const iotop_snap *s,int *it);
+
+pid_t iotop_task_pid(const iotop_task *t);
+pid_t iotop_task_tid(const iotop_task *t);
+int iotop_task_uid(const iotop_task *t);
+const char *iotop_task_user(const iotop_task *t);
+const char *iotop_task_comm(const iotop_task *t);
+const char *iotop_task_cmdline(const iotop_task *t);
+int iotop_task_ioprio(const iotop_task *t);
+uint64_t iotop_task_counter(const iotop_task *t,int value);
+double iotop_task_rate(const iotop_task *t,int value);
+// up to n byte counts of IOTOP_READ, IOTOP_WRITE or IOTOP_NWRITE, one per
+// sample interval, newest first; these are not divided by the interval, for
+// the current rate use iotop_task_rate; returns the count or -1 for other
+// values
+int iotop_task_history_bytes(const iotop_task *t,int value,double *out,int n);
+
+#endif // __LIBIOTOP_H__
@@ -49,19 +49,59 @@ You should have received a copy of the GNU General Public License along with thi
 #define OPT_NO_ACCUM_BW 0x117
 #define OPT_SHOW_TIME 0x118
 #define OPT_FILTER 0x119
+#define OPT_SAMPLING 0x11a
+#define OPT_NO_SAMPLING 0x11b
+#define OPT_COLLECTOR 0x11c
+#define OPT_COLLECTOR_BENCH 0x11d
+#define OPT_LOGICAL 0x11e
+#define OPT_NO_LOGICAL 0x11f
+#define OPT_NET_WRITE 0x120
+#define OPT_NO_NET_WRITE 0x121
+#define OPT_DELAYS 0x122
+#define OPT_NO_DELAYS 0x123
+#define OPT_FORMAT 0x124
+#define OPT_RECORD 0x125
+#define OPT_REPLAY 0x126
+#define OPT_REPLAY_FROM 0x127
+#define OPT_EXPORT 0x128
+#define OPT_EXPORT_TOP 0x129
+#define OPT_DAEMON 0x12a
+#define OPT_ATTACH 0x12b
+#define OPT_GROUP 0x12c
+#define OPT_CGROUP 0x12d
+#define OPT_CGROUP_IOSTAT 0x12e
+#define OPT_DEVICES 0x12f
+#define OPT_NO_DEVICES 0x130
+#define OPT_PSI 0x131
+#define OPT_NO_PSI 0x132
+#define OPT_PROFILE 0x133
+#define OPT_BENCH 0x134
+#define OPT_OFFENDERS 0x135
+#define OPT_NO_OFFENDERS 0x136
+#define OPT_PERCENTILES 0x137
+#define OPT_NO_PERCENTILES 0x138
+#define OPT_TRIGGER 0x139
+#define OPT_RING 0x13a
+#define OPT_BURST 0x13b
 
 static const char *progname=NULL;
-int maxpidlen=5;
-unsigned taskstats_ver=0; // 0=no warning, any version above the biggest known one will print a warning after exit
-
-config_t config={0};
-params_t params={0};
 
 view_init v_init_cb=view_curses_init;
 view_fini v_fini_cb=view_curses_fini;
 view_loop v_loop_cb=view_curses_loop;
 
 inline void init_params(void) {
+	// recording and replay are not settings, keep them on reset
+	char *record_file=params.record_file;
+	char *replay_file=params.replay_file;
+	char *export_addr=params.export_addr;
+	char *daemon_name=params.daemon_name;
+	char *attach=params.attach;
+	char *ring_file=params.ring_file;
+	int ring_size=params.ring_size;
+	int burst_s=params.burst_s;
+	int burst_ms=params.burst_ms;
+
 	// initially params are zeroed; free the things possibly allocated on a second call
 	if (params.search_str)
 		free(params.search_str);
@@ -69,6 +109,8 @@ inline void init_params(void) {
 		regfree(&params.search_regx);
 	if (params.search_uc)
 		ucell_free(params.search_uc);
+	if (params.cgroup)
+		free(params.cgroup);
 	memset(&params,0,sizeof params);
 	params.iter=-1;
 	params.delay=1;
@@ -78,6 +120,26 @@ inline void init_params(void) {
 	memset(&params.search_regx,0,sizeof params.search_regx);
 	params.search_regx_ok=0;
 	params.search_uc=NULL;
+	params.collector=E_COL_AUTO;
+	params.collector_bench=0;
+	params.format=E_FMT_TEXT;
+	params.record_file=record_file;
+	params.replay_file=replay_file;
+	params.replay_from=0;
+	params.export_addr=export_addr;
+	params.daemon_name=daemon_name;
+	params.attach=attach;
+	params.ring_file=ring_file;
+	params.ring_size=ring_file?ring_size:30;
+	params.burst_s=ring_file?burst_s:10;
+	params.burst_ms=ring_file?burst_ms:100;
+	params.export_top=20;
+	params.group=E_GRP_NONE;
+	params.cgroup=NULL;
+	params.cgroup_iostat=0;
+	params.profile=0;
+	params.bench=0;
+	params.hh_key=E_HH_CMD;
 }
 
 inline void init_config(void) {
@@ -97,10 +159,16 @@ static inline void print_help(void) {
 		"DISK READ and DISK WRITE are the block I/O bandwidth used during the sampling\n"
 		"period. SWAPIN and IO are the percentages of time the thread spent respectively\n"
 		"while swapping in and waiting on I/O more generally. PRIO is the I/O priority\n"
-		"at which the thread is running (set using the ionice command).\n\n"
+		"at which the thread is running (set using the ionice command). NET WRITE is\n"
+		"DISK WRITE without the dirty pages truncated before writeback. VFS READ and\n"
+		"VFS WRITE are the bytes passed through read and write syscalls, including page\n"
+		"cache hits; SYSCR and SYSCW are the rates of those syscalls.\n\n"
 		"Controls: left and right arrows to change the sorting column, r to invert the\n"
 		"sorting order, o to toggle the --only option, p to toggle the --processes\n"
-		"option, a to toggle the --accumulated option, i to change I/O priority, q to\n"
+		"option, a to toggle the --accumulated option, i to change I/O priority, z to\n"
+		"cycle the group views, k to toggle the device panel, m to toggle the pressure\n"
+		"stall information, # to toggle the exited task panel, %% to cycle the percentile\n"
+		"columns, j to toggle the profile overlay, ! to write the --ring samples, q to\n"
 		"quit, any other key to force a refresh.\n\n"
 		"Options:\n"
 		"  -v, --version          show program's version number and exit\n"
@@ -122,6 +190,7 @@ static inline void print_help(void) {
 		"  -k, --kilobytes        use kilobytes instead of a human friendly unit\n"
 		"      --no-kilobytes     use human friendly unit\n"
 		"  -t, --time             add a timestamp on each line (implies --batch)\n"
+		"      --format=TYPE      batch output format (text, json or csv, implies --batch)\n"
 		"  -c, --fullcmdline      show full command line\n"
 		"      --no-fullcmdline   show program names only\n"
 		"  -1, --hide-pid         hide PID/TID column\n"
@@ -142,7 +211,33 @@ static inline void print_help(void) {
 		"      --show-graph       show GRAPH column\n"
 		"  -9, --hide-command     hide COMMAND column\n"
 		"      --show-command     show COMMAND column\n"
-		"  -g TYPE, --grtype=TYPE set graph data source (io, r, w, rw and sw)\n"
+		"      --net-write        show NET WRITE column\n"
+		"      --no-net-write     hide NET WRITE column\n"
+		"      --logical          show VFS READ, VFS WRITE, SYSCR and SYSCW columns\n"
+		"      --no-logical       hide VFS READ, VFS WRITE, SYSCR and SYSCW columns\n"
+		"      --delays           show CPU, MEM, THRASH, COMPACT, WPCOPY and IRQ delay columns\n"
+		"      --no-delays        hide CPU, MEM, THRASH, COMPACT, WPCOPY and IRQ delay columns\n"
+		"      --devices          show the block device panel\n"
+		"      --no-devices       hide the block device panel\n"
+		"      --psi              show the I/O and memory pressure stall information\n"
+		"      --no-psi           hide the I/O and memory pressure stall information\n"
+		"      --offenders[=KEY]  show the I/O of the exited tasks summed by KEY (cmd, user\n"
+		"                         or cgroup, default cmd); printed at exit in batch mode\n"
+		"      --no-offenders     hide the I/O of the exited tasks\n"
+		"      --percentiles[=P]  show the P percentile of the READ, WRITE and IO of each\n"
+		"                         interval (50, 95 or 99, default 99); printed at exit in\n"
+		"                         batch mode with all three percentiles\n"
+		"      --no-percentiles   hide the percentile columns\n"
+		"      --trigger=RULE:ACT run ACT when RULE holds, e.g. write>50M/3:exec=CMD; RULE is\n"
+		"                         [total-]read|write|io>LIMIT[/N], ACT is exec=CMD, dump=FILE\n"
+		"                         capture=SEC[/MS] or ring; can be given up to 8 times\n"
+		"      --ring=FILE[:N]    keep the last N samples in memory (default 30) and write\n"
+		"                         them to FILE.DATE-TIME on a ring trigger, the ! key or\n"
+		"                         SIGUSR1, then sample faster for --burst\n"
+		"      --burst=SEC[/MS]   sample every MS ms (default 100) for SEC seconds (default\n"
+		"                         10) after the ring is written, 0 disables\n"
+		"  -g TYPE, --grtype=TYPE set graph data source (io, r, w, rw, sw, nw, cpu, mem,\n"
+		"                         thrash, compact, wpcopy and irq)\n"
 		"  -R, --reverse-graph    reverse GRAPH column direction\n"
 		"      --no-reverse-graph do not reverse GRAPH column direction\n"
 		"  -q, --quiet            print column names only on the first run (implies --batch)\n"
@@ -163,6 +258,24 @@ static inline void print_help(void) {
 		"      --unicode          use Unicode drawing chars\n"
 		"  -N, --inverse          use inverse interface (black on white)\n"
 		"      --filter=REGEX     filter processes by TID and COMMAND\n"
+		"      --sampling         query idle tasks less often to bound collection cost\n"
+		"      --no-sampling      query all tasks on each iteration\n"
+		"      --collector=TYPE   per task data source (auto, netlink or procio)\n"
+		"      --collector-bench  compare the cost of the collectors per task and exit\n"
+		"      --record=FILE      record the samples to FILE\n"
+		"      --replay=FILE      show the samples recorded in FILE instead of the live data\n"
+		"      --replay-from=SEC  start the replay SEC seconds into the recording\n"
+		"      --export=ADDR      serve OpenMetrics over HTTP on [HOST:]PORT or unix:PATH\n"
+		"      --export-top=NUM   export NUM busiest processes, aggregate the rest (default 20)\n"
+		"      --daemon[=NAME]    collect and publish the samples in shared memory NAME (default iotop)\n"
+		"      --attach[=NAME]    show the samples published by the daemon instead of collecting\n"
+		"      --group=TYPE       show a row per group of tasks (none, cgroup or user)\n"
+		"      --cgroup=PATH      only show the tasks of cgroup PATH\n"
+		"      --cgroup-iostat    take DISK READ and DISK WRITE of the cgroups from io.stat\n"
+		"      --profile          time the phases of each iteration; show them in an\n"
+		"                         overlay or print a summary at exit in batch mode\n"
+		"      --bench=NUM        run the batch mode on NUM synthetic tasks as fast as possible\n"
+		"                         and report the cost of each phase (implies --profile)\n"
 		"  -W, --write            write preceding options to the config and exit\n",
 		progname
 	);
@@ -259,6 +372,40 @@ static inline void parse_args(int clac,char **clav) {
 				{"write",no_argument,NULL,'W'},
 				{"inverse",no_argument,NULL,'N'},
 				{"filter",required_argument,NULL,OPT_FILTER},
+				{"sampling",no_argument,NULL,OPT_SAMPLING},
+				{"no-sampling",no_argument,NULL,OPT_NO_SAMPLING},
+				{"collector",required_argument,NULL,OPT_COLLECTOR},
+				{"collector-bench",no_argument,NULL,OPT_COLLECTOR_BENCH},
+				{"net-write",no_argument,NULL,OPT_NET_WRITE},
+				{"no-net-write",no_argument,NULL,OPT_NO_NET_WRITE},
+				{"logical",no_argument,NULL,OPT_LOGICAL},
+				{"no-logical",no_argument,NULL,OPT_NO_LOGICAL},
+				{"delays",no_argument,NULL,OPT_DELAYS},
+				{"format",required_argument,NULL,OPT_FORMAT},
+				{"record",required_argument,NULL,OPT_RECORD},
+				{"replay",required_argument,NULL,OPT_REPLAY},
+				{"replay-from",required_argument,NULL,OPT_REPLAY_FROM},
+				{"export",required_argument,NULL,OPT_EXPORT},
+				{"export-top",required_argument,NULL,OPT_EXPORT_TOP},
+				{"daemon",optional_argument,NULL,OPT_DAEMON},
+				{"attach",optional_argument,NULL,OPT_ATTACH},
+				{"group",required_argument,NULL,OPT_GROUP},
+				{"cgroup",required_argument,NULL,OPT_CGROUP},
+				{"cgroup-iostat",no_argument,NULL,OPT_CGROUP_IOSTAT},
+				{"profile",no_argument,NULL,OPT_PROFILE},
+				{"bench",required_argument,NULL,OPT_BENCH},
+				{"no-delays",no_argument,NULL,OPT_NO_DELAYS},
+				{"devices",no_argument,NULL,OPT_DEVICES},
+				{"no-devices",no_argument,NULL,OPT_NO_DEVICES},
+				{"psi",no_argument,NULL,OPT_PSI},
+				{"no-psi",no_argument,NULL,OPT_NO_PSI},
+				{"offenders",optional_argument,NULL,OPT_OFFENDERS},
+				{"no-offenders",no_argument,NULL,OPT_NO_OFFENDERS},
+				{"percentiles",optional_argument,NULL,OPT_PERCENTILES},
+				{"no-percentiles",no_argument,NULL,OPT_NO_PERCENTILES},
+				{"trigger",required_argument,NULL,OPT_TRIGGER},
+				{"ring",required_argument,NULL,OPT_RING},
+				{"burst",required_argument,NULL,OPT_BURST},
 				{NULL,0,NULL,0}
 			};
 
@@ -337,6 +484,7 @@ static inline void parse_args(int clac,char **clav) {
 					break;
 				case 'g': // below values are not partial prefixes of each other, do a relaxed match
 					// except r is a prefix of rw, but r is matched first
+					// and c is a prefix of both cpu and compact, cpu is matched first
 					// do an exact match for r and w - there is no point in relaxed match for single letter values
 					if (!strncmp(optarg,"io",strlen(optarg)))
 						config.f.grtype=E_GR_IO;
@@ -348,6 +496,20 @@ static inline void parse_args(int clac,char **clav) {
 						config.f.grtype=E_GR_RW;
 					else if (!strncmp(optarg,"sw",strlen(optarg)))
 						config.f.grtype=E_GR_SW;
+					else if (!strncmp(optarg,"nw",strlen(optarg)))
+						config.f.grtype=E_GR_NW;
+					else if (!strncmp(optarg,"cpu",strlen(optarg)))
+						config.f.grtype=E_GR_CPU;
+					else if (!strncmp(optarg,"mem",strlen(optarg)))
+						config.f.grtype=E_GR_MEM;
+					else if (!strncmp(optarg,"thrash",strlen(optarg)))
+						config.f.grtype=E_GR_THRASH;
+					else if (!strncmp(optarg,"compact",strlen(optarg)))
+						config.f.grtype=E_GR_COMPACT;
+					else if (!strncmp(optarg,"wpcopy",strlen(optarg)))
+						config.f.grtype=E_GR_WPCOPY;
+					else if (!strncmp(optarg,"irq",strlen(optarg)))
+						config.f.grtype=E_GR_IRQ;
 					else {
 						fprintf(stderr,"%s: invalid value %s for graph type\n",progname,optarg);
 						exit(EXIT_FAILURE);
@@ -469,6 +631,213 @@ static inline void parse_args(int clac,char **clav) {
 						exit(EXIT_FAILURE);
 					}
 					break;
+				case OPT_SAMPLING:
+					config.f.sampling=1;
+					break;
+				case OPT_NO_SAMPLING:
+					config.f.sampling=0;
+					break;
+				case OPT_COLLECTOR:
+					if (!strcmp(optarg,"auto"))
+						params.collector=E_COL_AUTO;
+					else if (!strcmp(optarg,"netlink"))
+						params.collector=E_COL_NETLINK;
+					else if (!strcmp(optarg,"procio"))
+						params.collector=E_COL_PROCIO;
+					else {
+						fprintf(stderr,"%s: invalid value %s for collector\n",progname,optarg);
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case OPT_COLLECTOR_BENCH:
+					params.collector_bench=1;
+					break;
+				case OPT_NET_WRITE:
+					config.f.netwrite=1;
+					break;
+				case OPT_NO_NET_WRITE:
+					config.f.netwrite=0;
+					break;
+				case OPT_LOGICAL:
+					config.f.logical=1;
+					break;
+				case OPT_NO_LOGICAL:
+					config.f.logical=0;
+					break;
+				case OPT_DELAYS:
+					config.f.delays=1;
+					break;
+				case OPT_NO_DELAYS:
+					config.f.delays=0;
+					break;
+				case OPT_DEVICES:
+					config.f.devices=1;
+					break;
+				case OPT_NO_DEVICES:
+					config.f.devices=0;
+					break;
+				case OPT_PSI:
+					config.f.psi=1;
+					break;
+				case OPT_NO_PSI:
+					config.f.psi=0;
+					break;
+				case OPT_OFFENDERS:
+					config.f.offenders=1;
+					if (!optarg||!strcmp(optarg,"cmd"))
+						params.hh_key=E_HH_CMD;
+					else if (!strcmp(optarg,"user"))
+						params.hh_key=E_HH_USER;
+					else if (!strcmp(optarg,"cgroup"))
+						params.hh_key=E_HH_CGROUP;
+					else {
+						fprintf(stderr,"%s: invalid value %s for offenders\n",progname,optarg);
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case OPT_NO_OFFENDERS:
+					config.f.offenders=0;
+					break;
+				case OPT_PERCENTILES:
+					if (!optarg||!strcmp(optarg,"99"))
+						config.f.pctl=99;
+					else if (!strcmp(optarg,"95"))
+						config.f.pctl=95;
+					else if (!strcmp(optarg,"50"))
+						config.f.pctl=50;
+					else {
+						fprintf(stderr,"%s: invalid value %s for percentiles\n",progname,optarg);
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case OPT_NO_PERCENTILES:
+					config.f.pctl=0;
+					break;
+				case OPT_TRIGGER:
+					if (trigger_add(optarg)) {
+						fprintf(stderr,"%s: invalid value %s for trigger\n",progname,optarg);
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case OPT_RING: {
+					char *e=strrchr(optarg,':');
+
+					if (params.ring_file)
+						free(params.ring_file);
+					params.ring_file=strdup(optarg);
+					if (!params.ring_file) {
+						fprintf(stderr,"%s: out of memory\n",progname);
+						exit(EXIT_FAILURE);
+					}
+					if (e) {
+						params.ring_file[e-optarg]=0;
+						params.ring_size=atoi(e+1);
+					}
+					if (!*params.ring_file||params.ring_size<1) {
+						fprintf(stderr,"%s: invalid value %s for ring\n",progname,optarg);
+						exit(EXIT_FAILURE);
+					}
+					break;
+				}
+				case OPT_BURST: {
+					char *e;
+
+					params.burst_s=strtol(optarg,&e,10);
+					if (*e=='/')
+						params.burst_ms=strtol(e+1,&e,10);
+					if (e==optarg||*e||params.burst_s<0||params.burst_ms<10) {
+						fprintf(stderr,"%s: invalid value %s for burst\n",progname,optarg);
+						exit(EXIT_FAILURE);
+					}
+					break;
+				}
+				case OPT_RECORD:
+				case OPT_REPLAY:
+				case OPT_EXPORT:
+				case OPT_DAEMON:
+				case OPT_ATTACH: {
+					char **f;
+
+					switch (c) {
+						case OPT_RECORD:
+							f=&params.record_file;
+							break;
+						case OPT_REPLAY:
+							f=&params.replay_file;
+							break;
+						case OPT_EXPORT:
+							f=&params.export_addr;
+							break;
+						case OPT_DAEMON:
+							f=&params.daemon_name;
+							break;
+						default:
+							f=&params.attach;
+							break;
+					}
+					if (*f)
+						free(*f);
+					*f=strdup(optarg?optarg:"iotop");
+					if (!*f) {
+						fprintf(stderr,"%s: out of memory\n",progname);
+						exit(EXIT_FAILURE);
+					}
+					break;
+				}
+				case OPT_REPLAY_FROM:
+					params.replay_from=atoi(optarg);
+					break;
+				case OPT_EXPORT_TOP:
+					params.export_top=atoi(optarg);
+					if (params.export_top<0)
+						params.export_top=0;
+					break;
+				case OPT_GROUP:
+					if (!strcmp(optarg,"none"))
+						params.group=E_GRP_NONE;
+					else if (!strcmp(optarg,"cgroup"))
+						params.group=E_GRP_CGROUP;
+					else if (!strcmp(optarg,"user"))
+						params.group=E_GRP_USER;
+					else {
+						fprintf(stderr,"%s: invalid value %s for group\n",progname,optarg);
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case OPT_CGROUP:
+					if (params.cgroup)
+						free(params.cgroup);
+					params.cgroup=strdup(optarg);
+					if (!params.cgroup) {
+						fprintf(stderr,"%s: out of memory\n",progname);
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case OPT_CGROUP_IOSTAT:
+					params.cgroup_iostat=1;
+					break;
+				case OPT_PROFILE:
+					params.profile=1;
+					break;
+				case OPT_BENCH:
+					params.bench=atoi(optarg);
+					if (params.bench<1) {
+						fprintf(stderr,"%s: invalid value %s for bench\n",progname,optarg);
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case OPT_FORMAT:
+					if (!strcmp(optarg,"text"))
+						params.format=E_FMT_TEXT;
+					else if (!strcmp(optarg,"json"))
+						params.format=E_FMT_JSON;
+					else if (!strcmp(optarg,"csv"))
+						params.format=E_FMT_CSV;
+					else {
+						fprintf(stderr,"%s: invalid value %s for format\n",progname,optarg);
+						exit(EXIT_FAILURE);
+					}
+					break;
 				default:
 					exit(EXIT_FAILURE);
 			}
@@ -480,11 +849,17 @@ inline void sig_handler(int signo) {
 	switch (signo) {
 		default:
 			break;
+		case SIGUSR1:
+			ring_signal();
+			break;
 		case SIGINT:
 		case SIGHUP:
 		case SIGQUIT:
+		case SIGTERM:
 			v_fini_cb();
-			nl_fini();
+			record_close();
+			collector_fini();
+			pidgen_fini();
 			exit(EXIT_SUCCESS);
 	}
 }
@@ -493,11 +868,49 @@ int main(int argc,char *argv[]) {
 	progname=argv[0];
 
 	parse_args(argc,argv);
-	if (system_checks())
+	if (params.daemon_name&&(params.record_file||params.export_addr||replaying())) {
+		fprintf(stderr,"%s: --daemon can not be combined with --record, --export, --replay or --attach\n",progname);
+		return EXIT_FAILURE;
+	}
+	if (params.attach&&params.replay_file) {
+		fprintf(stderr,"%s: --attach can not be combined with --replay\n",progname);
+		return EXIT_FAILURE;
+	}
+	if (params.bench&&(replaying()||params.daemon_name||params.export_addr||params.cgroup)) {
+		fprintf(stderr,"%s: --bench can not be combined with --replay, --attach, --daemon, --export or --cgroup\n",progname);
+		return EXIT_FAILURE;
+	}
+	if (params.cgroup&&replaying()) {
+		fprintf(stderr,"%s: --cgroup can not be combined with --replay or --attach\n",progname);
+		return EXIT_FAILURE;
+	}
+	// the cgroups are not recorded and the exporter has its own aggregation
+	if ((params.group==E_GRP_CGROUP&&(replaying()||params.bench))||params.export_addr||params.daemon_name)
+		params.group=E_GRP_NONE;
+	if (params.bench) { // the synthetic tasks are not in /proc
+		config.f.batch_mode=1;
+		config.f.sampling=0;
+		params.profile=1;
+		if (params.iter==-1)
+			params.iter=10;
+	} else if (!replaying()&&system_checks())
+		return EXIT_FAILURE;
+	if (params.record_file&&record_open(params.record_file))
+		return EXIT_FAILURE;
+	if (params.ring_file&&ring_open())
+		return EXIT_FAILURE;
+	if (params.export_addr&&export_open(params.export_addr))
+		return EXIT_FAILURE;
+	if (params.daemon_name&&daemon_open(params.daemon_name))
 		return EXIT_FAILURE;
 
 	setlocale(LC_ALL,"");
-	nl_init();
+	if (params.collector_bench) {
+		collector_bench();
+		pidgen_fini();
+		return EXIT_SUCCESS;
+	}
+	collector_init();
 
 	if (signal(SIGINT,sig_handler)==SIG_ERR)
 		perror("signal");
@@ -505,11 +918,23 @@ int main(int argc,char *argv[]) {
 		perror("signal");
 	if (signal(SIGQUIT,sig_handler)==SIG_ERR)
 		perror("signal");
+	if (signal(SIGTERM,sig_handler)==SIG_ERR)
+		perror("signal");
+	if (params.ring_file&&signal(SIGUSR1,sig_handler)==SIG_ERR)
+		perror("signal");
 
-	if (config.f.timestamp||config.f.quiet)
+	if (config.f.timestamp||config.f.quiet||params.format!=E_FMT_TEXT)
 		config.f.batch_mode=1;
 
-	if (config.f.batch_mode) {
+	if (params.daemon_name) {
+		v_init_cb=view_daemon_init;
+		v_fini_cb=view_daemon_fini;
+		v_loop_cb=view_daemon_loop;
+	} else if (params.export_addr) {
+		v_init_cb=view_export_init;
+		v_fini_cb=view_export_fini;
+		v_loop_cb=view_export_loop;
+	} else if (config.f.batch_mode) {
 		v_init_cb=view_batch_init;
 		v_fini_cb=view_batch_fini;
 		v_loop_cb=view_batch_loop;
@@ -518,7 +943,15 @@ int main(int argc,char *argv[]) {
 	v_init_cb();
 	v_loop_cb();
 	v_fini_cb();
-	nl_fini();
+	record_close();
+	collector_fini();
+	cgroup_fini();
+	diskstats_fini();
+	vmstat_fini();
+	psi_fini();
+	hitters_fini();
+	trigger_fini();
+	pidgen_fini();
 
 	return 0;
 }
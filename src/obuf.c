@@ -0,0 +1,367 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+
+#include <math.h>
+#include <errno.h>
+#include <stdio.h>
+#include <locale.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// output buffer of the batch view; numbers are converted in place and the
+// whole buffer goes out with a single write when it is full or at the end
+// of an iteration
+
+#define OBUF_SIZE 65536
+
+static char ob[OBUF_SIZE];
+static size_t ob_len=0;
+
+// while capturing, flushed data is collected in memory instead of written out
+static int ob_cap=0;
+static char *cap=NULL;
+static size_t cap_len=0;
+static size_t cap_size=0;
+static int cap_err=0;
+
+static inline void cap_add(void) {
+	if (cap_len+ob_len>cap_size) {
+		size_t ns=cap_size?cap_size:OBUF_SIZE;
+		char *t;
+
+		while (ns<cap_len+ob_len)
+			ns*=2;
+		t=realloc(cap,ns);
+		if (!t) {
+			cap_err=1;
+			ob_len=0;
+			return;
+		}
+		cap=t;
+		cap_size=ns;
+	}
+	memcpy(cap+cap_len,ob,ob_len);
+	cap_len+=ob_len;
+	ob_len=0;
+}
+
+inline void obuf_flush(void) {
+	size_t o=0;
+
+	if (ob_cap) {
+		cap_add();
+		return;
+	}
+	while (o<ob_len) {
+		ssize_t n=write(STDOUT_FILENO,ob+o,ob_len-o);
+
+		if (n==-1) {
+			if (errno==EINTR)
+				continue;
+			break; // nothing sensible to do, drop the data
+		}
+		o+=n;
+	}
+	ob_len=0;
+}
+
+inline void obuf_put(const char *s,size_t len) {
+	while (len) {
+		size_t n=OBUF_SIZE-ob_len;
+
+		if (n>len)
+			n=len;
+		memcpy(ob+ob_len,s,n);
+		ob_len+=n;
+		s+=n;
+		len-=n;
+		if (ob_len==OBUF_SIZE)
+			obuf_flush();
+	}
+}
+
+inline void obuf_str(const char *s) {
+	obuf_put(s,strlen(s));
+}
+
+inline void obuf_chr(char c) {
+	if (ob_len==OBUF_SIZE)
+		obuf_flush();
+	ob[ob_len++]=c;
+}
+
+// the digits of v end at e, returns where they start
+static inline char *ob_dig(char *e,uint64_t v) {
+	do {
+		*--e='0'+v%10;
+		v/=10;
+	} while (v);
+	return e;
+}
+
+// s right aligned in width columns, left aligned for a negative width
+static inline void ob_pad(const char *s,size_t len,int width) {
+	size_t w=width<0?-(size_t)width:(size_t)width;
+
+	if (width<0)
+		obuf_put(s,len);
+	for (;w>len;w--)
+		obuf_chr(' ');
+	if (width>=0)
+		obuf_put(s,len);
+}
+
+inline void obuf_u64(uint64_t v) {
+	char t[20];
+	char *b=ob_dig(t+sizeof t,v);
+
+	obuf_put(b,t+sizeof t-b);
+}
+
+inline void obuf_i64(int64_t v) {
+	if (v<0) {
+		obuf_chr('-');
+		obuf_u64(-(uint64_t)v);
+	} else
+		obuf_u64(v);
+}
+
+// printf("%*lld") and printf("%*s")
+inline void obuf_i64w(int64_t v,int width) {
+	char t[21];
+	char *b=ob_dig(t+sizeof t,v<0?-(uint64_t)v:(uint64_t)v);
+
+	if (v<0)
+		*--b='-';
+	ob_pad(b,t+sizeof t-b,width);
+}
+
+inline void obuf_strw(const char *s,int width) {
+	ob_pad(s,strlen(s),width);
+}
+
+// for the lines written once per iteration
+inline void obuf_printf(const char *fmt,...) {
+	va_list ap;
+	char *t;
+	int n;
+
+	va_start(ap,fmt);
+	n=vsnprintf(ob+ob_len,OBUF_SIZE-ob_len,fmt,ap);
+	va_end(ap);
+	if (n<0)
+		return;
+	if ((size_t)n<OBUF_SIZE-ob_len) {
+		ob_len+=n;
+		return;
+	}
+	t=malloc(n+1);
+	if (!t)
+		return;
+	va_start(ap,fmt);
+	vsnprintf(t,n+1,fmt,ap);
+	va_end(ap);
+	obuf_put(t,n);
+	free(t);
+}
+
+// fixed point with prec decimals, prec<=6; values out of the uint64_t
+// range are not expected here and are clamped
+inline void obuf_fix(double v,int prec) {
+	static const uint64_t p10[]={1,10,100,1000,10000,100000,1000000};
+	uint64_t ip,fp;
+	char t[6];
+	int i;
+
+	if (v!=v) // NaN
+		v=0;
+	if (v<0) {
+		obuf_chr('-');
+		v=-v;
+	}
+	if (v>=18446744073709551615.0/p10[prec])
+		v=18446744073709551615.0/p10[prec]-1;
+	fp=(uint64_t)(v*p10[prec]+0.5);
+	ip=fp/p10[prec];
+	fp%=p10[prec];
+	obuf_u64(ip);
+	if (!prec)
+		return;
+	obuf_chr('.');
+	for (i=prec-1;i>=0;i--) {
+		t[i]='0'+fp%10;
+		fp/=10;
+	}
+	obuf_put(t,prec);
+}
+
+// printf("%*.*f") with the decimal point of the locale, prec<=6; printf
+// rounds the exact binary value, so the values that are about half way
+// between two outputs, too large or not finite are left to it
+inline void obuf_fixw(double v,int prec,int width) {
+	static const uint64_t p10[]={1,10,100,1000,10000,100000,1000000};
+	static char dp=0;
+	double a=fabs(v);
+	double sc=a*p10[prec];
+	char t[40];
+	uint64_t fp;
+	char *b;
+	int i;
+
+	if (!dp) {
+		const char *d=localeconv()->decimal_point;
+
+		dp=d&&d[0]&&!d[1]?d[0]:-1; // -1 for a multibyte one
+	}
+	if (dp==-1||!(sc<1e12)||fabs(sc-(uint64_t)sc-0.5)<1e-3) {
+		obuf_printf("%*.*f",width,prec,v);
+		return;
+	}
+	fp=sc+0.5;
+	b=t+sizeof t;
+	for (i=0;i<prec;i++) {
+		*--b='0'+fp%10;
+		fp/=10;
+	}
+	if (prec)
+		*--b=dp;
+	b=ob_dig(b,fp);
+	if (signbit(v))
+		*--b='-';
+	ob_pad(b,t+sizeof t-b,width);
+}
+
+// JSON string with the quotes; bytes above 0x7f are passed as they are
+// length of the valid UTF-8 sequence at s, 0 if it is not one; overlong
+// forms, surrogates and code points over U+10FFFF are not valid
+static inline int u8_seq(const unsigned char *s) {
+	unsigned lo=0x80,hi=0xbf;
+	int n,i;
+
+	if (*s>=0xc2&&*s<=0xdf)
+		n=2;
+	else if (*s>=0xe0&&*s<=0xef) {
+		n=3;
+		if (*s==0xe0)
+			lo=0xa0;
+		if (*s==0xed)
+			hi=0x9f;
+	} else if (*s>=0xf0&&*s<=0xf4) {
+		n=4;
+		if (*s==0xf0)
+			lo=0x90;
+		if (*s==0xf4)
+			hi=0x8f;
+	} else
+		return 0;
+	if (s[1]<lo||s[1]>hi)
+		return 0;
+	for (i=2;i<n;i++)
+		if (s[i]<0x80||s[i]>0xbf)
+			return 0;
+	return n;
+}
+
+// the command lines are not necessarily UTF-8, a byte that does not start
+// a valid sequence is escaped as the code point of the same value
+inline void obuf_json(const char *s) {
+	static const char hex[]="0123456789abcdef";
+	const char *b=s;
+
+	obuf_chr('"');
+	for (;*s;s++) {
+		unsigned char c=*s;
+
+		if (c>=0x80) {
+			int n=u8_seq((const unsigned char *)s);
+
+			if (n) {
+				s+=n-1;
+				continue;
+			}
+		} else if (c>=0x20&&c!='"'&&c!='\\')
+			continue;
+		obuf_put(b,s-b);
+		b=s+1;
+		obuf_chr('\\');
+		switch (c) {
+			case '"':
+			case '\\':
+				obuf_chr(c);
+				break;
+			case '\n':
+				obuf_chr('n');
+				break;
+			case '\t':
+				obuf_chr('t');
+				break;
+			default:
+				obuf_put("u00",3);
+				obuf_chr(hex[c>>4]);
+				obuf_chr(hex[c&15]);
+				break;
+		}
+	}
+	obuf_put(b,s-b);
+	obuf_chr('"');
+}
+
+// CSV field as in RFC 4180, quoted only when needed
+inline void obuf_csv(const char *s) {
+	const char *b=s;
+
+	if (!s[strcspn(s,",\"\r\n")]) {
+		obuf_str(s);
+		return;
+	}
+	obuf_chr('"');
+	for (;*s;s++)
+		if (*s=='"') {
+			obuf_put(b,s-b+1);
+			obuf_chr('"');
+			b=s+1;
+		}
+	obuf_put(b,s-b);
+	obuf_chr('"');
+}
+
+// start collecting the output in memory
+inline void obuf_capture(void) {
+	obuf_flush();
+	ob_cap=1;
+	cap_len=0;
+	cap_err=0;
+}
+
+// stop collecting and hand over the collected output; NULL when out of memory
+inline char *obuf_captured(size_t *len) {
+	char *r;
+
+	obuf_flush();
+	ob_cap=0;
+	r=cap;
+	if (cap_err) {
+		free(cap);
+		r=NULL;
+		cap_len=0;
+	}
+	*len=cap_len;
+	cap=NULL;
+	cap_len=0;
+	cap_size=0;
+	return r;
+}
@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+
+#include <fcntl.h>
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+// /proc is walked with raw getdents64 relative to a cached dirfd; this avoids
+// the DIR allocation, the full path lookup and the strtol call per entry that
+// opendir/readdir based walking has, and keeps the number of syscalls per
+// process down to openat+getdents64+close for its task directory
+
+// big enough to get a few thousand entries per syscall
+#define PG_PBUFSIZ (128*1024)
+#define PG_TBUFSIZ (64*1024)
+
+struct pg_dirent64 { // the kernel struct linux_dirent64 is not exposed by libc
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+static int proc_fd=-1;
+static char *pg_pbuf=NULL; // /proc listing buffer
+static char *pg_tbuf=NULL; // /proc/<pid>/task listing buffer
+
+inline int proc_dirfd(void) {
+	if (proc_fd==-1)
+		proc_fd=open("/proc",O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+	return proc_fd;
+}
+
+static inline long pg_getdents(int fd,char *buf,size_t sz) {
+	return syscall(SYS_getdents64,fd,buf,sz);
+}
+
+// parse a directory name that consists of decimal digits only
+// returns 0 for anything else like "self", "." or "sys"
+static inline int pg_parse_id(const char *s,pid_t *id) {
+	pid_t v=0;
+
+	if (*s<'0'||*s>'9')
+		return 0;
+	do
+		v=v*10+(*s++-'0');
+	while (*s>='0'&&*s<='9');
+	if (*s)
+		return 0;
+	*id=v;
+	return 1;
+}
+
+static inline int pg_walk_tasks(int pfd,pid_t pid,const char *name,pg_cb cb,struct xxxid_stats_arr *hint1,filter_callback hint2) {
+	char path[32];
+	size_t nl=strlen(name);
+	int havt=0;
+	int tfd;
+
+	if (nl+sizeof "/task">sizeof path)
+		return 0;
+	memcpy(path,name,nl);
+	memcpy(path+nl,"/task",sizeof "/task");
+
+	tfd=openat(pfd,path,O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+	if (tfd==-1)
+		return 0;
+	for (;;) {
+		long n=pg_getdents(tfd,pg_tbuf,PG_TBUFSIZ);
+		long o;
+
+		if (n<=0)
+			break;
+		for (o=0;o<n;) {
+			struct pg_dirent64 *de=(struct pg_dirent64 *)(pg_tbuf+o);
+			pid_t tid;
+
+			o+=de->d_reclen;
+			if (!pg_parse_id(de->d_name,&tid))
+				continue;
+			havt=1;
+			cb(pid,tid,hint1,hint2);
+		}
+	}
+	close(tfd);
+	return havt;
+}
+
+inline void pidgen_cb(pg_cb cb,struct xxxid_stats_arr *hint1,filter_callback hint2) {
+	int pfd=proc_dirfd();
+
+	if (pfd==-1)
+		return;
+	if (!pg_pbuf)
+		pg_pbuf=malloc(PG_PBUFSIZ);
+	if (!pg_tbuf)
+		pg_tbuf=malloc(PG_TBUFSIZ);
+	if (!pg_pbuf||!pg_tbuf)
+		return;
+	if (lseek(pfd,0,SEEK_SET)==-1)
+		return;
+
+	for (;;) {
+		long n=pg_getdents(pfd,pg_pbuf,PG_PBUFSIZ);
+		long o;
+
+		if (n<=0)
+			break;
+		for (o=0;o<n;) {
+			struct pg_dirent64 *de=(struct pg_dirent64 *)(pg_pbuf+o);
+			pid_t pid;
+
+			o+=de->d_reclen;
+			if (de->d_type!=DT_DIR&&de->d_type!=DT_UNKNOWN)
+				continue;
+			if (!pg_parse_id(de->d_name,&pid))
+				continue;
+			if (!pg_walk_tasks(pfd,pid,de->d_name,cb,hint1,hint2))
+				cb(pid,pid,hint1,hint2);
+		}
+	}
+}
+
+inline void pidgen_fini(void) {
+	if (proc_fd!=-1)
+		close(proc_fd);
+	proc_fd=-1;
+	if (pg_pbuf)
+		free(pg_pbuf);
+	pg_pbuf=NULL;
+	if (pg_tbuf)
+		free(pg_tbuf);
+	pg_tbuf=NULL;
+}
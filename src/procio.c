@@ -0,0 +1,301 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+
+// /proc/<pid>/task/<tid>/io collector; works without root or NET_ADMIN for
+// the tasks of the current user and where netlink taskstats are unavailable
+//
+// /proc/<tid>/io would report the whole thread group, so the per task file
+// is used; the files are kept open and re-read with pread, this needs a single
+// syscall per task and cycle instead of open+read+close
+
+#define PROCIO_TBL_INI 1024 // initial fd table size, power of 2
+#define PROCIO_FD_RESERVE 64 // fds left for everything else
+#define PROCIO_KEEP 32 // close fds of tasks not queried for that many cycles
+
+struct procio_ent {
+	pid_t tid; // 0 marks an empty slot
+	int fd; // -1 if the file could not be reopened
+	int euid; // owner of the file at open time
+	unsigned seen; // cycle of the last query
+};
+
+static struct procio_ent *pi_tbl=NULL;
+static unsigned pi_size=0; // table size, power of 2
+static unsigned pi_used=0; // occupied slots
+static unsigned pi_max=0; // max fds to keep open
+static unsigned pi_cycle=0;
+static int pi_ref=0; // the netlink collector opens it too, see nl_col_info
+
+static const struct {
+	const char *key;
+	size_t len;
+	size_t ofs;
+} pi_keys[]={ // in the order the kernel prints them
+	{"rchar",5,offsetof(struct xxxid_stats,read_char)},
+	{"wchar",5,offsetof(struct xxxid_stats,write_char)},
+	{"syscr",5,offsetof(struct xxxid_stats,read_syscalls)},
+	{"syscw",5,offsetof(struct xxxid_stats,write_syscalls)},
+	{"read_bytes",10,offsetof(struct xxxid_stats,read_bytes)},
+	{"write_bytes",11,offsetof(struct xxxid_stats,write_bytes)},
+	{"cancelled_write_bytes",21,offsetof(struct xxxid_stats,cancelled_write_bytes)},
+};
+
+#define PI_NKEYS (sizeof pi_keys/sizeof *pi_keys)
+
+static inline struct procio_ent *pi_slot(struct procio_ent *tbl,unsigned size,pid_t tid) {
+	unsigned i=((unsigned)tid*2654435761u)&(size-1);
+
+	while (tbl[i].tid&&tbl[i].tid!=tid)
+		i=(i+1)&(size-1);
+	return tbl+i;
+}
+
+// move all live entries into a new table of size sz, drop the ones
+// with closed fds; open addressing does not support cheap deletion
+static inline int pi_rehash(unsigned sz) {
+	struct procio_ent *n=calloc(sz,sizeof *n);
+	unsigned i;
+
+	if (!n)
+		return -1;
+	pi_used=0;
+	for (i=0;i<pi_size;i++)
+		if (pi_tbl[i].tid&&pi_tbl[i].fd!=-1) {
+			*pi_slot(n,sz,pi_tbl[i].tid)=pi_tbl[i];
+			pi_used++;
+		}
+	free(pi_tbl);
+	pi_tbl=n;
+	pi_size=sz;
+	return 0;
+}
+
+static inline int pi_open(pid_t tid,pid_t pid,int *euid) {
+	struct stat st;
+	char path[48];
+	int fd;
+
+	snprintf(path,sizeof path,"%d/task/%d/io",pid,tid);
+	fd=openat(proc_dirfd(),path,O_RDONLY|O_CLOEXEC);
+	if (fd==-1)
+		return -1;
+	*euid=fstat(fd,&st)?0:(int)st.st_uid;
+	return fd;
+}
+
+static inline int pi_parse(char *b,ssize_t n,struct xxxid_stats *s) {
+	char *e=b+n;
+	size_t k=0;
+	int got=0;
+
+	while (b<e) {
+		char *c=memchr(b,':',e-b);
+		uint64_t v=0;
+		size_t i;
+
+		if (!c)
+			break;
+		for (i=0;i<PI_NKEYS;i++) { // start from the expected key
+			size_t j=(k+i)%PI_NKEYS;
+
+			if (pi_keys[j].len==(size_t)(c-b)&&!memcmp(b,pi_keys[j].key,pi_keys[j].len)) {
+				k=j;
+				break;
+			}
+		}
+		for (b=c+1;b<e&&*b==' ';b++)
+			;
+		for (;b<e&&*b>='0'&&*b<='9';b++)
+			v=v*10+(*b-'0');
+		if (i<PI_NKEYS) {
+			*(uint64_t *)((char *)s+pi_keys[k].ofs)=v;
+			got++;
+			k=(k+1)%PI_NKEYS;
+		}
+		while (b<e&&*b!='\n')
+			b++;
+		b++;
+	}
+	return got;
+}
+
+static inline ssize_t pi_read(int fd,char *buf,size_t sz) {
+	ssize_t n;
+
+	do
+		n=pread(fd,buf,sz,0);
+	while (n==-1&&errno==EINTR);
+	return n;
+}
+
+inline int procio_init(void) {
+	struct rlimit rl;
+
+	if (pi_ref) {
+		pi_ref++;
+		return 0;
+	}
+	if (proc_dirfd()==-1||!is_a_file("/proc/self/io"))
+		return -1;
+
+	if (!getrlimit(RLIMIT_NOFILE,&rl)&&rl.rlim_cur!=RLIM_INFINITY) {
+		if (rl.rlim_cur>PROCIO_FD_RESERVE)
+			pi_max=rl.rlim_cur-PROCIO_FD_RESERVE;
+		else
+			pi_max=0;
+	} else
+		pi_max=65536;
+
+	pi_size=PROCIO_TBL_INI;
+	pi_used=0;
+	pi_tbl=calloc(pi_size,sizeof *pi_tbl);
+	if (!pi_tbl)
+		return -1;
+	pi_ref=1;
+	return 0;
+}
+
+inline void procio_fini(void) {
+	unsigned i;
+
+	if (pi_ref&&--pi_ref)
+		return;
+	if (!pi_tbl)
+		return;
+	for (i=0;i<pi_size;i++)
+		if (pi_tbl[i].tid&&pi_tbl[i].fd!=-1)
+			close(pi_tbl[i].fd);
+	free(pi_tbl);
+	pi_tbl=NULL;
+	pi_size=pi_used=0;
+}
+
+inline void procio_cycle(void) {
+	unsigned drop=0;
+	unsigned i;
+
+	if (!pi_tbl)
+		return;
+	pi_cycle++;
+	if (pi_cycle%PROCIO_KEEP)
+		return;
+	for (i=0;i<pi_size;i++)
+		if (pi_tbl[i].tid&&pi_tbl[i].fd!=-1&&pi_cycle-pi_tbl[i].seen>PROCIO_KEEP) {
+			close(pi_tbl[i].fd);
+			pi_tbl[i].fd=-1;
+		}
+	for (i=0;i<pi_size;i++)
+		if (pi_tbl[i].tid&&pi_tbl[i].fd==-1)
+			drop++;
+	if (drop)
+		pi_rehash(pi_size);
+}
+
+// the content of the io file of the task, from the cached fd if possible
+static inline ssize_t pi_fetch(pid_t tid,pid_t pid,char *buf,size_t sz,int *euid) {
+	struct procio_ent *pe=NULL;
+	ssize_t n;
+	int fd;
+
+	if (pi_tbl) {
+		pe=pi_slot(pi_tbl,pi_size,tid);
+		if (!pe->tid)
+			pe=NULL;
+	}
+
+	if (pe&&pe->fd!=-1) {
+		pe->seen=pi_cycle;
+		n=pi_read(pe->fd,buf,sz);
+		if (n>0) {
+			*euid=pe->euid;
+			return n;
+		}
+		// the task is gone, the tid may have been reused
+		close(pe->fd);
+		pe->fd=-1;
+	}
+
+	fd=pi_open(tid,pid,euid);
+	if (fd==-1)
+		return -1;
+	n=pi_read(fd,buf,sz);
+	if (n<=0) {
+		close(fd);
+		return -1;
+	}
+
+	if (pe) { // reuse the slot
+		pe->fd=fd;
+		pe->euid=*euid;
+	} else if (pi_tbl&&pi_used<pi_max) {
+		if ((pi_used+1)*2>pi_size&&pi_rehash(pi_size*2))
+			close(fd);
+		else {
+			pe=pi_slot(pi_tbl,pi_size,tid);
+			pe->tid=tid;
+			pe->fd=fd;
+			pe->euid=*euid;
+			pe->seen=pi_cycle;
+			pi_used++;
+		}
+	} else // out of fds, do not cache
+		close(fd);
+	return n;
+}
+
+inline int procio_xxxid_info(pid_t tid,pid_t pid,struct xxxid_stats *stats) {
+	char buf[512];
+	ssize_t n;
+	int euid;
+
+	stats->pid=pid;
+	stats->tid=tid;
+
+	n=pi_fetch(tid,pid,buf,sizeof buf-1,&euid);
+	if (n<=0)
+		return -1;
+	stats->euid=euid;
+	return pi_parse(buf,n,stats)?0:-1;
+}
+
+// only syscr and syscw, taskstats rounds them down to a multiple of 1024
+inline int procio_syscalls(pid_t tid,pid_t pid,struct xxxid_stats *stats) {
+	struct xxxid_stats t; // pi_parse sets the found fields only
+	char buf[512];
+	ssize_t n;
+	int euid;
+
+	n=pi_fetch(tid,pid,buf,sizeof buf-1,&euid);
+	if (n<=0)
+		return -1;
+	t.read_syscalls=stats->read_syscalls;
+	t.write_syscalls=stats->write_syscalls;
+	if (!pi_parse(buf,n,&t))
+		return -1;
+	stats->read_syscalls=t.read_syscalls;
+	stats->write_syscalls=t.write_syscalls;
+	return 0;
+}
@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define PROF_DEPTH 8 // phases nest, e.g. collect inside pidgen
+
+static const char *prof_name[PROF_MAX]={
+	[PROF_PIDGEN]="pidgen",
+	[PROF_COLLECT]="collect",
+	[PROF_CMDLINE]="cmdline",
+	[PROF_FILTER]="filter",
+	[PROF_DIFF]="diff",
+	[PROF_SORT]="sort",
+	[PROF_RENDER]="render",
+};
+
+static struct prof_stats prof_st[PROF_MAX];
+static uint64_t prof_nest[PROF_DEPTH]; // time spent in the nested phases
+static int prof_depth=0;
+
+// returns 0 when profiling is off, prof_end ignores that
+inline uint64_t prof_start(void) {
+	if (!params.profile||prof_depth>=PROF_DEPTH)
+		return 0;
+	prof_nest[prof_depth++]=0;
+	return monotime_ns();
+}
+
+// the time of the nested phases is not counted twice, so the phases
+// add up to the profiled total
+inline void prof_end(int phase,uint64_t start) {
+	struct prof_stats *p=prof_st+phase;
+	uint64_t d,self;
+
+	if (!start||!prof_depth)
+		return;
+	d=monotime_ns()-start;
+	prof_depth--;
+	self=d>prof_nest[prof_depth]?d-prof_nest[prof_depth]:0;
+	if (prof_depth)
+		prof_nest[prof_depth-1]+=d;
+	p->cnt++;
+	p->total+=self;
+	if (self>p->max)
+		p->max=self;
+}
+
+inline const struct prof_stats *prof_get(int phase) {
+	if (phase<0||phase>=PROF_MAX)
+		return NULL;
+	return prof_st+phase;
+}
+
+inline const char *prof_phase(int phase) {
+	return prof_name[phase];
+}
+
+inline void prof_reset(void) {
+	memset(prof_st,0,sizeof prof_st);
+}
+
+// one line of the profile table, phase PROF_MAX is the header
+inline void prof_line(char *buf,size_t len,int phase) {
+	const struct prof_stats *p=prof_get(phase);
+	uint64_t all=0;
+	int i;
+
+	if (!p) {
+		snprintf(buf,len,"%-8s %10s %11s %10s %10s %6s","PHASE","COUNT","TOTAL ms","AVG us","MAX us","%");
+		return;
+	}
+	for (i=0;i<PROF_MAX;i++)
+		all+=prof_st[i].total;
+	snprintf(buf,len,"%-8s %10llu %11.1f %10.1f %10.1f %6.2f",prof_name[phase],(unsigned long long)p->cnt,p->total/1e6,p->cnt?p->total/1e3/p->cnt:0,p->max/1e3,all?100.0*p->total/all:0);
+}
+
+inline void prof_summary(void) {
+	char buf[128];
+	int i;
+
+	prof_line(buf,sizeof buf,PROF_MAX);
+	fprintf(stderr,"%s\n",buf);
+	for (i=0;i<PROF_MAX;i++) {
+		prof_line(buf,sizeof buf,i);
+		fprintf(stderr,"%s\n",buf);
+	}
+}
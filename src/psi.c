@@ -0,0 +1,135 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *psi_file[PSI_MAX]={
+	[PSI_IO]="/proc/pressure/io",
+	[PSI_MEM]="/proc/pressure/memory",
+};
+
+struct psi_res {
+	struct psi_stats s;
+	int fd; // kept open, reread from the start on each update
+	int ok; // s is valid
+	int have_t; // some_t and full_t hold a previous read
+	uint64_t some_t; // us
+	uint64_t full_t;
+};
+
+static struct psi_res psi_res[PSI_MAX]={{.fd=-1},{.fd=-1}};
+static int64_t psi_ts=0; // monotime of the last update
+
+// "some avg10=N avg60=N avg300=N total=N" and the same for "full", the
+// latter is missing for cpu and on old kernels
+inline int psi_parse(char *buf,double *some10,double *full10,uint64_t *some_t,uint64_t *full_t) {
+	int found=0;
+	char *l,*e;
+
+	*some10=*full10=0;
+	*some_t=*full_t=0;
+	for (l=buf;*l;l=e) {
+		int some=!strncmp(l,"some ",5);
+		int full=!strncmp(l,"full ",5);
+		char *v;
+
+		e=strchr(l,'\n');
+		if (e)
+			*e++=0;
+		else
+			e=l+strlen(l);
+		if (!some&&!full)
+			continue;
+		if ((v=strstr(l," avg10=")))
+			*(some?some10:full10)=strtod(v+7,NULL);
+		if ((v=strstr(l," total=")))
+			*(some?some_t:full_t)=strtoull(v+7,NULL,10);
+		if (some)
+			found=1;
+	}
+	return found?0:-1;
+}
+
+// read an already open pressure file into buf
+inline int psi_read(int fd,char *buf,size_t sz) {
+	ssize_t n=pread(fd,buf,sz-1,0);
+
+	if (n<=0)
+		return -1;
+	buf[n]=0;
+	return 0;
+}
+
+static inline double psi_pc(uint64_t c,uint64_t p,double time_s) {
+	double v=c>=p?(c-p)/(time_s*10000.0):0; // us over s in percent
+
+	return v>100?100:v;
+}
+
+// read the system pressure and compute the stall percentages since the
+// previous call
+inline int psi_update(void) {
+	int64_t now=monotime();
+	double time_s=timediff_in_s(psi_ts,now);
+	int i,rc=-1;
+
+	psi_ts=now;
+	for (i=0;i<PSI_MAX;i++) {
+		struct psi_res *r=psi_res+i;
+		uint64_t some_t,full_t;
+		char buf[256];
+
+		r->ok=0;
+		if (replaying()) // the pressure is not recorded
+			continue;
+		if (r->fd==-1)
+			r->fd=open(psi_file[i],O_RDONLY|O_CLOEXEC);
+		if (r->fd==-1||psi_read(r->fd,buf,sizeof buf))
+			continue;
+		if (psi_parse(buf,&r->s.some10,&r->s.full10,&some_t,&full_t))
+			continue;
+		memmove(r->s.hist+1,r->s.hist,sizeof r->s.hist-sizeof *r->s.hist);
+		r->s.some=r->have_t?psi_pc(some_t,r->some_t,time_s):0;
+		r->s.full=r->have_t?psi_pc(full_t,r->full_t,time_s):0;
+		r->s.hist[0]=r->s.some;
+		r->some_t=some_t;
+		r->full_t=full_t;
+		r->have_t=1;
+		r->ok=1;
+		rc=0;
+	}
+	return rc;
+}
+
+inline const struct psi_stats *psi_get(int res) {
+	if (res<0||res>=PSI_MAX||!psi_res[res].ok)
+		return NULL;
+	return &psi_res[res].s;
+}
+
+inline void psi_fini(void) {
+	int i;
+
+	for (i=0;i<PSI_MAX;i++) {
+		if (psi_res[i].fd!=-1)
+			close(psi_res[i].fd);
+		memset(psi_res+i,0,sizeof psi_res[i]);
+		psi_res[i].fd=-1;
+	}
+	psi_ts=0;
+}
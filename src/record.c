@@ -0,0 +1,1423 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// --record/--replay file format
+//
+// header, 32 bytes, little endian:
+//   "IOTOPREC", u16 version, u16 flags, u32 taskstats version,
+//   u64 wall clock ms, u64 monotonic ms at the start of the recording
+// followed by frames:
+//   u8 type ('K' keyframe or 'D' delta), varint payload length, payload:
+//   varint ms since the start
+//   pgpgin, pgpgout: varint in keyframes, zigzag delta otherwise
+//   varint count of new strings, each is varint length and bytes; the
+//     string ids continue from the previous frame and restart at keyframes
+//   varint count of exited tids, each as varint gap from the previous tid
+//   varint count of tasks, each is varint tid gap, varint field mask and the
+//     fields set in the mask: zigzag deltas of the counters, then meta data,
+//     then string ids
+//
+// a delta frame holds only the tasks with a change since the previous frame,
+// a keyframe holds all tasks against an empty state; an idle task costs
+// nothing and an active one a few bytes per changed counter
+//
+// --ring keeps the last frames in memory from a keyframe on and writes them
+// as a recording of the same format when a trigger fires
+
+#define REC_MAGIC "IOTOPREC"
+#define REC_VERSION 1
+#define REC_HDR_SIZE 32
+#define REC_F_DELAYS 1 // header flag, collector provides the delays
+#define REC_KEY_EVERY 60 // frames between keyframes
+
+// counters, the most frequently changing ones first to keep the mask short
+enum {
+	RC_DCPU,
+	RC_RCHAR,
+	RC_WCHAR,
+	RC_SYSCR,
+	RC_SYSCW,
+	RC_READ,
+	RC_WRITE,
+	RC_CANCELLED,
+	RC_SWAPIN,
+	RC_BLKIO,
+	RC_DMEM,
+	RC_DTHRASH,
+	RC_DCOMPACT,
+	RC_DWPCOPY,
+	RC_DIRQ,
+	RC_MAX
+};
+
+#define RM_META (1<<RC_MAX) // pid, euid, io_prio and error flags
+#define RM_STR (RM_META<<1) // string ids
+
+// strings: cmdline_long, cmdline_short, cmdline_comm and pw_name
+#define RS_MAX 4
+
+struct rec_task {
+	pid_t tid;
+	pid_t pid;
+	int euid;
+	int io_prio;
+	int errs; // bit 0 error_x, bit 1 error_i
+	uint32_t str[RS_MAX]; // string id+1, 0 for NULL
+	uint64_t ctr[RC_MAX];
+};
+
+struct rec_state {
+	struct rec_task *t;
+	int len;
+	int size;
+};
+
+static inline uint64_t *rec_ctr(struct xxxid_stats *s,int i) {
+	switch (i) {
+		case RC_DCPU:
+			return s->delay_total+DLY_CPU;
+		case RC_RCHAR:
+			return &s->read_char;
+		case RC_WCHAR:
+			return &s->write_char;
+		case RC_SYSCR:
+			return &s->read_syscalls;
+		case RC_SYSCW:
+			return &s->write_syscalls;
+		case RC_READ:
+			return &s->read_bytes;
+		case RC_WRITE:
+			return &s->write_bytes;
+		case RC_CANCELLED:
+			return &s->cancelled_write_bytes;
+		case RC_SWAPIN:
+			return &s->swapin_delay_total;
+		case RC_BLKIO:
+			return &s->blkio_delay_total;
+		default:
+			return s->delay_total+DLY_MEM+i-RC_DMEM;
+	}
+}
+
+static inline char **rec_str(struct xxxid_stats *s,int i) {
+	switch (i) {
+		case 0:
+			return &s->cmdline_long;
+		case 1:
+			return &s->cmdline_short;
+		case 2:
+			return &s->cmdline_comm;
+		default:
+			return &s->pw_name;
+	}
+}
+
+static inline int rs_grow(struct rec_state *st,int len) {
+	struct rec_task *t;
+	int sz;
+
+	if (len<=st->size)
+		return 0;
+	sz=st->size?st->size*2:PROC_LIST_SZ_INI;
+	while (sz<len)
+		sz*=2;
+	t=realloc(st->t,sz*sizeof *t);
+	if (!t)
+		return -1;
+	st->t=t;
+	st->size=sz;
+	return 0;
+}
+
+// recording
+
+static int rec_fd=-1;
+static int rec_failed=0; // errno of a failed write
+static int rec_frames=0; // frames since the last keyframe
+static int rec_key=REC_KEY_EVERY; // frames between keyframes, less with a short ring
+static int rec_hdr=0; // header is made
+static uint8_t rec_hdrb[REC_HDR_SIZE];
+static uint64_t rec_last=0; // time of the last frame
+static uint64_t rec_start=0;
+static uint64_t rec_pgin=0;
+static uint64_t rec_pgou=0;
+static struct rec_state rec_prev={NULL,0,0};
+static struct rec_state rec_cur={NULL,0,0};
+
+static uint8_t *rb=NULL; // frame under construction
+static size_t rb_len=0;
+static size_t rb_size=0;
+static int rb_err=0;
+
+// string to id hash, open addressing; reset at each keyframe
+struct rec_hstr {
+	char *s;
+	uint32_t id;
+};
+
+static struct rec_hstr *rh=NULL;
+static uint32_t rh_size=0;
+static uint32_t rh_used=0;
+static size_t rec_nstr_pos=0; // position of the new strings section in rb
+static uint32_t rec_nstr=0; // new strings in the current frame
+
+static inline void rb_byte(uint8_t b) {
+	if (rb_len==rb_size) {
+		size_t ns=rb_size?rb_size*2:65536;
+		uint8_t *n=realloc(rb,ns);
+
+		if (!n) {
+			rb_err=1;
+			return;
+		}
+		rb=n;
+		rb_size=ns;
+	}
+	rb[rb_len++]=b;
+}
+
+static inline void rb_bytes(const void *p,size_t len) {
+	const uint8_t *b=p;
+
+	while (len--)
+		rb_byte(*b++);
+}
+
+static inline void rb_varint(uint64_t v) {
+	while (v>=0x80) {
+		rb_byte((v&0x7f)|0x80);
+		v>>=7;
+	}
+	rb_byte(v);
+}
+
+static inline void rb_zigzag(int64_t v) {
+	rb_varint(((uint64_t)v<<1)^(uint64_t)(v>>63));
+}
+
+static inline uint32_t rh_hash(const char *s) {
+	uint32_t h=2166136261u;
+
+	while (*s)
+		h=(h^(uint8_t)*s++)*16777619u;
+	return h;
+}
+
+static inline void rh_reset(void) {
+	uint32_t i;
+
+	for (i=0;i<rh_size;i++)
+		if (rh[i].s) {
+			free(rh[i].s);
+			rh[i].s=NULL;
+		}
+	rh_used=0;
+}
+
+static inline int rh_grow(void) {
+	uint32_t ns=rh_size?rh_size*2:1024;
+	struct rec_hstr *n=calloc(ns,sizeof *n);
+	uint32_t i;
+
+	if (!n)
+		return -1;
+	for (i=0;i<rh_size;i++)
+		if (rh[i].s) {
+			uint32_t j=rh_hash(rh[i].s)&(ns-1);
+
+			while (n[j].s)
+				j=(j+1)&(ns-1);
+			n[j]=rh[i];
+		}
+	free(rh);
+	rh=n;
+	rh_size=ns;
+	return 0;
+}
+
+// id+1 of the string, new strings are added to the frame being built
+static inline uint32_t rh_get(const char *s) {
+	uint32_t j;
+	size_t l;
+
+	if (!s)
+		return 0;
+	if ((rh_used+1)*2>rh_size&&rh_grow())
+		return 0;
+	for (j=rh_hash(s)&(rh_size-1);rh[j].s;j=(j+1)&(rh_size-1))
+		if (!strcmp(rh[j].s,s))
+			return rh[j].id+1;
+	rh[j].s=strdup(s);
+	if (!rh[j].s)
+		return 0;
+	rh[j].id=rh_used++;
+	l=strlen(s);
+	rb_varint(l);
+	rb_bytes(s,l);
+	rec_nstr++;
+	return rh[j].id+1;
+}
+
+static inline void rec_task_set(struct rec_task *r,struct xxxid_stats *s) {
+	int i;
+
+	r->tid=s->tid;
+	r->pid=s->pid;
+	r->euid=s->euid;
+	r->io_prio=s->io_prio;
+	r->errs=(s->error_x?1:0)|(s->error_i?2:0);
+	for (i=0;i<RC_MAX;i++)
+		r->ctr[i]=*rec_ctr(s,i);
+	for (i=0;i<RS_MAX;i++)
+		r->str[i]=rh_get(*rec_str(s,i));
+}
+
+static inline uint32_t rec_mask(const struct rec_task *c,const struct rec_task *p,int isnew) {
+	uint32_t mask=0;
+	int k;
+
+	for (k=0;k<RC_MAX;k++)
+		if (c->ctr[k]!=p->ctr[k])
+			mask|=1<<k;
+	if (isnew||c->pid!=p->pid||c->euid!=p->euid||c->io_prio!=p->io_prio||c->errs!=p->errs)
+		mask|=RM_META;
+	if (isnew||memcmp(c->str,p->str,sizeof c->str))
+		mask|=RM_STR;
+	return mask;
+}
+
+static inline void le_put(uint8_t *p,uint64_t v,int n) {
+	while (n--) {
+		*p++=v&0xff;
+		v>>=8;
+	}
+}
+
+static inline uint64_t le_get(const uint8_t *p,int n) {
+	uint64_t v=0;
+
+	while (n--)
+		v=(v<<8)|p[n];
+	return v;
+}
+
+// --ring: rg_cap slots used as a circular buffer, the oldest is a keyframe
+struct rg_frame {
+	uint8_t *p;
+	size_t len;
+	size_t size;
+	int key;
+};
+
+static struct rg_frame *rg=NULL;
+static int rg_cap=0;
+static int rg_first=0;
+static int rg_len=0;
+static int rg_fd=-1; // the frames after a flush go on here until the burst ends
+static uint64_t rg_end=0;
+static volatile sig_atomic_t rg_sig=0;
+
+static inline int rec_write(int fd,const void *p,size_t len) {
+	const uint8_t *b=p;
+
+	while (len) {
+		ssize_t n=write(fd,b,len);
+
+		if (n==-1) {
+			if (errno==EINTR)
+				continue;
+			return -1;
+		}
+		b+=n;
+		len-=n;
+	}
+	return 0;
+}
+
+inline int record_open(const char *path) {
+	rec_fd=open(path,O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,0600);
+	if (rec_fd==-1) {
+		fprintf(stderr,"%s: %s\n",path,strerror(errno));
+		return -1;
+	}
+	rec_hdr=0;
+	return 0;
+}
+
+// the recording stops on a write error, the ring goes on
+static inline void rec_fail(int err) {
+	rec_failed=err?err:EIO;
+	close(rec_fd);
+	rec_fd=-1;
+}
+
+inline void record_close(void) {
+	int i;
+
+	if (rec_fd!=-1)
+		close(rec_fd);
+	rec_fd=-1;
+	if (rg_fd!=-1)
+		close(rg_fd);
+	rg_fd=-1;
+	for (i=0;i<rg_cap;i++)
+		free(rg[i].p);
+	free(rg);
+	rg=NULL;
+	rg_cap=rg_first=rg_len=0;
+	rec_key=REC_KEY_EVERY;
+	if (rec_failed) {
+		fprintf(stderr,"%s: recording stopped: %s\n",params.record_file,strerror(rec_failed));
+		rec_failed=0;
+	}
+	rh_reset();
+	free(rh);
+	rh=NULL;
+	rh_size=0;
+	free(rb);
+	rb=NULL;
+	rb_len=rb_size=0;
+	free(rec_prev.t);
+	free(rec_cur.t);
+	memset(&rec_prev,0,sizeof rec_prev);
+	memset(&rec_cur,0,sizeof rec_cur);
+}
+
+// varint into b, returns the length
+static inline int rec_varint(uint8_t *b,uint64_t v) {
+	int n=0;
+
+	while (v>=0x80) {
+		b[n++]=(v&0x7f)|0x80;
+		v>>=7;
+	}
+	b[n++]=v;
+	return n;
+}
+
+// build the payload of a frame in rb; the new strings are only known after
+// the tasks are converted, so they go to the end of rb from rec_nstr_pos and
+// the writer has to put them, preceded by rec_nstr, before the tasks
+static inline int rec_encode(struct xxxid_stats_arr *cs,uint64_t pgin,uint64_t pgou,uint64_t ts,int key) {
+	static const struct rec_task zero;
+	int i,j,n;
+	size_t tp;
+
+	if (key) {
+		rh_reset();
+		rec_prev.len=0;
+	}
+
+	rb_len=0;
+	rb_err=0;
+	rec_nstr=0;
+	rb_varint(ts-rec_start);
+	if (key) {
+		rb_varint(pgin);
+		rb_varint(pgou);
+	} else {
+		rb_zigzag(pgin-rec_pgin);
+		rb_zigzag(pgou-rec_pgou);
+	}
+	rec_pgin=pgin;
+	rec_pgou=pgou;
+
+	if (rs_grow(&rec_cur,cs->length))
+		return -1;
+	rec_nstr_pos=rb_len;
+	for (i=0;i<cs->length;i++)
+		rec_task_set(rec_cur.t+i,cs->arr[i]);
+	rec_cur.len=cs->length;
+
+	// exited tids
+	for (i=j=n=0;i<rec_prev.len;i++) {
+		while (j<rec_cur.len&&rec_cur.t[j].tid<rec_prev.t[i].tid)
+			j++;
+		if (j>=rec_cur.len||rec_cur.t[j].tid!=rec_prev.t[i].tid)
+			n++;
+	}
+	rb_varint(n);
+	for (i=j=0,tp=0;i<rec_prev.len;i++) {
+		while (j<rec_cur.len&&rec_cur.t[j].tid<rec_prev.t[i].tid)
+			j++;
+		if (j>=rec_cur.len||rec_cur.t[j].tid!=rec_prev.t[i].tid) {
+			rb_varint(rec_prev.t[i].tid-tp);
+			tp=rec_prev.t[i].tid;
+		}
+	}
+
+	// changed tasks; count them first
+	for (i=j=n=0;i<rec_cur.len;i++) {
+		const struct rec_task *c=rec_cur.t+i,*p=&zero;
+
+		while (j<rec_prev.len&&rec_prev.t[j].tid<c->tid)
+			j++;
+		if (j<rec_prev.len&&rec_prev.t[j].tid==c->tid)
+			p=rec_prev.t+j;
+		if (rec_mask(c,p,p==&zero))
+			n++;
+	}
+	rb_varint(n);
+	for (i=j=0,tp=0;i<rec_cur.len;i++) {
+		const struct rec_task *c=rec_cur.t+i,*p=&zero;
+		uint32_t mask;
+		int k;
+
+		while (j<rec_prev.len&&rec_prev.t[j].tid<c->tid)
+			j++;
+		if (j<rec_prev.len&&rec_prev.t[j].tid==c->tid)
+			p=rec_prev.t+j;
+		mask=rec_mask(c,p,p==&zero);
+		if (!mask)
+			continue;
+		rb_varint(c->tid-tp);
+		tp=c->tid;
+		rb_varint(mask);
+		for (k=0;k<RC_MAX;k++)
+			if (mask&(1<<k))
+				rb_zigzag(c->ctr[k]-p->ctr[k]);
+		if (mask&RM_META) {
+			rb_zigzag(c->tid-c->pid);
+			rb_zigzag(c->euid);
+			rb_varint(c->io_prio);
+			rb_varint(c->errs);
+		}
+		if (mask&RM_STR)
+			for (k=0;k<RS_MAX;k++)
+				rb_varint(c->str[k]);
+	}
+	if (rb_err)
+		return -1;
+
+	{ // swap the states
+		struct rec_state t=rec_prev;
+
+		rec_prev=rec_cur;
+		rec_cur=t;
+	}
+	return 0;
+}
+
+inline int ring_open(void) {
+	// keyframes are more frequent with a short ring, it has to start with one
+	rec_key=params.ring_size/4;
+	if (rec_key<1)
+		rec_key=1;
+	if (rec_key>REC_KEY_EVERY)
+		rec_key=REC_KEY_EVERY;
+	rg_cap=params.ring_size+rec_key;
+	rg=calloc(rg_cap,sizeof *rg);
+	if (!rg) {
+		fprintf(stderr,"%s: out of memory\n",params.ring_file);
+		rg_cap=0;
+		return -1;
+	}
+	rec_frames=0;
+	return 0;
+}
+
+// the drop of the oldest frames keeps the ring starting with a keyframe
+static inline void rg_push(const struct iovec *iov,int cnt,size_t len,int key) {
+	struct rg_frame *f;
+	int i;
+
+	if (rg_len==rg_cap)
+		do {
+			rg_first=(rg_first+1)%rg_cap;
+			rg_len--;
+		} while (rg_len&&!rg[rg_first].key);
+	if (!rg_len&&!key) // a delta without its keyframe is of no use
+		return;
+	f=rg+(rg_first+rg_len)%rg_cap;
+	if (f->size<len) {
+		uint8_t *t=realloc(f->p,len);
+
+		if (!t) { // start over from the next keyframe
+			rg_len=0;
+			rec_frames=0;
+			return;
+		}
+		f->p=t;
+		f->size=len;
+	}
+	for (i=0,f->len=0;i<cnt;i++) {
+		memcpy(f->p+f->len,iov[i].iov_base,iov[i].iov_len);
+		f->len+=iov[i].iov_len;
+	}
+	f->key=key;
+	rg_len++;
+	if (rg_fd!=-1&&rec_write(rg_fd,f->p,f->len)) {
+		close(rg_fd);
+		rg_fd=-1;
+	}
+}
+
+// write the ring as a recording and keep adding the frames to it while the
+// sampling is faster for --burst
+inline void ring_flush(void) {
+	char path[PATH_MAX];
+	struct tm tm;
+	time_t now;
+	size_t pl;
+	int i;
+
+	if (!rg||!rg_len)
+		return;
+	if (rg_fd!=-1) { // the frames already go to a file, only extend the burst
+		rg_end=rec_last+1000*(uint64_t)params.burst_s;
+		trigger_capture(params.burst_s,params.burst_ms);
+		return;
+	}
+	now=time(NULL);
+	localtime_r(&now,&tm);
+	snprintf(path,sizeof path,"%s.%04d%02d%02d-%02d%02d%02d",params.ring_file,tm.tm_year+1900,tm.tm_mon+1,tm.tm_mday,tm.tm_hour,tm.tm_min,tm.tm_sec);
+	pl=strlen(path);
+	// a second dump in the same second gets a .N suffix instead of
+	// overwriting the first one
+	for (i=1;;i++) {
+		rg_fd=open(path,O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC,0600);
+		if (rg_fd!=-1||errno!=EEXIST||i>=1000)
+			break;
+		snprintf(path+pl,sizeof path-pl,".%d",i);
+	}
+	if (rg_fd==-1)
+		return;
+	if (rec_write(rg_fd,rec_hdrb,sizeof rec_hdrb))
+		rg_len=0;
+	for (i=0;i<rg_len;i++) {
+		const struct rg_frame *f=rg+(rg_first+i)%rg_cap;
+
+		if (rec_write(rg_fd,f->p,f->len))
+			break;
+	}
+	if (i<rg_len||!params.burst_s) {
+		close(rg_fd);
+		rg_fd=-1;
+		return;
+	}
+	rg_end=rec_last+1000*(uint64_t)params.burst_s;
+	trigger_capture(params.burst_s,params.burst_ms);
+}
+
+// from the SIGUSR1 handler, the ring is written with the next frame
+inline void ring_signal(void) {
+	rg_sig=1;
+}
+
+// the header of the recording and of the ring dumps
+static inline int rec_header(uint64_t start) {
+	struct timespec wt;
+
+	clock_gettime(CLOCK_REALTIME,&wt);
+	rec_hdr=1;
+	rec_start=start;
+	memcpy(rec_hdrb,REC_MAGIC,8);
+	le_put(rec_hdrb+8,REC_VERSION,2);
+	le_put(rec_hdrb+10,collector->has_delays?REC_F_DELAYS:0,2);
+	le_put(rec_hdrb+12,taskstats_version(),4);
+	le_put(rec_hdrb+16,(uint64_t)wt.tv_sec*1000+wt.tv_nsec/1000000,8);
+	le_put(rec_hdrb+24,rec_start,8);
+	if (rec_fd!=-1&&rec_write(rec_fd,rec_hdrb,sizeof rec_hdrb)) {
+		rec_fail(errno);
+		if (!rg)
+			return -1;
+	}
+	rec_frames=0;
+	return 0;
+}
+
+// the frame encoded in rb goes to the recording and to the ring
+static inline void rec_put(uint64_t ts,int key) {
+	uint8_t lb[11],cb[5];
+	struct iovec iov[4];
+	size_t ln,cl;
+	ssize_t w;
+
+	rec_last=ts;
+	if (rg_fd!=-1&&ts>=rg_end) { // the burst is over
+		close(rg_fd);
+		rg_fd=-1;
+	}
+
+	// type, length, time and vm, string count, strings and the rest
+	cl=rec_varint(cb,rec_nstr);
+	lb[0]=key?'K':'D';
+	ln=1+rec_varint(lb+1,rb_len+cl);
+	iov[0].iov_base=lb;
+	iov[0].iov_len=ln;
+	iov[1].iov_base=rb;
+	iov[1].iov_len=rec_nstr_pos;
+	iov[2].iov_base=cb;
+	iov[2].iov_len=cl;
+	iov[3].iov_base=rb+rec_nstr_pos;
+	iov[3].iov_len=rb_len-rec_nstr_pos;
+	if (rec_fd!=-1) {
+		do
+			w=writev(rec_fd,iov,4);
+		while (w==-1&&errno==EINTR);
+		if (w!=(ssize_t)(ln+rb_len+cl))
+			rec_fail(errno);
+	}
+	if (rg) {
+		rg_push(iov,4,ln+rb_len+cl,key);
+		if (rg_sig) {
+			rg_sig=0;
+			ring_flush();
+		}
+	}
+}
+
+inline void record_frame(struct xxxid_stats_arr *cs,uint64_t pgin,uint64_t pgou,uint64_t ts) {
+	int key;
+
+	if ((rec_fd==-1&&!rg)||!cs)
+		return;
+	cs=task_data(cs); // the tasks are recorded, not the group rows
+
+	// the taskstats version is known after the first query
+	if (!rec_hdr&&rec_header(ts))
+		return;
+
+	key=rec_frames==0;
+	if (++rec_frames==rec_key)
+		rec_frames=0;
+	if (rec_encode(cs,pgin,pgou,ts,key)) {
+		rec_frames=0; // the string ids are out of sync, restart with a keyframe
+		return;
+	}
+	rec_put(ts,key);
+}
+
+// replay
+
+struct rp_frame {
+	size_t ofs; // payload offset
+	size_t len; // payload length
+	uint64_t ms; // since the start of the recording
+	int key;
+};
+
+struct rp_str {
+	const uint8_t *p;
+	size_t len;
+};
+
+static const uint8_t *rp_map=NULL;
+static size_t rp_size=0;
+static struct rp_frame *rp_fr=NULL;
+static int rp_nfr=0;
+static int rp_next=0; // next frame to deliver
+static int rp_speed=1;
+static int rp_seeked=0;
+static uint64_t rp_wall=0; // header wall clock ms
+static uint64_t rp_mono=0; // header monotonic ms
+static uint64_t rp_pgin=0;
+static uint64_t rp_pgou=0;
+static struct rec_state rp_st={NULL,0,0};
+static struct rp_str *rp_s=NULL;
+static uint32_t rp_slen=0;
+static uint32_t rp_ssize=0;
+
+static struct collector rp_col={"replay",NULL,replay_close,NULL,NULL,0};
+
+static inline int rp_varint(const uint8_t **p,const uint8_t *e,uint64_t *v) {
+	int sh=0;
+
+	*v=0;
+	while (*p<e&&sh<64) {
+		uint8_t b=*(*p)++;
+
+		*v|=(uint64_t)(b&0x7f)<<sh;
+		if (!(b&0x80))
+			return 0;
+		sh+=7;
+	}
+	return -1;
+}
+
+static inline int rp_zigzag(const uint8_t **p,const uint8_t *e,int64_t *v) {
+	uint64_t u;
+
+	if (rp_varint(p,e,&u))
+		return -1;
+	*v=(int64_t)(u>>1)^-(int64_t)(u&1);
+	return 0;
+}
+
+static inline struct rec_task *rp_find(pid_t tid,int add) {
+	int s=0,e=rp_st.len;
+
+	while (s<e) {
+		int m=s+(e-s)/2;
+
+		if (rp_st.t[m].tid==tid)
+			return rp_st.t+m;
+		if (rp_st.t[m].tid<tid)
+			s=m+1;
+		else
+			e=m;
+	}
+	if (!add||rs_grow(&rp_st,rp_st.len+1))
+		return NULL;
+	memmove(rp_st.t+s+1,rp_st.t+s,(rp_st.len-s)*sizeof *rp_st.t);
+	memset(rp_st.t+s,0,sizeof *rp_st.t);
+	rp_st.t[s].tid=tid;
+	rp_st.len++;
+	return rp_st.t+s;
+}
+
+// apply a frame to the state
+static inline int rp_decode(int f) {
+	const uint8_t *p=rp_map+rp_fr[f].ofs,*e=p+rp_fr[f].len;
+	uint64_t v,n,i,tid;
+	int64_t z;
+
+	if (rp_varint(&p,e,&v)) // time is in the index
+		return -1;
+	if (rp_fr[f].key) {
+		rp_st.len=0;
+		rp_slen=0;
+		if (rp_varint(&p,e,&rp_pgin)||rp_varint(&p,e,&rp_pgou))
+			return -1;
+	} else {
+		if (rp_zigzag(&p,e,&z))
+			return -1;
+		rp_pgin+=z;
+		if (rp_zigzag(&p,e,&z))
+			return -1;
+		rp_pgou+=z;
+	}
+
+	if (rp_varint(&p,e,&n))
+		return -1;
+	for (i=0;i<n;i++) {
+		if (rp_varint(&p,e,&v)||v>(uint64_t)(e-p))
+			return -1;
+		if (rp_slen==rp_ssize) {
+			uint32_t ns=rp_ssize?rp_ssize*2:1024;
+			struct rp_str *t=realloc(rp_s,ns*sizeof *t);
+
+			if (!t)
+				return -1;
+			rp_s=t;
+			rp_ssize=ns;
+		}
+		rp_s[rp_slen].p=p;
+		rp_s[rp_slen].len=v;
+		rp_slen++;
+		p+=v;
+	}
+
+	if (rp_varint(&p,e,&n))
+		return -1;
+	for (i=0,tid=0;i<n;i++) {
+		struct rec_task *t;
+
+		if (rp_varint(&p,e,&v))
+			return -1;
+		tid+=v;
+		t=rp_find(tid,0);
+		if (t) {
+			memmove(t,t+1,(rp_st.t+rp_st.len-t-1)*sizeof *t);
+			rp_st.len--;
+		}
+	}
+
+	if (rp_varint(&p,e,&n))
+		return -1;
+	for (i=0,tid=0;i<n;i++) {
+		struct rec_task *t;
+		uint64_t mask;
+		int k;
+
+		if (rp_varint(&p,e,&v)||rp_varint(&p,e,&mask))
+			return -1;
+		tid+=v;
+		t=rp_find(tid,1);
+		if (!t)
+			return -1;
+		for (k=0;k<RC_MAX;k++)
+			if (mask&(1<<k)) {
+				if (rp_zigzag(&p,e,&z))
+					return -1;
+				t->ctr[k]+=z;
+			}
+		if (mask&RM_META) {
+			if (rp_zigzag(&p,e,&z))
+				return -1;
+			t->pid=tid-z;
+			if (rp_zigzag(&p,e,&z))
+				return -1;
+			t->euid=z;
+			if (rp_varint(&p,e,&v))
+				return -1;
+			t->io_prio=v;
+			if (rp_varint(&p,e,&v))
+				return -1;
+			t->errs=v;
+		}
+		if (mask&RM_STR)
+			for (k=0;k<RS_MAX;k++) {
+				if (rp_varint(&p,e,&v)||v>rp_slen)
+					return -1;
+				t->str[k]=v;
+			}
+	}
+	return 0;
+}
+
+static inline char *rp_strdup(uint32_t id) {
+	char *s;
+
+	if (!id)
+		return NULL;
+	s=malloc(rp_s[id-1].len+1);
+	if (s) {
+		memcpy(s,rp_s[id-1].p,rp_s[id-1].len);
+		s[rp_s[id-1].len]=0;
+	}
+	return s;
+}
+
+// go to frame t; the state is left two frames before the target so the
+// caller can rebuild the previous sample for the diff
+static inline void rp_goto(int t) {
+	int k,i;
+
+	if (t>rp_nfr-1)
+		t=rp_nfr-1;
+	if (t<1)
+		t=1;
+	for (k=t-1;k>0&&!rp_fr[k].key;k--)
+		;
+	rp_st.len=0;
+	rp_slen=0;
+	for (i=k;i<t-1;i++)
+		if (rp_decode(i))
+			break;
+	rp_next=t-1;
+}
+
+inline const struct collector *replay_open(const char *path) {
+	const uint8_t *p,*e;
+	struct stat st;
+	int fd;
+
+	fd=open(path,O_RDONLY|O_CLOEXEC);
+	if (fd==-1) {
+		fprintf(stderr,"%s: %s\n",path,strerror(errno));
+		return NULL;
+	}
+	if (fstat(fd,&st)||st.st_size<REC_HDR_SIZE) {
+		fprintf(stderr,"%s: not an iotop recording\n",path);
+		close(fd);
+		return NULL;
+	}
+	rp_size=st.st_size;
+	rp_map=mmap(NULL,rp_size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if (rp_map==MAP_FAILED) {
+		rp_map=NULL;
+		fprintf(stderr,"%s: %s\n",path,strerror(errno));
+		return NULL;
+	}
+	if (memcmp(rp_map,REC_MAGIC,8)||le_get(rp_map+8,2)!=REC_VERSION) {
+		fprintf(stderr,"%s: not an iotop recording or unsupported version\n",path);
+		replay_close();
+		return NULL;
+	}
+	rp_col.has_delays=le_get(rp_map+10,2)&REC_F_DELAYS;
+	taskstats_version_set(le_get(rp_map+12,4));
+	rp_wall=le_get(rp_map+16,8);
+	rp_mono=le_get(rp_map+24,8);
+
+	// index the frames; a truncated last frame of an interrupted recording is ignored
+	p=rp_map+REC_HDR_SIZE;
+	e=rp_map+rp_size;
+	while (p<e) {
+		const uint8_t *q;
+		uint64_t len,ms;
+		int key=*p=='K';
+
+		if (*p!='K'&&*p!='D')
+			break;
+		p++;
+		if (rp_varint(&p,e,&len)||len>(uint64_t)(e-p))
+			break;
+		q=p;
+		if (rp_varint(&q,p+len,&ms))
+			break;
+		if (!rp_nfr&&!key) // must start with a keyframe
+			break;
+		if (!(rp_nfr&(rp_nfr-1))) {
+			struct rp_frame *t=realloc(rp_fr,(rp_nfr?rp_nfr*2:64)*sizeof *t);
+
+			if (!t)
+				break;
+			rp_fr=t;
+		}
+		rp_fr[rp_nfr].ofs=p-rp_map;
+		rp_fr[rp_nfr].len=len;
+		rp_fr[rp_nfr].ms=ms;
+		rp_fr[rp_nfr].key=key;
+		rp_nfr++;
+		p+=len;
+	}
+	if (rp_nfr<2) {
+		fprintf(stderr,"%s: the recording has less than two frames\n",path);
+		replay_close();
+		return NULL;
+	}
+	rp_next=0;
+	if (params.replay_from>0) {
+		int i;
+
+		for (i=0;i<rp_nfr-1&&rp_fr[i].ms<(uint64_t)params.replay_from*1000;i++)
+			;
+		if (i>1)
+			rp_goto(i);
+	}
+	return &rp_col;
+}
+
+inline void replay_close(void) {
+	if (rp_map)
+		munmap((void *)rp_map,rp_size);
+	rp_map=NULL;
+	free(rp_fr);
+	rp_fr=NULL;
+	rp_nfr=0;
+	free(rp_st.t);
+	memset(&rp_st,0,sizeof rp_st);
+	free(rp_s);
+	rp_s=NULL;
+	rp_slen=rp_ssize=0;
+}
+
+// --daemon/--attach: the daemon publishes each sample as a keyframe in
+// shared memory, the attached clients decode it as a single frame recording
+//
+// the segment is a header page followed by two slots; the daemon writes the
+// slot that is not current and then switches to it under a seqlock, so the
+// readers never wait and retry only when a switch raced with their copy
+
+#define SHM_DIR "/dev/shm/" // same as shm_open, without the need of librt
+#define SHM_MAGIC "IOTOPSHM"
+#define SHM_VERSION 1
+#define SHM_HDR_SIZE 4096
+#define SHM_SLOT_SIZE (8<<20) // tmpfs only allocates the touched pages
+#define SHM_SIZE (SHM_HDR_SIZE+2*SHM_SLOT_SIZE)
+#define SHM_POLL 10 // ms between checks for a new snapshot
+
+struct shm_hdr {
+	char magic[8];
+	uint32_t version;
+	uint32_t flags; // REC_F_*
+	uint32_t ts_ver; // taskstats version
+	int32_t pid; // of the daemon, 0 after it stopped
+	uint64_t wall; // wall clock ms at the start
+	uint64_t mono; // monotonic ms at the start
+	uint64_t interval; // ms between the snapshots
+	uint32_t seq; // odd while the current slot is switched
+	uint32_t slot; // slot of the current snapshot
+	uint64_t len[2]; // payload length in each slot
+};
+
+static struct shm_hdr *shm=NULL;
+static char *shm_path=NULL; // removed by the daemon on exit
+static int shm_warned=0;
+static uint32_t at_seq=1; // last delivered snapshot, odd is never published
+static int at_gone=0; // daemon stopped
+static uint8_t *at_buf=NULL; // private copy of the snapshot
+static size_t at_size=0;
+static struct rp_frame at_fr;
+
+static struct collector at_col={"attach",NULL,attach_close,NULL,NULL,0};
+
+static inline char *shm_name(const char *name) {
+	char *p;
+
+	if (!*name||strchr(name,'/')) {
+		fprintf(stderr,"%s: invalid shared memory name\n",name);
+		return NULL;
+	}
+	p=malloc(strlen(SHM_DIR)+strlen(name)+1);
+	if (p) {
+		strcpy(p,SHM_DIR);
+		strcat(p,name);
+	}
+	return p;
+}
+
+static inline int shm_alive(pid_t pid) {
+	return pid>0&&(!kill(pid,0)||errno!=ESRCH);
+}
+
+// /dev/shm is world writable; a segment is trusted only if it is big enough
+// to map and belongs to root or to us, a short file would SIGBUS on access
+static inline const char *shm_check(int fd) {
+	struct stat st;
+
+	if (fstat(fd,&st))
+		return strerror(errno);
+	if (!S_ISREG(st.st_mode))
+		return "not a regular file";
+	if (st.st_uid!=0&&st.st_uid!=geteuid())
+		return "owned by another user";
+	if (st.st_size<(off_t)SHM_SIZE)
+		return "too short";
+	return NULL;
+}
+
+inline int daemon_open(const char *name) {
+	int fd,i;
+
+	shm_path=shm_name(name);
+	if (!shm_path)
+		return -1;
+	for (i=0;i<2;i++) {
+		fd=open(shm_path,O_RDWR|O_CREAT|O_EXCL|O_CLOEXEC|O_NOFOLLOW,0640);
+		if (fd!=-1||errno!=EEXIST)
+			break;
+		// replace the segment of a daemon that did not clean up
+		fd=open(shm_path,O_RDONLY|O_CLOEXEC|O_NOFOLLOW);
+		if (fd!=-1) {
+			struct shm_hdr h;
+
+			if (!shm_check(fd)&&read(fd,&h,sizeof h)==sizeof h&&!memcmp(h.magic,SHM_MAGIC,8)&&shm_alive(h.pid)) {
+				fprintf(stderr,"%s: iotop daemon with pid %d is already running\n",shm_path,h.pid);
+				close(fd);
+				free(shm_path);
+				shm_path=NULL;
+				return -1;
+			}
+			close(fd);
+		}
+		unlink(shm_path);
+	}
+	if (fd==-1||fchmod(fd,0640)||ftruncate(fd,SHM_SIZE)) {
+		fprintf(stderr,"%s: %s\n",shm_path,strerror(errno));
+		if (fd!=-1) {
+			close(fd);
+			unlink(shm_path);
+		}
+		free(shm_path);
+		shm_path=NULL;
+		return -1;
+	}
+	shm=mmap(NULL,SHM_SIZE,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	close(fd);
+	if (shm==MAP_FAILED) {
+		shm=NULL;
+		fprintf(stderr,"%s: %s\n",shm_path,strerror(errno));
+		unlink(shm_path);
+		free(shm_path);
+		shm_path=NULL;
+		return -1;
+	}
+	{
+		struct timespec wt;
+
+		clock_gettime(CLOCK_REALTIME,&wt);
+		shm->version=SHM_VERSION;
+		shm->pid=getpid();
+		shm->wall=(uint64_t)wt.tv_sec*1000+wt.tv_nsec/1000000;
+		shm->mono=monotime();
+		shm->interval=1000*(uint64_t)params.delay;
+		shm->seq=0;
+		rec_start=shm->mono;
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		memcpy(shm->magic,SHM_MAGIC,8); // valid from now on
+	}
+	return 0;
+}
+
+inline void daemon_close(void) {
+	if (shm) {
+		__atomic_store_n(&shm->pid,0,__ATOMIC_RELEASE);
+		munmap(shm,SHM_SIZE);
+	}
+	shm=NULL;
+	if (shm_path) {
+		unlink(shm_path);
+		free(shm_path);
+	}
+	shm_path=NULL;
+	record_close(); // encoder state
+}
+
+inline void daemon_publish(struct xxxid_stats_arr *cs,uint64_t pgin,uint64_t pgou,uint64_t ts) {
+	uint32_t w,seq;
+	uint8_t cb[5];
+	uint8_t *d;
+	size_t cl;
+
+	if (!shm||!cs||rec_encode(task_data(cs),pgin,pgou,ts,1))
+		return;
+	cl=rec_varint(cb,rec_nstr);
+	if (rb_len+cl>SHM_SLOT_SIZE) {
+		if (!shm_warned)
+			fprintf(stderr,"%s: snapshot of %lu bytes does not fit, skipped\n",shm_path,(unsigned long)(rb_len+cl));
+		shm_warned=1;
+		return;
+	}
+	w=shm->slot^1;
+	d=(uint8_t *)shm+SHM_HDR_SIZE+w*SHM_SLOT_SIZE;
+
+	// a reader still copying slot w from two snapshots ago must see the odd
+	// seq before any byte of the new one, the fence pairs with its acquire
+	seq=shm->seq;
+	__atomic_store_n(&shm->seq,seq+1,__ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(d,rb,rec_nstr_pos);
+	memcpy(d+rec_nstr_pos,cb,cl);
+	memcpy(d+rec_nstr_pos+cl,rb+rec_nstr_pos,rb_len-rec_nstr_pos);
+	shm->flags=collector->has_delays?REC_F_DELAYS:0;
+	shm->ts_ver=taskstats_version();
+	shm->len[w]=rb_len+cl;
+	shm->slot=w;
+	__atomic_store_n(&shm->seq,seq+2,__ATOMIC_RELEASE);
+
+	// the snapshots are keyframes, the ring keeps them as they are; the
+	// time base of the dumps is the start of the daemon
+	if (rg&&(rec_hdr||!rec_header(rec_start)))
+		rec_put(ts,1);
+}
+
+inline const struct collector *attach_open(const char *name) {
+	char *path=shm_name(name);
+	const char *err;
+	int fd;
+
+	if (!path)
+		return NULL;
+	fd=open(path,O_RDONLY|O_CLOEXEC|O_NOFOLLOW);
+	if (fd==-1) {
+		fprintf(stderr,"%s: no iotop daemon: %s\n",path,strerror(errno));
+		free(path);
+		return NULL;
+	}
+	err=shm_check(fd);
+	if (err) {
+		fprintf(stderr,"%s: not an iotop daemon segment: %s\n",path,err);
+		close(fd);
+		free(path);
+		return NULL;
+	}
+	shm=mmap(NULL,SHM_SIZE,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if (shm==MAP_FAILED) {
+		shm=NULL;
+		fprintf(stderr,"%s: %s\n",path,strerror(errno));
+		free(path);
+		return NULL;
+	}
+	if (memcmp(shm->magic,SHM_MAGIC,8)||shm->version!=SHM_VERSION||!shm_alive(shm->pid)) {
+		fprintf(stderr,"%s: no running iotop daemon\n",path);
+		free(path);
+		attach_close();
+		return NULL;
+	}
+	free(path);
+	at_col.has_delays=shm->flags&REC_F_DELAYS;
+	taskstats_version_set(shm->ts_ver);
+	rp_wall=shm->wall;
+	rp_mono=shm->mono;
+	at_seq=1;
+	at_gone=0;
+	memset(&at_fr,0,sizeof at_fr);
+	at_fr.key=1;
+	rp_fr=&at_fr;
+	rp_nfr=1;
+	rp_next=1; // nothing to deliver until the first snapshot
+	return &at_col;
+}
+
+inline void attach_close(void) {
+	if (shm)
+		munmap(shm,SHM_SIZE);
+	shm=NULL;
+	free(at_buf);
+	at_buf=NULL;
+	at_size=0;
+	rp_map=NULL;
+	rp_fr=NULL;
+	rp_nfr=0;
+	free(rp_st.t);
+	memset(&rp_st,0,sizeof rp_st);
+	free(rp_s);
+	rp_s=NULL;
+	rp_slen=rp_ssize=0;
+}
+
+// wait for a snapshot newer than the last one and copy it; -1 when the daemon is gone
+static inline int at_next(void) {
+	for (;;) {
+		uint32_t s1=__atomic_load_n(&shm->seq,__ATOMIC_ACQUIRE);
+
+		if (!(s1&1)&&s1!=at_seq&&s1) {
+			uint32_t w=shm->slot;
+			uint64_t len=shm->len[w];
+			const uint8_t *p;
+
+			if (len>SHM_SLOT_SIZE)
+				len=0;
+			if (len>at_size) {
+				uint8_t *t=realloc(at_buf,len);
+
+				if (!t)
+					return -1;
+				at_buf=t;
+				at_size=len;
+			}
+			memcpy(at_buf,(uint8_t *)shm+SHM_HDR_SIZE+w*SHM_SLOT_SIZE,len);
+			at_col.has_delays=shm->flags&REC_F_DELAYS;
+			taskstats_version_set(shm->ts_ver);
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&shm->seq,__ATOMIC_RELAXED)!=s1)
+				continue; // the daemon switched slots twice during the copy
+			at_seq=s1;
+			p=at_buf;
+			rp_map=at_buf;
+			at_fr.ofs=0;
+			at_fr.len=len;
+			if (rp_varint(&p,at_buf+len,&at_fr.ms))
+				return -1;
+			rp_next=0;
+			return 0;
+		}
+		if (!shm_alive(__atomic_load_n(&shm->pid,__ATOMIC_ACQUIRE))) {
+			at_gone=1;
+			return -1;
+		}
+		{
+			struct timespec ts={0,SHM_POLL*1000000};
+
+			nanosleep(&ts,NULL);
+		}
+	}
+}
+
+inline int replaying(void) {
+	return params.replay_file||params.attach;
+}
+
+inline int replay_eof(void) {
+	if (params.attach)
+		return at_gone;
+	return rp_next>=rp_nfr;
+}
+
+// add the tasks of the next frame to a
+inline int replay_fill(struct xxxid_stats_arr *a,filter_callback filter,void (*add)(struct xxxid_stats_arr *,struct xxxid_stats *,filter_callback)) {
+	int i,k;
+
+	if (params.attach&&at_next())
+		return -1;
+	if (replay_eof()||rp_decode(rp_next)) {
+		rp_next=rp_nfr; // stop at a damaged frame
+		return -1;
+	}
+	for (i=0;i<rp_st.len;i++) {
+		struct rec_task *t=rp_st.t+i;
+		struct xxxid_stats *s=calloc(1,sizeof *s);
+
+		if (!s)
+			continue;
+		s->tid=t->tid;
+		s->pid=t->pid;
+		s->euid=t->euid;
+		s->io_prio=t->io_prio;
+		s->error_x=t->errs&1;
+		s->error_i=(t->errs>>1)&1;
+		s->ts_smp=rp_mono+rp_fr[rp_next].ms;
+		for (k=0;k<RC_MAX;k++)
+			*rec_ctr(s,k)=t->ctr[k];
+		for (k=0;k<RS_MAX;k++)
+			*rec_str(s,k)=rp_strdup(t->str[k]);
+		if (!s->cmdline_long||!s->cmdline_short||!s->pw_name) {
+			free_stats(s);
+			continue;
+		}
+		add(a,s,filter);
+	}
+	rp_next++;
+	return 0;
+}
+
+inline int replay_vm_counters(uint64_t *pgpgin,uint64_t *pgpgou) {
+	*pgpgin=rp_pgin;
+	*pgpgou=rp_pgou;
+	return 0;
+}
+
+// time of the last delivered frame
+inline uint64_t replay_time(void) {
+	return rp_mono+rp_fr[rp_next?rp_next-1:0].ms;
+}
+
+// ms until the next frame at the current speed
+inline uint64_t replay_period(void) {
+	if (params.attach)
+		return shm->interval;
+	if (!rp_next||replay_eof())
+		return 0;
+	return (rp_fr[rp_next].ms-rp_fr[rp_next-1].ms)/rp_speed;
+}
+
+// move by the given number of frames from the last delivered one
+inline void replay_seek(int frames) {
+	rp_goto(rp_next-1+frames);
+	rp_seeked=1;
+}
+
+inline int replay_seeked(void) {
+	int r=rp_seeked;
+
+	rp_seeked=0;
+	return r;
+}
+
+inline int replay_speed(int faster) {
+	if (faster>0&&rp_speed<64)
+		rp_speed*=2;
+	if (faster<0&&rp_speed>1)
+		rp_speed/=2;
+	return rp_speed;
+}
+
+inline void wall_time(struct timespec *ts) {
+	if (replaying()) {
+		uint64_t ms=rp_wall+rp_fr[rp_next?rp_next-1:0].ms;
+
+		ts->tv_sec=ms/1000;
+		ts->tv_nsec=(ms%1000)*1000000;
+	} else
+		clock_gettime(CLOCK_REALTIME,ts);
+}
@@ -0,0 +1,228 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+
+#include <string.h>
+
+inline int iotop_sort_cb(const void *a,const void *b) {
+	int order=config.f.sort_order?1:-1; // SORT_ASC is bit 0=1, else should reverse sort
+	struct xxxid_stats **ppa=(struct xxxid_stats **)a;
+	struct xxxid_stats **ppb=(struct xxxid_stats **)b;
+	struct xxxid_stats *pa,*pb;
+	static int grlen=0;
+	int res=0;
+
+	if (!a) {
+		grlen=(long)b;
+		return 0;
+	}
+
+	pa=*ppa;
+	pb=*ppb;
+
+	switch (masked_sort_by(0)) {
+		case SORT_BY_GRAPH: {
+			double da=0,db=0;
+			int aa=0,ab=0;
+			int i;
+
+			switch (masked_grtype(0)) {
+				case E_GR_IO:
+					if (grlen==0)
+						grlen=HISTORY_CNT;
+					for (i=0;i<grlen;i++) {
+						aa+=config.f.processes?pa->iohist_p[i]:pa->iohist[i];
+						ab+=config.f.processes?pb->iohist_p[i]:pb->iohist[i];
+					}
+					res=aa-ab;
+					break;
+				case E_GR_R:
+					if (grlen==0)
+						grlen=HISTORY_CNT;
+					for (i=0;i<grlen;i++) {
+						da+=config.f.processes?pa->readhist_p[i]:pa->readhist[i];
+						db+=config.f.processes?pb->readhist_p[i]:pb->readhist[i];
+					}
+					if (da>db)
+						res=1;
+					else if (da<db)
+						res=-1;
+					else
+						res=0;
+					break;
+				case E_GR_W:
+					if (grlen==0)
+						grlen=HISTORY_CNT;
+					for (i=0;i<grlen;i++) {
+						da+=config.f.processes?pa->writehist_p[i]:pa->writehist[i];
+						db+=config.f.processes?pb->writehist_p[i]:pb->writehist[i];
+					}
+					if (da>db)
+						res=1;
+					else if (da<db)
+						res=-1;
+					else
+						res=0;
+					break;
+				case E_GR_RW:
+					if (grlen==0)
+						grlen=HISTORY_CNT;
+					for (i=0;i<grlen;i++) {
+						da+=config.f.processes?pa->readhist_p[i]:pa->readhist[i];
+						db+=config.f.processes?pb->readhist_p[i]:pb->readhist[i];
+						da+=config.f.processes?pa->writehist_p[i]:pa->writehist[i];
+						db+=config.f.processes?pb->writehist_p[i]:pb->writehist[i];
+					}
+					if (da>db)
+						res=1;
+					else if (da<db)
+						res=-1;
+					else
+						res=0;
+					break;
+				case E_GR_SW:
+					if (grlen==0)
+						grlen=HISTORY_CNT;
+					for (i=0;i<grlen;i++) {
+						aa+=config.f.processes?pa->sihist_p[i]:pa->sihist[i];
+						ab+=config.f.processes?pb->sihist_p[i]:pb->sihist[i];
+					}
+					res=aa-ab;
+					break;
+				case E_GR_NW:
+					if (grlen==0)
+						grlen=HISTORY_CNT;
+					for (i=0;i<grlen;i++) {
+						da+=config.f.processes?pa->netwhist_p[i]:pa->netwhist[i];
+						db+=config.f.processes?pb->netwhist_p[i]:pb->netwhist[i];
+					}
+					if (da>db)
+						res=1;
+					else if (da<db)
+						res=-1;
+					else
+						res=0;
+					break;
+				case E_GR_CPU:
+				case E_GR_MEM:
+				case E_GR_THRASH:
+				case E_GR_COMPACT:
+				case E_GR_WPCOPY:
+				case E_GR_IRQ: {
+					int d=masked_grtype(0)-E_GR_CPU;
+
+					if (grlen==0)
+						grlen=HISTORY_CNT;
+					for (i=0;i<grlen;i++) {
+						aa+=config.f.processes?pa->dlyhist_p[d][i]:pa->dlyhist[d][i];
+						ab+=config.f.processes?pb->dlyhist_p[d][i]:pb->dlyhist[d][i];
+					}
+					res=aa-ab;
+					break;
+				}
+			}
+			break;
+		}
+		case SORT_BY_PRIO:
+			res=pa->io_prio-pb->io_prio;
+			break;
+		case SORT_BY_COMMAND:
+			res=strcmp(config.f.fullcmdline?pa->cmdline_long:pa->cmdline_short,config.f.fullcmdline?pb->cmdline_long:pb->cmdline_short);
+			break;
+		case SORT_BY_TID:
+			if (pa->group&&pb->group) // group rows show their task count instead
+				res=config.f.processes?pa->procs-pb->procs:pa->tasks-pb->tasks;
+			else
+				res=pa->tid-pb->tid;
+			break;
+		case SORT_BY_USER:
+			res=strcmp(pa->pw_name,pb->pw_name);
+			break;
+		case SORT_BY_READ:
+			if (config.f.accumbw)
+				res=(config.f.processes?pa->read_val_abw_p:pa->read_val_abw)>(config.f.processes?pb->read_val_abw_p:pb->read_val_abw)?1:
+					(config.f.processes?pa->read_val_abw_p:pa->read_val_abw)<(config.f.processes?pb->read_val_abw_p:pb->read_val_abw)?-1:0;
+			else if (config.f.accumulated)
+				res=(config.f.processes?pa->read_val_acc_p:pa->read_val_acc)>(config.f.processes?pb->read_val_acc_p:pb->read_val_acc)?1:
+					(config.f.processes?pa->read_val_acc_p:pa->read_val_acc)<(config.f.processes?pb->read_val_acc_p:pb->read_val_acc)?-1:0;
+			else
+				res=(config.f.processes?pa->read_val_p:pa->read_val)>(config.f.processes?pb->read_val_p:pb->read_val)?1:
+					(config.f.processes?pa->read_val_p:pa->read_val)<(config.f.processes?pb->read_val_p:pb->read_val)?-1:0;
+			break;
+		case SORT_BY_WRITE:
+			if (config.f.accumbw)
+				res=(config.f.processes?pa->write_val_abw_p:pa->write_val_abw)>(config.f.processes?pb->write_val_abw_p:pb->write_val_abw)?1:
+					(config.f.processes?pa->write_val_abw_p:pa->write_val_abw)<(config.f.processes?pb->write_val_abw_p:pb->write_val_abw)?-1:0;
+			else if (config.f.accumulated)
+				res=(config.f.processes?pa->write_val_acc_p:pa->write_val_acc)>(config.f.processes?pb->write_val_acc_p:pb->write_val_acc)?1:
+					(config.f.processes?pa->write_val_acc_p:pa->write_val_acc)<(config.f.processes?pb->write_val_acc_p:pb->write_val_acc)?-1:0;
+			else
+				res=(config.f.processes?pa->write_val_p:pa->write_val)>(config.f.processes?pb->write_val_p:pb->write_val)?1:
+					(config.f.processes?pa->write_val_p:pa->write_val)<(config.f.processes?pb->write_val_p:pb->write_val)?-1:0;
+			break;
+		case SORT_BY_NWRITE:
+			if (config.f.accumbw)
+				res=(config.f.processes?pa->nwrite_val_abw_p:pa->nwrite_val_abw)>(config.f.processes?pb->nwrite_val_abw_p:pb->nwrite_val_abw)?1:
+					(config.f.processes?pa->nwrite_val_abw_p:pa->nwrite_val_abw)<(config.f.processes?pb->nwrite_val_abw_p:pb->nwrite_val_abw)?-1:0;
+			else if (config.f.accumulated)
+				res=(config.f.processes?pa->nwrite_val_acc_p:pa->nwrite_val_acc)>(config.f.processes?pb->nwrite_val_acc_p:pb->nwrite_val_acc)?1:
+					(config.f.processes?pa->nwrite_val_acc_p:pa->nwrite_val_acc)<(config.f.processes?pb->nwrite_val_acc_p:pb->nwrite_val_acc)?-1:0;
+			else
+				res=(config.f.processes?pa->nwrite_val_p:pa->nwrite_val)>(config.f.processes?pb->nwrite_val_p:pb->nwrite_val)?1:
+					(config.f.processes?pa->nwrite_val_p:pa->nwrite_val)<(config.f.processes?pb->nwrite_val_p:pb->nwrite_val)?-1:0;
+			break;
+		case SORT_BY_SWAPIN:
+			res=(config.f.processes?pa->swapin_val_p:pa->swapin_val)>(config.f.processes?pb->swapin_val_p:pb->swapin_val)?1:
+				(config.f.processes?pa->swapin_val_p:pa->swapin_val)<(config.f.processes?pb->swapin_val_p:pb->swapin_val)?-1:0;
+			break;
+		case SORT_BY_IO:
+			res=(config.f.processes?pa->blkio_val_p:pa->blkio_val)>(config.f.processes?pb->blkio_val_p:pb->blkio_val)?1:
+				(config.f.processes?pa->blkio_val_p:pa->blkio_val)<(config.f.processes?pb->blkio_val_p:pb->blkio_val)?-1:0;
+			break;
+		case SORT_BY_DCPU:
+		case SORT_BY_DMEM:
+		case SORT_BY_DTHRASH:
+		case SORT_BY_DCOMPACT:
+		case SORT_BY_DWPCOPY:
+		case SORT_BY_DIRQ: {
+			int i=masked_sort_by(0)-SORT_BY_DCPU;
+
+			res=(config.f.processes?pa->delay_val_p[i]:pa->delay_val[i])>(config.f.processes?pb->delay_val_p[i]:pb->delay_val[i])?1:
+				(config.f.processes?pa->delay_val_p[i]:pa->delay_val[i])<(config.f.processes?pb->delay_val_p[i]:pb->delay_val[i])?-1:0;
+			break;
+		}
+		case SORT_BY_LREAD:
+		case SORT_BY_LWRITE:
+		case SORT_BY_SYSCR:
+		case SORT_BY_SYSCW: {
+			int i=masked_sort_by(0)-SORT_BY_LREAD;
+
+			res=lio_value(pa,i)>lio_value(pb,i)?1:lio_value(pa,i)<lio_value(pb,i)?-1:0;
+			break;
+		}
+		case SORT_BY_PSI:
+			res=pa->psi_val>pb->psi_val?1:pa->psi_val<pb->psi_val?-1:0;
+			break;
+		case SORT_BY_PREAD:
+		case SORT_BY_PWRITE:
+		case SORT_BY_PIO: {
+			int i=masked_sort_by(0)-SORT_BY_PREAD;
+
+			res=pctl_value(pa,i)>pctl_value(pb,i)?1:pctl_value(pa,i)<pctl_value(pb,i)?-1:0;
+			break;
+		}
+	}
+	res*=order;
+	return res;
+}
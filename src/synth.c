@@ -0,0 +1,255 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+// --bench: a generated task population with a generated counter stream,
+// served through the collector interface so that everything after the
+// /proc walk runs unchanged
+
+#include "iotop.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#define SYNTH_THREADS 4 // tasks per process, the first one is the process itself
+#define SYNTH_USERS 16
+#define SYNTH_ACTIVE 8 // one in that many tasks does I/O in a cycle
+#define SYNTH_CHURN 100 // one in that many processes is replaced in a cycle
+#define SYNTH_TID0 1000
+
+struct synth_task {
+	pid_t tid;
+	pid_t pid;
+	uid_t euid;
+	uint64_t read_bytes;
+	uint64_t write_bytes;
+	uint64_t cancelled_write_bytes;
+	uint64_t swapin_delay_total;
+	uint64_t blkio_delay_total;
+	uint64_t read_char;
+	uint64_t write_char;
+	uint64_t read_syscalls;
+	uint64_t write_syscalls;
+};
+
+static struct synth_task *sy_task=NULL; // sorted by tid like the /proc walk
+static int sy_cnt=0;
+static int sy_want=0;
+static pid_t sy_tid=SYNTH_TID0; // next free tid
+static uint64_t sy_rnd=0x9e3779b97f4a7c15ULL; // fixed seed, the runs are comparable
+static uint64_t sy_ms=0; // synthetic clock
+static uint64_t sy_rbytes=0; // the block I/O of all tasks, for Current DISK READ/WRITE
+static uint64_t sy_wbytes=0;
+static int sy_cycles=0;
+static size_t sy_heap1=0; // heap in use after the first cycle
+static size_t sy_heapn=0; // and after the last one
+
+static inline uint64_t sy_rand(void) { // xorshift64*
+	sy_rnd^=sy_rnd>>12;
+	sy_rnd^=sy_rnd<<25;
+	sy_rnd^=sy_rnd>>27;
+	return sy_rnd*0x2545f4914f6cdd1dULL;
+}
+
+static inline size_t sy_heap(void) {
+#if defined(__GLIBC__)&&(__GLIBC__>2||(__GLIBC__==2&&__GLIBC_MINOR__>=33))
+	struct mallinfo2 mi=mallinfo2();
+
+	return mi.uordblks+mi.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+// append a process with its threads, stops at sy_want tasks
+static inline void sy_spawn(void) {
+	pid_t pid=sy_tid;
+	uid_t euid=sy_rand()%SYNTH_USERS;
+	int i;
+
+	for (i=0;i<SYNTH_THREADS&&sy_cnt<sy_want;i++) {
+		struct synth_task *t=sy_task+sy_cnt++;
+
+		memset(t,0,sizeof *t);
+		t->tid=sy_tid++;
+		t->pid=pid;
+		t->euid=euid;
+	}
+}
+
+static inline void sy_advance(struct synth_task *t) {
+	uint64_t r=sy_rand();
+
+	if (r%SYNTH_ACTIVE)
+		return;
+	r>>=8;
+	t->read_bytes+=(r&0xff)<<12;
+	t->write_bytes+=((r>>8)&0xff)<<12;
+	sy_rbytes+=(r&0xff)<<12;
+	sy_wbytes+=((r>>8)&0xff)<<12;
+	if (!((r>>16)&0xf))
+		t->cancelled_write_bytes+=4096;
+	t->read_char+=(r&0xffff)<<4;
+	t->write_char+=((r>>8)&0xffff)<<4;
+	t->read_syscalls+=(r>>24)&0xff;
+	t->write_syscalls+=(r>>32)&0xff;
+	t->blkio_delay_total+=((r>>40)&0xff)*100000;
+	if (!((r>>48)&0x3f))
+		t->swapin_delay_total+=((r>>54)&0xff)*100000;
+}
+
+// once before each walk: replace some processes and advance the counters
+static void synth_cycle(void) {
+	int i,n,gone=0;
+
+	// the data of the previous cycle is still held here
+	if (++sy_cycles>1)
+		sy_heapn=sy_heap();
+	if (sy_cycles==2)
+		sy_heap1=sy_heapn;
+	sy_ms+=trigger_period();
+	if (sy_cycles>1) {
+		for (i=n=0;i<sy_cnt;i++) {
+			struct synth_task *t=sy_task+i;
+
+			if (t->tid==t->pid)
+				gone=!(sy_rand()%SYNTH_CHURN);
+			if (!gone)
+				sy_task[n++]=*t;
+		}
+		sy_cnt=n;
+	}
+	while (sy_cnt<sy_want)
+		sy_spawn();
+	for (i=0;i<sy_cnt;i++)
+		sy_advance(sy_task+i);
+}
+
+static int synth_info(pid_t tid,pid_t pid,struct xxxid_stats *s) {
+	int l=0,h=sy_cnt-1;
+
+	while (l<=h) {
+		int m=l+(h-l)/2;
+		struct synth_task *t=sy_task+m;
+
+		if (t->tid<tid)
+			l=m+1;
+		else if (t->tid>tid)
+			h=m-1;
+		else {
+			s->tid=tid;
+			s->pid=pid;
+			s->euid=t->euid;
+			s->read_bytes=t->read_bytes;
+			s->write_bytes=t->write_bytes;
+			s->cancelled_write_bytes=t->cancelled_write_bytes;
+			s->swapin_delay_total=t->swapin_delay_total;
+			s->blkio_delay_total=t->blkio_delay_total;
+			s->read_char=t->read_char;
+			s->write_char=t->write_char;
+			s->read_syscalls=t->read_syscalls;
+			s->write_syscalls=t->write_syscalls;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static void synth_close(void) {
+	free(sy_task);
+	sy_task=NULL;
+	sy_cnt=sy_want=0;
+}
+
+static struct collector sy_col={"synthetic",NULL,synth_close,synth_cycle,synth_info,1};
+
+inline const struct collector *synth_open(int tasks) {
+	sy_task=calloc(tasks,sizeof *sy_task);
+	if (!sy_task) {
+		fprintf(stderr,"%s: can not allocate %d tasks\n",__func__,tasks);
+		return NULL;
+	}
+	sy_want=tasks;
+	sy_ms=monotime();
+	return &sy_col;
+}
+
+// the replacement of pidgen_cb and make_stats
+inline void synth_fill(struct xxxid_stats_arr *a,filter_callback filter,void (*add)(struct xxxid_stats_arr *,struct xxxid_stats *,filter_callback)) {
+	char buf[64];
+	int i;
+
+	for (i=0;i<sy_cnt;i++) {
+		struct synth_task *t=sy_task+i;
+		struct xxxid_stats *s=calloc(1,sizeof *s);
+		uint64_t p;
+
+		if (!s)
+			continue;
+		p=prof_start();
+		if (collector->info(t->tid,t->pid,s))
+			s->error_x=1;
+		prof_end(PROF_COLLECT,p);
+		s->ts_smp=sy_ms;
+		s->io_prio=ioprio_value(IOPRIO_CLASS_BE,4);
+
+		p=prof_start();
+		snprintf(buf,sizeof buf,"/usr/bin/synth%d --worker=%d",t->pid%97,t->tid-t->pid);
+		s->cmdline_long=strdup(buf);
+		s->cmdline_short=strdup(buf+9);
+		prof_end(PROF_CMDLINE,p);
+		snprintf(buf,sizeof buf,"user%u",(unsigned)t->euid);
+		s->pw_name=strdup(buf);
+		if (!s->cmdline_long||!s->cmdline_short||!s->pw_name) {
+			free_stats(s);
+			continue;
+		}
+		add(a,s,filter);
+	}
+}
+
+inline uint64_t synth_time(void) {
+	return sy_ms;
+}
+
+inline int synth_vm_counters(uint64_t *pgpgin,uint64_t *pgpgou) {
+	*pgpgin=sy_rbytes;
+	*pgpgou=sy_wbytes;
+	return 0;
+}
+
+// per phase cost and throughput at exit
+inline void synth_report(void) {
+	const struct prof_stats *c=prof_get(PROF_PIDGEN);
+	uint64_t all=0;
+	int i;
+
+	if (!c->cnt)
+		return;
+	fprintf(stderr,"%d tasks, %llu cycles\n",sy_want,(unsigned long long)c->cnt);
+	prof_summary();
+	fprintf(stderr,"\n%-8s %12s %14s\n","PHASE","MS/CYCLE","TASKS/S");
+	for (i=0;i<=PROF_MAX;i++) {
+		const struct prof_stats *p=prof_get(i);
+		uint64_t total=p?p->total:all;
+
+		if (p)
+			all+=total;
+		fprintf(stderr,"%-8s %12.3f %14.0f\n",p?prof_phase(i):"all",total/1e6/c->cnt,total?(double)sy_want*c->cnt*1e9/total:0);
+	}
+	if (sy_heapn)
+		fprintf(stderr,"\nheap in use %.1f MiB, %.0f bytes per task, %+.1f MiB since the first cycle\n",sy_heapn/1048576.0,(double)sy_heapn/sy_want,((double)sy_heapn-sy_heap1)/1048576.0);
+}
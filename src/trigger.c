@@ -0,0 +1,338 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+// --trigger: rules checked once per cycle after create_diff; a rule fires
+// when its value stays over the limit for the given number of intervals in
+// a row and fires again only after it drops below; only the tasks with I/O
+// in the interval are checked, create_diff collects them, so a cycle costs
+// O(active tasks)
+
+#include "iotop.h"
+
+#include <time.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+typedef enum {
+	E_TA_EXEC, // run a command with /bin/sh
+	E_TA_DUMP, // append the history of the tasks to a file
+	E_TA_CAPTURE, // sample with a short interval for a while
+	E_TA_RING, // write the --ring frames, see record.c
+} e_taction;
+
+struct trigger {
+	char *spec; // as given, for the hook and the dump
+	int total; // the sum of all tasks instead of each task
+	int value; // HG_READ, HG_WRITE or HG_BLKIO
+	double limit; // bytes/s or % of the time
+	int count; // intervals in a row over the limit
+	int run; // of a total rule, the intervals in a row so far
+	e_taction action;
+	char *arg; // command or file name
+	int cap_s; // capture window length
+	int cap_ms; // and its interval
+};
+
+static struct trigger tg[TRIGGER_MAX];
+static int tg_cnt=0;
+static uint64_t tg_ts=0; // the last cycle checked, a redraw does not count again
+static uint64_t tg_cap_end=0; // the capture window lasts until that cycle time
+static int tg_cap_ms=0;
+
+static inline double tg_value(const struct xxxid_stats *s,int v) {
+	switch (v) {
+		case HG_READ:
+			return s->read_val;
+		case HG_WRITE:
+			return s->write_val;
+		case HG_BLKIO:
+			return s->blkio_val;
+	}
+	return 0;
+}
+
+// RULE:ACTION where RULE is [total-]read|write|io>LIMIT[/N] and ACTION is
+// exec=CMD, dump=FILE, capture=SEC[/MS] or ring
+inline int trigger_add(const char *spec) {
+	struct trigger *t=tg+tg_cnt;
+	const char *s=spec;
+	char *e;
+
+	if (tg_cnt>=TRIGGER_MAX)
+		return -1;
+	memset(t,0,sizeof *t);
+	if (!strncmp(s,"total-",6)) {
+		t->total=1;
+		s+=6;
+	}
+	if (!strncmp(s,"read>",5)) {
+		t->value=HG_READ;
+		s+=5;
+	} else if (!strncmp(s,"write>",6)) {
+		t->value=HG_WRITE;
+		s+=6;
+	} else if (!strncmp(s,"io>",3)) {
+		t->value=HG_BLKIO;
+		s+=3;
+	} else
+		return -1;
+	t->limit=strtod(s,&e);
+	if (e==s||t->limit<0)
+		return -1;
+	s=e;
+	if (t->value!=HG_BLKIO)
+		switch (*s) {
+			case 'K':
+			case 'k':
+				t->limit*=1024.0;
+				s++;
+				break;
+			case 'M':
+			case 'm':
+				t->limit*=1024.0*1024.0;
+				s++;
+				break;
+			case 'G':
+			case 'g':
+				t->limit*=1024.0*1024.0*1024.0;
+				s++;
+				break;
+		}
+	else if (t->limit>100) // a share of the time
+		return -1;
+	else if (*s=='%')
+		s++;
+	t->count=1;
+	if (*s=='/') {
+		t->count=strtol(s+1,&e,10);
+		if (e==s+1||t->count<1||t->count>255)
+			return -1;
+		s=e;
+	}
+	if (*s++!=':')
+		return -1;
+	if (!strncmp(s,"exec=",5)&&s[5]) {
+		t->action=E_TA_EXEC;
+		t->arg=strdup(s+5);
+	} else if (!strncmp(s,"dump=",5)&&s[5]) {
+		t->action=E_TA_DUMP;
+		t->arg=strdup(s+5);
+	} else if (!strncmp(s,"capture=",8)) {
+		t->action=E_TA_CAPTURE;
+		t->cap_s=strtol(s+8,&e,10);
+		t->cap_ms=100;
+		if (e==s+8||t->cap_s<1)
+			return -1;
+		if (*e=='/') {
+			s=e+1;
+			t->cap_ms=strtol(s,&e,10);
+			if (e==s||t->cap_ms<10)
+				return -1;
+		}
+		if (*e)
+			return -1;
+	} else if (!strcmp(s,"ring"))
+		t->action=E_TA_RING;
+	else
+		return -1;
+	if ((t->action==E_TA_EXEC||t->action==E_TA_DUMP)&&!t->arg)
+		return -1;
+	t->spec=strdup(spec);
+	if (!t->spec) {
+		free(t->arg);
+		return -1;
+	}
+	tg_cnt++;
+	return 0;
+}
+
+inline int trigger_count(void) {
+	return tg_cnt;
+}
+
+// the sampling period in ms, shorter while a capture window is open
+inline uint64_t trigger_period(void) {
+	if (tg_cap_end&&tg_ts<tg_cap_end)
+		return tg_cap_ms;
+	return 1000*(uint64_t)params.delay;
+}
+
+// open or extend the capture window from the last cycle on
+inline void trigger_capture(int sec,int ms) {
+	uint64_t end=tg_ts+1000*(uint64_t)sec;
+
+	if (end>tg_cap_end)
+		tg_cap_end=end;
+	tg_cap_ms=ms;
+}
+
+static inline void tg_exec(const struct trigger *t,const struct xxxid_stats *s,double v) {
+	char val[32];
+	char id[16];
+	pid_t pid;
+
+	pid=fork();
+	if (pid) // the parent does not wait, the child is reaped by a later check
+		return;
+	if (!config.f.batch_mode) { // keep the screen clean
+		int fd=open("/dev/null",O_RDWR);
+
+		if (fd!=-1) {
+			dup2(fd,0);
+			dup2(fd,1);
+			dup2(fd,2);
+			if (fd>2)
+				close(fd);
+		}
+	}
+	snprintf(val,sizeof val,"%.2f",v);
+	setenv("IOTOP_TRIGGER",t->spec,1);
+	setenv("IOTOP_VALUE",val,1);
+	if (s) {
+		snprintf(id,sizeof id,"%d",s->tid);
+		setenv("IOTOP_TID",id,1);
+		snprintf(id,sizeof id,"%d",s->pid);
+		setenv("IOTOP_PID",id,1);
+		if (s->cmdline_short)
+			setenv("IOTOP_COMMAND",s->cmdline_short,1);
+	}
+	execl("/bin/sh","sh","-c",t->arg,(char *)NULL);
+	_exit(127);
+}
+
+// the last HISTORY_CNT intervals of each task that did some I/O in them
+static inline void tg_dump(const struct trigger *t,struct xxxid_stats_arr *cs,const struct xxxid_stats *s,double v) {
+	FILE *f=fopen(t->arg,"a");
+	char tb[32];
+	time_t now;
+	int i,j;
+
+	if (!f)
+		return;
+	now=time(NULL);
+	strftime(tb,sizeof tb,"%Y-%m-%d %H:%M:%S",localtime(&now));
+	fprintf(f,"# %s %s fired",tb,t->spec);
+	if (s)
+		fprintf(f," by tid %d",s->tid);
+	fprintf(f," at %.2f\n",v);
+	fprintf(f,"# tid,pid,user,ago,read_bytes,write_bytes,io,command\n");
+	for (i=0;cs->arr&&i<cs->length;i++) {
+		const struct xxxid_stats *c=cs->arr[i];
+
+		for (j=0;j<HISTORY_CNT;j++)
+			if (c->readhist[j]||c->writehist[j]||c->iohist[j])
+				fprintf(f,"%d,%d,%s,%d,%.0f,%.0f,%u,%s\n",c->tid,c->pid,c->pw_name?c->pw_name:"",j,c->readhist[j],c->writehist[j],c->iohist[j],c->cmdline_short?c->cmdline_short:"");
+	}
+	fclose(f);
+}
+
+static inline void tg_fire(const struct trigger *t,struct xxxid_stats_arr *cs,const struct xxxid_stats *s,double v) {
+	switch (t->action) {
+		case E_TA_EXEC:
+			tg_exec(t,s,v);
+			break;
+		case E_TA_DUMP:
+			tg_dump(t,cs,s,v);
+			break;
+		case E_TA_CAPTURE:
+			trigger_capture(t->cap_s,t->cap_ms);
+			break;
+		case E_TA_RING:
+			ring_flush();
+			break;
+	}
+}
+
+inline void trigger_check(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,uint64_t ts) {
+	struct xxxid_stats *top[TRIGGER_MAX]; // the task with the biggest value that got to count
+	double topv[TRIGGER_MAX];
+	double sum[HG_MAX]={0,}; // of the total rules
+	struct xxxid_stats **a;
+	int i,r,len;
+
+	if (!cs||ts==tg_ts)
+		return;
+	tg_ts=ts; // the clock of the capture window
+	if (!tg_cnt)
+		return;
+	while (waitpid(-1,NULL,WNOHANG)>0) // reap the finished hooks
+		;
+	memset(top,0,sizeof top);
+	a=cs->act?cs->act:cs->arr;
+	len=cs->act?cs->act_len:cs->length;
+	for (i=0;a&&i<len;i++) {
+		struct xxxid_stats *c=a[i];
+		struct xxxid_stats *p=NULL;
+
+		if (c->idle||c->exited) // all values are 0, no counter can go on
+			continue;
+		// IO is a share of the time of each task, their sum means nothing;
+		// total-io is the busiest task like in the process and group rows
+		sum[HG_READ]+=tg_value(c,HG_READ);
+		sum[HG_WRITE]+=tg_value(c,HG_WRITE);
+		if (tg_value(c,HG_BLKIO)>sum[HG_BLKIO])
+			sum[HG_BLKIO]=tg_value(c,HG_BLKIO);
+		for (r=0;r<tg_cnt;r++) {
+			double v;
+
+			if (tg[r].total)
+				continue;
+			v=tg_value(c,tg[r].value);
+			if (v<=tg[r].limit) {
+				c->trig_run[r]=0;
+				continue;
+			}
+			if (!p)
+				p=arr_find(ps,c->tid);
+			// an idle task was skipped, its counter is from an older cycle;
+			// it stops at 255, the rule fires only once when it gets to count
+			if (p&&!p->idle)
+				c->trig_run[r]=p->trig_run[r]<255?p->trig_run[r]+1:255;
+			else
+				c->trig_run[r]=1;
+			if (c->trig_run[r]==tg[r].count&&(!top[r]||v>topv[r])) {
+				top[r]=c;
+				topv[r]=v;
+			}
+		}
+	}
+	for (r=0;r<tg_cnt;r++) {
+		if (tg[r].total) {
+			if (sum[tg[r].value]<=tg[r].limit) {
+				tg[r].run=0;
+				continue;
+			}
+			if (++tg[r].run==tg[r].count)
+				tg_fire(tg+r,cs,NULL,sum[tg[r].value]);
+			if (tg[r].run>tg[r].count)
+				tg[r].run=tg[r].count+1;
+		} else if (top[r])
+			tg_fire(tg+r,cs,top[r],topv[r]);
+	}
+}
+
+inline void trigger_fini(void) {
+	int i;
+
+	for (i=0;i<tg_cnt;i++) {
+		free(tg[i].spec);
+		free(tg[i].arg);
+	}
+	memset(tg,0,sizeof tg);
+	tg_cnt=0;
+	tg_ts=tg_cap_end=0;
+}
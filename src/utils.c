@@ -17,7 +17,6 @@ You should have received a copy of the GNU General Public License along with thi
 #include <fcntl.h>
 #include <stdio.h>
 #include <wchar.h>
-#include <dirent.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -143,45 +142,6 @@ inline void read_cmdlines(int pid,char **cmd_long,char **cmd_short,char **cmd_co
 	}
 }
 
-inline void pidgen_cb(pg_cb cb,struct xxxid_stats_arr *hint1,filter_callback hint2) {
-	DIR *pr;
-
-	if ((pr=opendir("/proc"))) {
-		struct dirent *de=readdir(pr);
-
-		for (;de;de=readdir(pr)) {
-			char *eol=NULL;
-			char path[30];
-			int havt=0;
-			pid_t pid;
-			DIR *tr;
-
-			pid=strtol(de->d_name,&eol,10);
-			if (*eol!='\0')
-				continue;
-			snprintf(path,sizeof path,"/proc/%d/task",pid);
-			if ((tr=opendir(path))) {
-				struct dirent *tde=readdir(tr);
-
-				for (;tde;tde=readdir(tr)) {
-					pid_t tid;
-
-					eol=NULL;
-					tid=strtol(tde->d_name,&eol,10);
-					if (*eol!='\0')
-						continue;
-					havt=1;
-					cb(pid,tid,hint1,hint2);
-				}
-				closedir(tr);
-			}
-			if (!havt)
-				cb(pid,pid,hint1,hint2);
-		}
-		closedir(pr);
-	}
-}
-
 inline int64_t monotime(void) {
 	struct timespec ts;
 	int64_t res;
@@ -192,6 +152,13 @@ inline int64_t monotime(void) {
 	return res;
 }
 
+inline uint64_t monotime_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec*1000000000ULL+ts.tv_nsec;
+}
+
 inline const char *esc_low_ascii1(char c) {
 	// some architectures have char type unsigned by default
 	// while others have a signed char; make the check for
@@ -348,6 +315,93 @@ inline char *u8strpadt(const char *s,ssize_t rlen) {
 	return d;
 }
 
+// esc_low_ascii and then u8strpadt in a single pass without allocations
+// once b is large enough; len<0 only escapes, like esc_low_ascii alone
+inline const char *u8fmt(struct u8buf *b,const char *s,ssize_t len,int esc) {
+	size_t need;
+	size_t si=0;
+	size_t di=0;
+	size_t tl=0;
+	size_t sl;
+	wchar_t w;
+
+	if (!s)
+		s="(null)";
+	sl=strlen(s);
+	need=(esc?5*sl:sl)+(len>0?(size_t)len:0)+1; // an escape is up to 5 chars
+	if (b->sz<need) {
+		char *t=realloc(b->p,need);
+
+		if (!t)
+			return NULL;
+		b->p=t;
+		b->sz=need;
+	}
+	if (len<0) {
+		while (s[si]) {
+			const char *rs=esc?esc_low_ascii1(s[si]):NULL;
+
+			if (!rs)
+				b->p[di++]=s[si];
+			else
+				while (*rs)
+					b->p[di++]=*rs++;
+			si++;
+		}
+		b->p[di]=0;
+		return b->p;
+	}
+	if (mbtowc(NULL,NULL,0)) {
+	}
+	while (s[si]) {
+		unsigned char c=s[si];
+		int cl;
+		int tw;
+
+		if (c<0x80) { // plain ascii needs no mbtowc and wcwidth
+			const char *rs=esc?esc_low_ascii1(c):NULL;
+
+			si++;
+			if (rs) { // the escape chars are one column each
+				while (*rs&&tl<(size_t)len) {
+					b->p[di++]=*rs++;
+					tl++;
+				}
+				if (*rs)
+					break;
+			} else if (c>=0x20&&c<0x7f) {
+				if (tl>=(size_t)len)
+					break;
+				b->p[di++]=c;
+				tl++;
+			}
+			continue;
+		}
+		cl=mbtowc(&w,s+si,sl-si);
+		if (cl<=0) {
+			si++;
+			continue;
+		}
+		tw=wcwidth(w);
+		if (tw<0) {
+			si+=cl;
+			continue;
+		}
+		if (tw&&tw+tl>(size_t)len)
+			break;
+		memcpy(b->p+di,s+si,cl);
+		di+=cl;
+		si+=cl;
+		tl+=tw;
+	}
+	while (tl<(size_t)len) {
+		b->p[di++]=' ';
+		tl++;
+	}
+	b->p[di]=0;
+	return b->p;
+}
+
 inline int is_a_file(const char *p) {
 	struct stat st;
 
@@ -365,8 +419,17 @@ inline int is_a_dir(const char *p) {
 }
 
 inline int is_a_process(pid_t tid) {
+	int pfd=proc_dirfd();
 	char path[35];
 
+	if (pfd!=-1) { // avoid the full path lookup
+		struct stat st;
+
+		snprintf(path,sizeof path,"%d/stat",tid);
+		if (fstatat(pfd,path,&st,AT_SYMLINK_NOFOLLOW))
+			return 0;
+		return (st.st_mode&S_IFMT)==S_IFREG;
+	}
 	snprintf(path,sizeof path,"/proc/%d/stat",tid);
 	return is_a_file(path);
 }
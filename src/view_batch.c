@@ -14,137 +14,759 @@ You should have received a copy of the GNU General Public License along with thi
 #include "iotop.h"
 
 #include <time.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+static const char *delay_name[DLY_MAX]={"CPU","MEM","THRASH","COMPACT","WPCOPY","IRQ",};
+static struct u8buf fb_pw={NULL,0}; // formatted user and command of a task line
+static struct u8buf fb_cmd={NULL,0};
+static struct xxxid_stats_arr *bt_shown=NULL; // the data of the last iteration, for the --percentiles report
+static const char *hg_name[HG_MAX]={"read","write","blkio",};
+static const int hg_pct[3]={50,95,99};
+
+// counters of the machine readable formats; each one is followed by its
+// delta over the iteration and by the rate (per second or % for delays)
+enum {
+	FC_READ,
+	FC_WRITE,
+	FC_CANCELLED,
+	FC_RCHAR, // FC_RCHAR..FC_SYSCW are in the order of LIO_*
+	FC_WCHAR,
+	FC_SYSCR,
+	FC_SYSCW,
+	FC_SWAPIN,
+	FC_BLKIO,
+	FC_DCPU, // FC_DCPU..FC_DIRQ are in the order of DLY_*
+	FC_DMEM,
+	FC_DTHRASH,
+	FC_DCOMPACT,
+	FC_DWPCOPY,
+	FC_DIRQ,
+	FC_MAX
+};
+
+static const char *fc_name[FC_MAX]={
+	"read_bytes",
+	"write_bytes",
+	"cancelled_write_bytes",
+	"rchar",
+	"wchar",
+	"syscr",
+	"syscw",
+	"swapin_delay",
+	"blkio_delay",
+	"cpu_delay",
+	"mem_delay",
+	"thrash_delay",
+	"compact_delay",
+	"wpcopy_delay",
+	"irq_delay",
+};
+
+static const char *fc_rate_name[FC_MAX]={
+	"read_rate",
+	"write_rate",
+	"cancelled_write_rate",
+	"rchar_rate",
+	"wchar_rate",
+	"syscr_rate",
+	"syscw_rate",
+	"swapin_pct",
+	"blkio_pct",
+	"cpu_pct",
+	"mem_pct",
+	"thrash_pct",
+	"compact_pct",
+	"wpcopy_pct",
+	"irq_pct",
+};
+
+static inline int fc_available(int i) {
+	if (i>=FC_SWAPIN&&!collector->has_delays)
+		return 0;
+	if (i>=FC_DCPU)
+		return delay_available(i-FC_DCPU);
+	return 1;
+}
+
+static inline uint64_t fc_counter(struct xxxid_stats *s,int i) {
+	int p=config.f.processes;
+
+	switch (i) {
+		case FC_READ:
+			return p?s->read_bytes_p:s->read_bytes;
+		case FC_WRITE:
+			return p?s->write_bytes_p:s->write_bytes;
+		case FC_CANCELLED:
+			return p?s->cancelled_write_bytes_p:s->cancelled_write_bytes;
+		case FC_RCHAR:
+		case FC_WCHAR:
+		case FC_SYSCR:
+		case FC_SYSCW:
+			return p?s->lio_p[i-FC_RCHAR]:lio_counter(s,i-FC_RCHAR);
+		case FC_SWAPIN:
+			return p?s->swapin_delay_total_p:s->swapin_delay_total;
+		case FC_BLKIO:
+			return p?s->blkio_delay_total_p:s->blkio_delay_total;
+		default:
+			return p?s->delay_total_p[i-FC_DCPU]:s->delay_total[i-FC_DCPU];
+	}
+}
+
+// the rates come from create_diff, they account for --sampling
+static inline double fc_rate(struct xxxid_stats *s,int i) {
+	int p=config.f.processes;
+
+	switch (i) {
+		case FC_READ:
+			return p?s->read_val_p:s->read_val;
+		case FC_WRITE:
+			return p?s->write_val_p:s->write_val;
+		case FC_CANCELLED:
+			return p?s->cwrite_val_p:s->cwrite_val;
+		case FC_RCHAR:
+		case FC_WCHAR:
+		case FC_SYSCR:
+		case FC_SYSCW:
+			return p?s->lio_val_p[i-FC_RCHAR]:s->lio_val[i-FC_RCHAR];
+		case FC_SWAPIN:
+			return p?s->swapin_val_p:s->swapin_val;
+		case FC_BLKIO:
+			return p?s->blkio_val_p:s->blkio_val;
+		default:
+			return p?s->delay_val_p[i-FC_DCPU]:s->delay_val[i-FC_DCPU];
+	}
+}
+
+static inline void fmt_header(void) {
+	int i;
+
+	if (params.format==E_FMT_JSON)
+		return;
+	obuf_str("ts,interval,total_read,total_write,current_read,current_write,pid,tid,uid,user,prio");
+	for (i=0;i<FC_MAX;i++) {
+		obuf_chr(',');
+		obuf_str(fc_name[i]);
+		obuf_chr(',');
+		obuf_str(fc_name[i]);
+		obuf_str("_delta,");
+		obuf_str(fc_rate_name[i]);
+	}
+	obuf_str(",command\n");
+}
+
+// number or null/empty for unavailable values
+#define FMT_NUM(avail,out) do { \
+	if (avail) \
+		out; \
+	else if (params.format==E_FMT_JSON) \
+		obuf_str("null"); \
+} while (0)
+
+#define FMT_KEY(k) do { \
+	if (params.format==E_FMT_JSON) { \
+		obuf_str(",\""); \
+		obuf_str(k); \
+		obuf_str("\":"); \
+	} else \
+		obuf_chr(','); \
+} while (0)
+
+static inline void fmt_task(struct xxxid_stats *s,struct xxxid_stats *p,const char *prefix) {
+	int js=params.format==E_FMT_JSON;
+	char *cmd;
+	int i;
+
+	if (config.f.fullcmdline&&s->cmdline_comm) {
+		cmd=malloc(1+strlen(s->cmdline_comm)+1+strlen(s->cmdline_long)+1);
+		if (cmd)
+			sprintf(cmd,"[%s]%s",s->cmdline_comm,s->cmdline_long);
+	} else
+		cmd=NULL;
+
+	obuf_str(prefix);
+	if (js)
+		obuf_str(",\"pid\":");
+	else
+		obuf_chr(',');
+	obuf_i64(s->pid);
+	FMT_KEY("tid");
+	obuf_i64(s->tid);
+	FMT_KEY("uid");
+	obuf_i64(s->euid);
+	FMT_KEY("user");
+	if (js)
+		obuf_json(s->pw_name?s->pw_name:"");
+	else
+		obuf_csv(s->pw_name?s->pw_name:"");
+	FMT_KEY("prio");
+	if (s->error_i) {
+		if (js)
+			obuf_str("null");
+	} else {
+		if (js)
+			obuf_json(str_ioprio(s->io_prio));
+		else
+			obuf_str(str_ioprio(s->io_prio));
+	}
+	if (js&&s->group) { // CSV keeps its columns, pid and tid are the group id there
+		FMT_KEY("tasks");
+		obuf_i64(s->tasks);
+		FMT_KEY("procs");
+		obuf_i64(s->procs);
+		if (!column_hidden(SORT_BY_PSI)) {
+			FMT_KEY("io_psi");
+			obuf_fix(s->psi_val,2);
+		}
+	}
+	for (i=0;js&&config.f.pctl&&i<HG_MAX;i++) { // CSV keeps its columns
+		char k[16];
+
+		snprintf(k,sizeof k,"%s_p%d",hg_name[i],config.f.pctl);
+		FMT_KEY(k);
+		obuf_fix(pctl_value(s,i),i==HG_BLKIO?2:1);
+	}
+	for (i=0;i<FC_MAX;i++) {
+		int av=fc_available(i)&&!s->error_x;
+		uint64_t c=fc_counter(s,i);
+		uint64_t o=p?fc_counter(p,i):c;
+
+		FMT_KEY(fc_name[i]);
+		FMT_NUM(av,obuf_u64(c));
+		if (js) {
+			obuf_str(",\"");
+			obuf_str(fc_name[i]);
+			obuf_str("_delta\":");
+		} else
+			obuf_chr(',');
+		FMT_NUM(av,obuf_u64(c>=o?c-o:0)); // counters never go back unless the tid is reused
+		FMT_KEY(fc_rate_name[i]);
+		FMT_NUM(av,obuf_fix(fc_rate(s,i),i>=FC_SWAPIN?2:1));
+	}
+	FMT_KEY("command");
+	if (js)
+		obuf_json(cmd?cmd:config.f.fullcmdline?s->cmdline_long:s->cmdline_short);
+	else
+		obuf_csv(cmd?cmd:config.f.fullcmdline?s->cmdline_long:s->cmdline_short);
+	obuf_str(js?"}\n":"\n");
+
+	if (cmd)
+		free(cmd);
+}
+
+// --filter
+static inline int batch_nomatch(struct xxxid_stats *s) {
+	if (params.search_regx_ok) {
+		int ma_long,ma_short,ma_comm,ma_tid;
+		char tid[22];
+
+		sprintf(tid,"%lu",(unsigned long)s->tid);
+		ma_long=regexec(&params.search_regx,s->cmdline_long,0,NULL,0);
+		ma_short=regexec(&params.search_regx,s->cmdline_short,0,NULL,0);
+		if (s->cmdline_comm)
+			ma_comm=regexec(&params.search_regx,s->cmdline_comm,0,NULL,0);
+		else
+			ma_comm=REG_NOMATCH;
+		ma_tid=regexec(&params.search_regx,tid,0,NULL,0);
+		if (ma_long&&ma_short&&ma_comm&&ma_tid) // nothing matches
+			return 1;
+	}
+	return 0;
+}
+
+// processes mode, --only, exited tasks and --filter
+static inline int batch_skip(struct xxxid_stats *s) {
+	double read_val,write_val,swapin_val,blkio_val;
+
+	if (config.f.accumbw) {
+		read_val=config.f.processes?s->read_val_abw_p:s->read_val_abw;
+		write_val=config.f.processes?s->write_val_abw_p:s->write_val_abw;
+	} else if (config.f.accumulated) {
+		read_val=config.f.processes?s->read_val_acc_p:s->read_val_acc;
+		write_val=config.f.processes?s->write_val_acc_p:s->write_val_acc;
+	} else {
+		read_val=config.f.processes?s->read_val_p:s->read_val;
+		write_val=config.f.processes?s->write_val_p:s->write_val;
+	}
+	swapin_val=config.f.processes?s->swapin_val_p:s->swapin_val;
+	blkio_val=config.f.processes?s->blkio_val_p:s->blkio_val;
+
+	if (config.f.processes&&s->pid!=s->tid)
+		return 1;
+	if (config.f.only&&!read_val&&!write_val&&!swapin_val&&!blkio_val&&(!config.f.logical||(!lio_value(s,LIO_RCHAR)&&!lio_value(s,LIO_WCHAR))))
+		return 1;
+	if (s->exited) // do not show exited processes in batch view
+		return 1;
+	return batch_nomatch(s);
+}
+
+static inline int batch_filter(struct xxxid_stats *s) {
+	uint64_t t=prof_start();
+	int r=batch_skip(s);
+
+	prof_end(PROF_FILTER,t);
+	return r;
+}
+
+// NDJSON or CSV; one record per task, JSON gets a separate interval record
+static inline void view_batch_fmt(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,int diff_len,double time_s,double *totals) {
+	static int firsthdr=1;
+	static const char *tn[4]={"total_read","total_write","current_read","current_write"};
+	static const char *pn[PSI_MAX]={"io","mem"};
+	struct timespec ts;
+	char prefix[256];
+	char tsb[32];
+	int i,l;
+
+	if (firsthdr&&config.f.quiet<2)
+		fmt_header();
+	firsthdr=0;
+
+	// the part shared by all records of the iteration is formatted once
+	wall_time(&ts);
+	snprintf(tsb,sizeof tsb,"%lu.%03lu",(unsigned long)ts.tv_sec,(unsigned long)ts.tv_nsec/1000000);
+	if (params.format==E_FMT_JSON) {
+		if (config.f.quiet<3) {
+			obuf_str("{\"type\":\"interval\",\"ts\":");
+			obuf_str(tsb);
+			FMT_KEY("interval");
+			obuf_fix(time_s,3);
+			for (i=0;i<4;i++) {
+				FMT_KEY(tn[i]);
+				obuf_fix(totals[i],1);
+			}
+			for (i=0;config.f.psi&&i<PSI_MAX;i++) {
+				const struct psi_stats *p=psi_get(i);
+				char k[32];
+
+				if (!p)
+					continue;
+				snprintf(k,sizeof k,"%s_some",pn[i]);
+				FMT_KEY(k);
+				obuf_fix(p->some,2);
+				snprintf(k,sizeof k,"%s_full",pn[i]);
+				FMT_KEY(k);
+				obuf_fix(p->full,2);
+				snprintf(k,sizeof k,"%s_some_avg10",pn[i]);
+				FMT_KEY(k);
+				obuf_fix(p->some10,2);
+				snprintf(k,sizeof k,"%s_full_avg10",pn[i]);
+				FMT_KEY(k);
+				obuf_fix(p->full10,2);
+			}
+			obuf_str("}\n");
+		}
+		l=snprintf(prefix,sizeof prefix,"{\"type\":\"%s\",\"ts\":%s",group_name(),tsb);
+	} else
+		l=snprintf(prefix,sizeof prefix,"%s,%.3f,%.1f,%.1f,%.1f,%.1f",tsb,time_s,totals[0],totals[1],totals[2],totals[3]);
+	if (l<0||(size_t)l>=sizeof prefix)
+		return;
+
+	arr_sort(cs,iotop_sort_cb);
+
+	for (i=0;cs->sor&&i<diff_len;i++) {
+		struct xxxid_stats *s=cs->sor[i];
+
+		if (batch_filter(s))
+			continue;
+		fmt_task(s,arr_find(ps,s->tid),prefix);
+	}
+}
+
+// "%7.2f %-3.3s " of the text view, the units are never longer than 3
+static inline void batch_val(double v,const char *u) {
+	obuf_fixw(v,2,7);
+	obuf_chr(' ');
+	obuf_strw(u,-3);
+	obuf_chr(' ');
+}
+
+// "%2.2f %% "
+static inline void batch_pc(double v) {
+	obuf_fixw(v,2,2);
+	obuf_put(" % ",3);
+}
+
 static inline void view_batch(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,struct act_stats *act) {
 	double time_s=timediff_in_s(act->ts_o,act->ts_c);
-	int diff_len=create_diff(cs,ps,time_s,act->ts_c,NULL,0,NULL);
+	int diff_len=create_diff(fetch_params(),cs,ps,time_s,act->ts_c,NULL,0,NULL);
 	double total_a_read,total_a_write;
 	char str_a_read[4],str_a_write[4];
 	double total_read,total_write;
 	char str_read[4],str_write[4];
 	static int firsthdr=1;
-	int i;
+	int i,j;
 
+	trigger_check(cs,ps,act->ts_c);
 	calc_total(cs,&total_read,&total_write);
 	calc_a_total(act,&total_a_read,&total_a_write,time_s);
 
+	if (params.format!=E_FMT_TEXT) {
+		double totals[4]={total_read,total_write,total_a_read,total_a_write};
+
+		view_batch_fmt(cs,ps,diff_len,time_s,totals);
+		return;
+	}
+
 	humanize_val(&total_read,str_read,1);
 	humanize_val(&total_write,str_write,1);
 	humanize_val(&total_a_read,str_a_read,0);
 	humanize_val(&total_a_write,str_a_write,0);
 
 	if (config.f.quiet<3) {
-		printf(HEADER1_FORMAT,total_read,str_read,"",total_write,str_write,"");
+		obuf_printf(HEADER1_FORMAT,total_read,str_read,"",total_write,str_write,"");
 
 		if (config.f.timestamp) {
-			time_t t=time(NULL);
-
-			printf(" | %s",ctime(&t));
+			struct timespec ts;
+			char tb[32];
+			struct tm tm;
+			time_t t;
+
+			wall_time(&ts);
+			t=ts.tv_sec;
+			// the same text as ctime, without its check of the time zone each time
+			if (localtime_r(&t,&tm)&&asctime_r(&tm,tb))
+				obuf_printf(" | %s",tb);
+			else
+				obuf_chr('\n');
 		} else
-			printf("\n");
+			obuf_chr('\n');
+
+		obuf_printf(HEADER2_FORMAT,total_a_read,str_a_read,"",total_a_write,str_a_write,"");
+		obuf_chr('\n');
+		if (config.f.psi&&psi_get(PSI_IO)&&psi_get(PSI_MEM)) {
+			obuf_printf(PSI_FORMAT,psi_get(PSI_IO)->some,psi_get(PSI_IO)->full,"",psi_get(PSI_MEM)->some,psi_get(PSI_MEM)->full,"");
+			obuf_chr('\n');
+		}
+	}
+
+	if (config.f.devices&&config.f.quiet<3&&diskstats_count()) {
+		obuf_printf("%-10s %11s %11s %9s %9s %7s %8s %9s\n","DEVICE","READ","WRITE","R/s","W/s","AQU","UTIL","AWAIT");
+		for (j=0;j<diskstats_count();j++) {
+			struct dev_stats *d=diskstats_get(j);
+			char str_r[4],str_w[4];
+			double r=d->read;
+			double w=d->write;
+
+			humanize_val(&r,str_r,0);
+			humanize_val(&w,str_w,0);
+			obuf_printf("%-10.10s %7.2f %-3.3s %7.2f %-3.3s %9.1f %9.1f %7.2f %6.2f %% %6.2f ms\n",d->name,r,str_r,w,str_w,d->rio,d->wio,d->aqu,d->util,d->await);
+		}
+	}
+	if (config.f.devices&&config.f.quiet<3&&vm_pressure_get()) {
+		char vl[200];
 
-		printf(HEADER2_FORMAT,total_a_read,str_a_read,"",total_a_write,str_a_write,"");
-		printf("\n");
+		vm_pressure_line(vl,sizeof vl,vm_pressure_get());
+		obuf_str(vl);
+		obuf_chr('\n');
 	}
 
 	if (config.f.quiet==0||(config.f.quiet==1&&firsthdr)) {
 		firsthdr=0;
-		printf("%6s %4s %8s %11s %11s %6s %6s %s\n",config.f.processes?"PID":"TID","PRIO","USER","DISK READ","DISK WRITE","SWAPIN","IO","COMMAND");
+		obuf_printf("%6s %4s %8s %11s %11s ",params.group?config.f.processes?"PROCS":"TASKS":config.f.processes?"PID":"TID","PRIO","USER","DISK READ","DISK WRITE");
+		if (config.f.netwrite)
+			obuf_printf("%11s ","NET WRITE");
+		obuf_printf("%6s %6s ","SWAPIN","IO");
+		if (config.f.delays)
+			for (j=0;j<DLY_MAX;j++)
+				if (delay_available(j))
+					obuf_printf("%6s ",delay_name[j]);
+		if (config.f.logical)
+			obuf_printf("%11s %11s %11s %11s ","VFS READ","VFS WRITE","SYSCR","SYSCW");
+		if (!column_hidden(SORT_BY_PSI))
+			obuf_printf("%6s ","IO PSI");
+		if (config.f.pctl) {
+			char pn[HG_MAX][16];
+
+			for (j=0;j<HG_MAX;j++)
+				snprintf(pn[j],sizeof *pn,"%s P%d",j==HG_READ?"READ":j==HG_WRITE?"WRITE":"IO",config.f.pctl);
+			obuf_printf("%11s %11s %6s ",pn[HG_READ],pn[HG_WRITE],pn[HG_BLKIO]);
+		}
+		obuf_str("COMMAND\n");
 	}
 
 	arr_sort(cs,iotop_sort_cb);
 
 	for (i=0;cs->sor&&i<diff_len;i++) {
 		struct xxxid_stats *s=cs->sor[i];
-		char read_str[4],write_str[4];
+		char read_str[4],write_str[4],nwrite_str[4];
+		double nwrite_val;
 		double swapin_val;
 		double blkio_val;
 		double write_val;
 		double read_val;
-		char *pw_name;
-		char *cmdt;
+		const char *pw_name;
+		const char *cmdt;
 
 		if (config.f.accumbw) {
 			read_val=config.f.processes?s->read_val_abw_p:s->read_val_abw;
 			write_val=config.f.processes?s->write_val_abw_p:s->write_val_abw;
+			nwrite_val=config.f.processes?s->nwrite_val_abw_p:s->nwrite_val_abw;
 		} else if (config.f.accumulated) {
 			read_val=config.f.processes?s->read_val_acc_p:s->read_val_acc;
 			write_val=config.f.processes?s->write_val_acc_p:s->write_val_acc;
+			nwrite_val=config.f.processes?s->nwrite_val_acc_p:s->nwrite_val_acc;
 		} else {
 			read_val=config.f.processes?s->read_val_p:s->read_val;
 			write_val=config.f.processes?s->write_val_p:s->write_val;
+			nwrite_val=config.f.processes?s->nwrite_val_p:s->nwrite_val;
 		}
 		swapin_val=config.f.processes?s->swapin_val_p:s->swapin_val;
 		blkio_val=config.f.processes?s->blkio_val_p:s->blkio_val;
 
-		// show only processes, if configured
-		if (config.f.processes&&s->pid!=s->tid)
+		if (batch_filter(s))
 			continue;
-		if (config.f.only&&!read_val&&!write_val&&!swapin_val&&!blkio_val)
-			continue;
-		if (s->exited) // do not show exited processes in batch view
-			continue;
-		if (params.search_regx_ok) {
-			int ma_long,ma_short,ma_comm,ma_tid;
-			char tid[22];
-
-			sprintf(tid,"%lu",(unsigned long)s->tid);
-			ma_long=regexec(&params.search_regx,s->cmdline_long,0,NULL,0);
-			ma_short=regexec(&params.search_regx,s->cmdline_short,0,NULL,0);
-			if (s->cmdline_comm)
-				ma_comm=regexec(&params.search_regx,s->cmdline_comm,0,NULL,0);
-			else
-				ma_comm=REG_NOMATCH;
-			ma_tid=regexec(&params.search_regx,tid,0,NULL,0);
-			if (ma_long&&ma_short&&ma_comm&&ma_tid) // nothing matches
-				continue;
-		}
 
 		humanize_val(&read_val,read_str,1);
 		humanize_val(&write_val,write_str,1);
+		humanize_val(&nwrite_val,nwrite_str,1);
 
-		pw_name=u8strpadt(s->pw_name,10);
+		pw_name=u8fmt(&fb_pw,s->pw_name,10,0);
 
 		if (config.f.fullcmdline&&s->cmdline_comm) { // append custom thread name before full cmdline
 			char tb[1+strlen(s->cmdline_comm)+1+strlen(s->cmdline_long)+1];
 
 			sprintf(tb,"[%s]%s",s->cmdline_comm,s->cmdline_long);
-			cmdt=esc_low_ascii(tb);
+			cmdt=u8fmt(&fb_cmd,tb,-1,1);
 		} else
-			cmdt=esc_low_ascii(config.f.fullcmdline?s->cmdline_long:s->cmdline_short);
+			cmdt=u8fmt(&fb_cmd,config.f.fullcmdline?s->cmdline_long:s->cmdline_short,-1,1);
+
+		// the per task line is written by hand, see obuf_fixw
+		obuf_i64w(s->group?config.f.processes?s->procs:s->tasks:s->tid,6);
+		obuf_chr(' ');
+		obuf_strw(str_ioprio(s->io_prio),4);
+		obuf_chr(' ');
+		obuf_str(pw_name?pw_name:"(null)");
+		obuf_chr(' ');
+		batch_val(read_val,read_str);
+		batch_val(write_val,write_str);
+		if (config.f.netwrite)
+			batch_val(nwrite_val,nwrite_str);
+		batch_pc(swapin_val);
+		batch_pc(blkio_val);
+		if (config.f.delays)
+			for (j=0;j<DLY_MAX;j++)
+				if (delay_available(j))
+					batch_pc(config.f.processes?s->delay_val_p[j]:s->delay_val[j]);
+		if (config.f.logical)
+			for (j=0;j<LIO_MAX;j++) {
+				double lv=lio_value(s,j);
+				char lstr[4];
+
+				if (j==LIO_RCHAR||j==LIO_WCHAR)
+					humanize_val(&lv,lstr,1);
+				else
+					humanize_cnt(&lv,lstr,1);
+				batch_val(lv,lstr);
+			}
+		if (!column_hidden(SORT_BY_PSI))
+			batch_pc(s->psi_val);
+		if (config.f.pctl)
+			for (j=0;j<HG_MAX;j++) {
+				double pv=pctl_value(s,j);
+				char pstr[4];
+
+				if (j==HG_BLKIO)
+					batch_pc(pv);
+				else {
+					humanize_val(&pv,pstr,0);
+					batch_val(pv,pstr);
+				}
+			}
+		obuf_str(cmdt?cmdt:"(null)");
+		obuf_chr('\n');
+	}
+}
+
+inline void view_batch_init(void) {
+	if (!collector->has_delays)
+		fprintf(stderr,"Warning: %s collector does not provide SWAPIN and IO\n",collector->name);
+	else if (!replaying()&&!params.bench&&!read_task_delayacct())
+		fprintf(stderr,"Warning: task_delayacct is 0, enable by: echo 1 > /proc/sys/kernel/task_delayacct\n");
+}
 
-		printf("%6i %4s %s %7.2f %-3.3s %7.2f %-3.3s %2.2f %% %2.2f %% %s\n",s->tid,str_ioprio(s->io_prio),pw_name?pw_name:"(null)",read_val,read_str,write_val,write_str,swapin_val,blkio_val,cmdt?cmdt:"(null)");
+// a size without the /s of humanize_val
+static inline const char *batch_size(double *v) {
+	static char u[4];
 
-		if (cmdt)
-			free(cmdt);
+	humanize_val(v,u,0);
+	u[1]=0;
+	return u;
+}
 
-		if (pw_name)
-			free(pw_name);
+// --offenders at exit: the exited tasks by key, biggest first
+static inline void batch_offenders(void) {
+	const struct hh_stats *a=hitters_total();
+	const struct hh_stats *h;
+	double r=a->read;
+	double w=a->write;
+	const char *u;
+	char ku[8];
+	int i,j;
+
+	if (params.format==E_FMT_JSON) {
+		for (i=0;(h=hitters_get(i));i++) {
+			obuf_str("{\"type\":\"offender\",\"key\":");
+			obuf_json(hitters_key_name());
+			obuf_str(",\"name\":");
+			obuf_json(h->key);
+			obuf_str(",\"tasks\":");
+			obuf_u64(h->tasks);
+			obuf_str(",\"read_bytes\":");
+			obuf_u64(h->read);
+			obuf_str(",\"write_bytes\":");
+			obuf_u64(h->write);
+			obuf_str(",\"bytes\":");
+			obuf_u64(h->bytes);
+			obuf_str(",\"error\":");
+			obuf_u64(h->err);
+			obuf_str("}\n");
+		}
+		return;
+	}
+	if (params.format!=E_FMT_TEXT) // the CSV columns are per task
+		return;
+	for (j=0;hitters_key_name()[j]&&j<(int)sizeof ku-1;j++)
+		ku[j]=toupper((unsigned char)hitters_key_name()[j]);
+	ku[j]=0;
+	u=batch_size(&r);
+	obuf_printf("\nEXITED TASKS: %llu, READ %.2f %s, ",(unsigned long long)a->tasks,r,u);
+	u=batch_size(&w);
+	obuf_printf("WRITE %.2f %s\n",w,u);
+	obuf_printf("%-24s %8s %11s %11s %11s %11s\n",ku,"TASKS","READ","WRITE","TOTAL","ERROR");
+	for (i=0;(h=hitters_get(i));i++) {
+		double v[4]={h->read,h->write,h->bytes,h->err};
+
+		obuf_printf("%-24.24s %8llu",h->key,(unsigned long long)h->tasks);
+		for (j=0;j<4;j++) {
+			u=batch_size(v+j);
+			obuf_printf(" %9.2f %s",v[j],u);
+		}
+		obuf_chr('\n');
 	}
 }
 
-inline void view_batch_init(void) {
-	if (!read_task_delayacct())
-		fprintf(stderr,"Warning: task_delayacct is 0, enable by: echo 1 > /proc/sys/kernel/task_delayacct\n");
+// --percentiles at exit: all three percentiles of the tasks of the last
+// iteration, exited ones included, in the order of the last iteration
+static inline void batch_percentiles(struct xxxid_stats_arr *cs) {
+	const char *cmdt;
+	int i,j,k;
+
+	if (!cs||params.format==E_FMT_CSV) // the CSV columns are per interval
+		return;
+	if (params.format==E_FMT_TEXT) {
+		obuf_printf("\n%6s %9s",params.group?"GROUP":config.f.processes?"PID":"TID","INTERVALS");
+		for (j=0;j<HG_MAX;j++)
+			for (k=0;k<3;k++) {
+				char pn[16];
+
+				snprintf(pn,sizeof pn,"%s P%d",j==HG_READ?"READ":j==HG_WRITE?"WRITE":"IO",hg_pct[k]);
+				obuf_printf(j==HG_BLKIO?" %8s":" %11s",pn);
+			}
+		obuf_str(" COMMAND\n");
+	}
+	for (i=0;i<cs->length;i++) {
+		struct xxxid_stats *s=cs->sor?cs->sor[i]:cs->arr[i];
+		struct histo *h=config.f.processes?s->hist_p:s->hist;
+
+		if (!h||(config.f.processes&&s->pid!=s->tid)||batch_nomatch(s))
+			continue;
+		if (params.format==E_FMT_JSON) {
+			obuf_str("{\"type\":\"percentiles\",\"pid\":");
+			obuf_i64(s->pid);
+			obuf_str(",\"tid\":");
+			obuf_i64(s->tid);
+			obuf_str(",\"intervals\":");
+			obuf_u64(histo_count(h));
+			for (j=0;j<HG_MAX;j++)
+				for (k=0;k<3;k++) {
+					obuf_str(",\"");
+					obuf_str(hg_name[j]);
+					obuf_printf("_p%d\":",hg_pct[k]);
+					obuf_fix(histo_pct(h,j,hg_pct[k]),2);
+				}
+			obuf_str(",\"command\":");
+			obuf_json(config.f.fullcmdline?s->cmdline_long:s->cmdline_short);
+			obuf_str("}\n");
+			continue;
+		}
+		obuf_i64w(s->tid,6);
+		obuf_chr(' ');
+		obuf_i64w(histo_count(h),9);
+		for (j=0;j<HG_MAX;j++)
+			for (k=0;k<3;k++) {
+				double v=histo_pct(h,j,hg_pct[k]);
+				char u[4];
+
+				obuf_chr(' ');
+				if (j==HG_BLKIO) {
+					obuf_fixw(v,2,6);
+					obuf_str(" %");
+				} else {
+					humanize_val(&v,u,0);
+					obuf_fixw(v,2,7);
+					obuf_chr(' ');
+					obuf_strw(u,-3);
+				}
+			}
+		cmdt=u8fmt(&fb_cmd,config.f.fullcmdline?s->cmdline_long:s->cmdline_short,-1,1);
+		obuf_chr(' ');
+		obuf_str(cmdt?cmdt:"(null)");
+		obuf_chr('\n');
+	}
 }
 
 inline void view_batch_fini(void) {
+	if (config.f.offenders) {
+		batch_offenders();
+		obuf_flush();
+	}
+	if (config.f.pctl) {
+		batch_percentiles(bt_shown);
+		obuf_flush();
+	}
+	arr_free(bt_shown);
+	bt_shown=NULL;
+	free(fb_pw.p);
+	free(fb_cmd.p);
+	memset(&fb_pw,0,sizeof fb_pw);
+	memset(&fb_cmd,0,sizeof fb_cmd);
+	if (params.bench)
+		synth_report();
+	else if (params.profile)
+		prof_summary();
 }
 
 inline void view_batch_loop(void) {
 	struct xxxid_stats_arr *ps=NULL;
 	struct xxxid_stats_arr *cs=NULL;
 	struct act_stats act={0,0,0,0,0,0,0,};
+	uint64_t t;
 
 	for (;;) {
-		cs=fetch_data(filter1);
+		if (replaying()&&replay_eof())
+			break;
+		cs=fetch_data(fetch_params(),filter1,ps);
 		get_vm_counters(&act.read_bytes,&act.write_bytes);
-		act.ts_c=monotime();
+		if (config.f.devices) {
+			diskstats_update();
+			vm_pressure_update();
+		}
+		if (config.f.psi)
+			psi_update();
+		if (replaying())
+			act.ts_c=replay_time();
+		else
+			act.ts_c=params.bench?synth_time():(uint64_t)monotime();
+		if (params.record_file||params.ring_file)
+			record_frame(cs,act.read_bytes,act.write_bytes,act.ts_c);
+		t=prof_start();
 		view_batch(cs,ps,&act);
+		prof_end(PROF_RENDER,t);
+		bt_shown=cs;
 
 		if (ps)
 			arr_free(ps);
@@ -158,8 +780,19 @@ inline void view_batch_loop(void) {
 		if ((params.iter>-1)&&((--params.iter)==0))
 			break;
 		fflush(stdout);
-		sleep(params.delay);
+		obuf_flush();
+		if (!replaying()&&!params.bench) { // replay as fast as possible, an attached client waits in fetch_data
+			uint64_t ms=trigger_period();
+			struct timespec ts;
+
+			ts.tv_sec=ms/1000;
+			ts.tv_nsec=ms%1000*1000000;
+			while (nanosleep(&ts,&ts))
+				;
+		}
 	}
-	arr_free(cs);
+	if (cs!=bt_shown) // the last one shown is kept for view_batch_fini
+		arr_free(cs);
+	obuf_flush();
 }
 
@@ -17,6 +17,7 @@ You should have received a copy of the GNU General Public License along with thi
 #define GCC_PRINTF
 
 #include <pwd.h>
+#include <ctype.h>
 #include <time.h>
 #include <regex.h>
 #include <stdio.h>
@@ -98,6 +99,8 @@ You should have received a copy of the GNU General Public License along with thi
 #define GREEN_PAIR 3
 #define MAGENTA_PAIR 4
 
+#define REPLAY_SEEK 10 // samples to skip with [ and ]
+
 static int in_ionice=0; // ionice interface flag and state vars
 static char ionice_id[50];
 static int ionice_pos=-1;
@@ -107,6 +110,7 @@ static int ionice_class=IOPRIO_CLASS_RT;
 static int ionice_prio=0;
 static int ionice_id_changed=0;
 static int ionice_line=1;
+static int list_line=1; // the line above the column names
 static int in_filter=0; // filter by pid/uid interface flag and state vars
 static char filter_uid[50];
 static char filter_pid[50];
@@ -131,8 +135,14 @@ static size_t c1w=0,c2w=0,c3w=0,cdw=0; // help window column widths
 static int helppos=0; // help window scroll position
 static WINDOW *wtda; // pop-up warning window
 static int whx=1,why=1,whw=2+2+20,whh=6; // warning window size and position
+static WINDOW *wprof; // profile overlay window
+static int pfx=1,pfy=1,pfw=2+60,pfh=2+1+PROF_MAX; // profile window size and position
 static int dontrefresh=0; // flag to inhibit refresh of data
 static int initial_delayacct=0; // initial state of task_delayacct
+static uint64_t *row_cache=NULL; // content hash of each screen line with a task row, 0 for the other lines
+static int row_cache_sz=0;
+static struct u8buf fb_pw={NULL,0}; // formatted user and command of a task row
+static struct u8buf fb_cmd={NULL,0};
 
 typedef struct {
 	char *descr; // static description or dynamic buffer
@@ -157,7 +167,15 @@ static char tcol6[200]="Toggle showing SWAPIN [off]";
 static char tcol7[200]="Toggle showing IO [off]";
 static char tcol8[200]="Toggle showing GRAPH [off]";
 static char tcol9[200]="Toggle showing COMMAND [off]";
-static char cgrph[200]="Cycle GRAPH source (IO, R, W, R+W, SW) [R+W]";
+static char tcolw[200]="Toggle showing NET WRITE [off]";
+static char tcolv[200]="Toggle showing VFS READ/WRITE and SYSCR/W [off]";
+static char tcoly[200]="Toggle showing CPU, MEM and other delays [off]";
+static char tdevp[200]="Toggle showing block device panel [off]";
+static char tpsip[200]="Toggle showing pressure stall information [off]";
+static char toffp[200]="Toggle showing exited task panel [off]";
+static char cpctl[200]="Cycle percentile columns (off, P50, P95, P99) [off]";
+static char tprof[200]="Toggle showing profile overlay [off]";
+static char cgrph[200]="Cycle GRAPH source (IO, R, W, R+W, SW, NW, delays) [R+W]";
 static char tgrdi[200]="Toggle reverse GRAPH direction [right]";
 static char tasci[200]="Toggle using Unicode/ASCII characters [Unicode]";
 static char tcolr[200]="Toggle colorizing values [off]";
@@ -167,9 +185,11 @@ static char tnice[200]="IOnice a process/thread [DISABLED]";
 static char texit[200]="Toggle showing exited processes [off]";
 static char tcloc[200]="Toggle showing time clock [on]";
 static char tfrez[200]="Toggle data freeze [off]";
+static char rpspd[200]="Halve/double replay speed [x1]";
 static char units[200]="Toggle SI units [1024]";
 static char unitt[200]="Cycle unit threshold [10]";
 static char tdact[200]="Toggle task_delayacct [dynamic off]";
+static char tgrpc[200]="Cycle group view (task, cgroup, user) [task]";
 
 const s_helpitem thelp[]={
 	{.descr="Exit",.k2="q",.k3="Q"},
@@ -196,12 +216,22 @@ const s_helpitem thelp[]={
 	{.descr=tcol7,.t="Toggle showing IO [%s]",.k2="7"},
 	{.descr=tcol8,.t="Toggle showing GRAPH [%s]",.k2="8"},
 	{.descr=tcol9,.t="Toggle showing COMMAND [%s]",.k2="9"},
+	{.descr=tcolw,.t="Toggle showing NET WRITE [%s]",.k2="w"},
+	{.descr=tcolv,.t="Toggle showing VFS READ/WRITE and SYSCR/W [%s]",.k2="v",.k3="V"},
+	{.descr=tcoly,.t="Toggle showing CPU, MEM and other delays [%s]",.k2="y",.k3="Y"},
+	{.descr=tdevp,.t="Toggle showing block device panel [%s]",.k2="k",.k3="K"},
+	{.descr=tpsip,.t="Toggle showing pressure stall information [%s]",.k2="m",.k3="M"},
+	{.descr=toffp,.t="Toggle showing exited task panel [%s]",.k2="#"},
+	{.descr=cpctl,.t="Cycle percentile columns (off, P50, P95, P99) [%s]",.k2="%"},
+	{.descr=tprof,.t="Toggle showing profile overlay [%s]",.k2="j",.k3="J"},
 	{.descr="Show all columns",.k2="0"},
-	{.descr=cgrph,.t="Cycle GRAPH source (IO, R, W, R+W, SW) [%s]",.k2="g",.k3="G"},
+	{.descr=cgrph,.t="Cycle GRAPH source (IO, R, W, R+W, SW, NW, delays) [%s]",.k2="g",.k3="G"},
 	{.descr=tgrdi,.t="Toggle reverse GRAPH direction [%s]",.k2="R"},
 	{.descr="Toggle showing inline help",.k2="?"},
 	{.descr="Toggle showing this help [on]",.k2="h",.k3="H"},
 	{.descr=tnice,.t="IOnice a process/thread%s",.k2="i",.k3="I"},
+	{.descr=tgrpc,.t="Cycle group view (task, cgroup, user) [%s]",.k2="z",.k3="Z"},
+	{.descr="Show the tasks of a group selected by i in a group view",.k1="<enter>"},
 	{.descr="Change UID and PID filters",.k2="f",.k3="F"},
 	{.descr="Search cmdline by regex",.k2="/"},
 	{.descr=tasci,.t="Toggle using Unicode/ASCII characters [%s]",.k2="u",.k3="U"},
@@ -211,6 +241,9 @@ const s_helpitem thelp[]={
 	{.descr=texit,.t="Toggle showing exited processes [%s]",.k2="e",.k3="E"},
 	{.descr=tcloc,.t="Toggle showing time clock [%s]",.k2="T"},
 	{.descr=tfrez,.t="Toggle data freeze [%s]",.k2="s",.k3="S"},
+	{.descr="Seek replay 10 samples backward/forward",.k2="[",.k3="]"},
+	{.descr=rpspd,.t="Halve/double replay speed [x%d]",.k2="{",.k3="}"},
+	{.descr="Write the --ring samples and sample faster for --burst",.k2="!"},
 	{.descr=units,.t="Toggle SI units [%d]",.k1="<Ctrl-B>",.k2="b",.k3=""},
 	{.descr=unitt,.t="Cycle unit threshold [%d]",.k1="<Ctrl-R>",.k2="t",.k3=""},
 	{.descr=tdact,.t="Toggle task_delayacct [%s]",.k1="<Ctrl-T>",.k2="",.k3=""},
@@ -226,6 +259,13 @@ static const char *grtype_text[]={
 	"GRAPH[W]",
 	"GRAPH[R+W]",
 	"GRAPH[SW]",
+	"GRAPH[NW]",
+	"GRAPH[CPU]",
+	"GRAPH[MEM]",
+	"GRAPH[THR]",
+	"GRAPH[CMP]",
+	"GRAPH[WPC]",
+	"GRAPH[IRQ]",
 };
 
 static const char *column_name[]={
@@ -234,8 +274,23 @@ static const char *column_name[]={
 	"USER",
 	"DISK READ",
 	"DISK WRITE",
+	"NET WRITE",
 	"SWAPIN",
 	"IO",
+	"CPU",
+	"MEM",
+	"THRASH",
+	"COMPACT",
+	"WPCOPY",
+	"IRQ",
+	"VFS READ",
+	"VFS WRITE",
+	"SYSCR",
+	"SYSCW",
+	"IO PSI",
+	"READ P",
+	"WRITE P",
+	"IO P",
 	"xxxxx[xxx]",
 	"COMMAND",
 };
@@ -270,13 +325,36 @@ static const int column_width[]={
 	10, // USER
 	12, // READ
 	12, // WRITE
+	12, // NWRITE
 	9,  // SWAPIN
 	9,  // IO
+	9,  // DCPU
+	9,  // DMEM
+	9,  // DTHRASH
+	9,  // DCOMPACT
+	9,  // DWPCOPY
+	9,  // DIRQ
+	12, // LREAD
+	12, // LWRITE
+	12, // SYSCR
+	12, // SYSCW
+	9,  // PSI
+	12, // PREAD
+	12, // PWRITE
+	9,  // PIO
 	0,  // GRAPH
 	0,  // COMMAND
 };
 
-#define __COLUMN_NAME(i) (((i)==SORT_BY_GRAPH)?grtype_text[masked_grtype(0)]:column_name[(i)])
+// the percentile columns carry the percentile in their name
+static inline const char *pctl_name(int i) {
+	static char pn[HG_MAX][16];
+
+	snprintf(pn[i-SORT_BY_PREAD],sizeof *pn,"%s%d",column_name[i],config.f.pctl);
+	return pn[i-SORT_BY_PREAD];
+}
+
+#define __COLUMN_NAME(i) (((i)==SORT_BY_GRAPH)?grtype_text[masked_grtype(0)]:((i)==SORT_BY_TID&&params.group)?(config.f.processes?"PROCS":"TASKS"):((i)>=SORT_BY_PREAD&&(i)<=SORT_BY_PIO)?pctl_name(i):column_name[(i)])
 #define __SAFE_INDEX(i) ((((i)%SORT_BY_MAX)+SORT_BY_MAX)%SORT_BY_MAX)
 #define COLUMN_NAME(i) __COLUMN_NAME(__SAFE_INDEX(i))
 #define COLUMN_L(i) COLUMN_NAME((i)-1)
@@ -284,18 +362,52 @@ static const int column_width[]={
 #define SORT_CHAR_IND(x) ((masked_sort_by(0)==x)?(config.f.sort_order==SORT_ASC?1:2):0)
 #define SORT_CHAR(x) (((has_unicode&&config.f.unicode)?sort_dir_u:sort_dir_a)[SORT_CHAR_IND(x)])
 
+// CPU delay comes from the scheduler statistics and is reported even
+// without task_delayacct, the rest need it
+static inline int delay_shown(int i) {
+	return delay_available(i)&&(i==DLY_CPU||has_tda);
+}
+
+static inline int grtype_masked(int grtype) {
+	if (!has_tda&&(grtype==E_GR_IO||grtype==E_GR_SW))
+		return 1;
+	if (grtype>=E_GR_CPU&&grtype<=E_GR_IRQ)
+		return !delay_shown(grtype-E_GR_CPU);
+	return 0;
+}
+
 inline e_grtype masked_grtype(int isforward) {
-	if (!has_tda)
-		if (config.f.grtype==E_GR_IO||config.f.grtype==E_GR_SW)
-			return isforward?E_GR_R:E_GR_RW;
-	return config.f.grtype;
+	int grtype=config.f.grtype;
+
+	if (!isforward&&!has_tda&&grtype==E_GR_IO)
+		return E_GR_RW;
+	while (grtype_masked(grtype)) // R is never masked
+		grtype=grtype==(isforward?E_GR_MAX:E_GR_MIN)?(isforward?E_GR_MIN:E_GR_MAX):grtype+(isforward?1:-1);
+	return grtype;
+}
+
+// graphs of rates are scaled to the maximum visible value, delays are in percent
+static inline int grtype_is_bw(int grtype) {
+	return grtype==E_GR_R||grtype==E_GR_W||grtype==E_GR_RW||grtype==E_GR_NW;
+}
+
+// columns that are not shown can not be used for sorting
+static inline int sort_masked(int sort_by) {
+	if (!has_tda&&(sort_by==SORT_BY_IO||sort_by==SORT_BY_SWAPIN||sort_by==SORT_BY_PIO))
+		return 1;
+	if (sort_by>=SORT_BY_DCPU&&sort_by<=SORT_BY_DIRQ)
+		return column_hidden(sort_by)||!delay_shown(sort_by-SORT_BY_DCPU);
+	if (sort_by==SORT_BY_NWRITE||(sort_by>=SORT_BY_LREAD&&sort_by<=SORT_BY_SYSCW)||(sort_by>=SORT_BY_PSI&&sort_by<=SORT_BY_PIO))
+		return column_hidden(sort_by);
+	return 0;
 }
 
 inline int masked_sort_by(int isforward) {
-	if (!has_tda)
-		if (config.f.sort_by==SORT_BY_IO||config.f.sort_by==SORT_BY_SWAPIN)
-			return isforward?SORT_BY_GRAPH:SORT_BY_WRITE;
-	return config.f.sort_by;
+	int sort_by=config.f.sort_by;
+
+	while (sort_masked(sort_by)) // TID is never masked
+		sort_by=(sort_by+(isforward?1:SORT_BY_MAX-1))%SORT_BY_MAX;
+	return sort_by;
 }
 
 static inline int filter_view(struct xxxid_stats *s,int gr_width) {
@@ -329,7 +441,9 @@ static inline int filter_view(struct xxxid_stats *s,int gr_width) {
 			if ((config.f.processes?s->blkio_val_p:s->blkio_val)<=0&&
 				(config.f.processes?s->swapin_val_p:s->swapin_val)<=0&&
 				(config.f.processes?s->read_val_p:s->read_val)<=0&&
-				(config.f.processes?s->write_val_p:s->write_val)<=0)
+				(config.f.processes?s->write_val_p:s->write_val)<=0&&
+				(!config.f.logical||((config.f.processes?s->lio_val_p[LIO_RCHAR]:s->lio_val[LIO_RCHAR])<=0&&
+				(config.f.processes?s->lio_val_p[LIO_WCHAR]:s->lio_val[LIO_WCHAR])<=0)))
 				goto dohide;
 		} else {
 			double su=0;
@@ -364,6 +478,24 @@ static inline int filter_view(struct xxxid_stats *s,int gr_width) {
 					if (!memcmp(config.f.processes?s->sihist_p:s->sihist,iohist_z,gr_width))
 						goto dohide;
 					break;
+				case E_GR_NW:
+					for (i=0;i<gr_width;i++)
+						su+=config.f.processes?s->netwhist_p[i]:s->netwhist[i];
+					if (su<=0)
+						goto dohide;
+					break;
+				case E_GR_CPU:
+				case E_GR_MEM:
+				case E_GR_THRASH:
+				case E_GR_COMPACT:
+				case E_GR_WPCOPY:
+				case E_GR_IRQ: {
+					int d=masked_grtype(0)-E_GR_CPU;
+
+					if (!memcmp(config.f.processes?s->dlyhist_p[d]:s->dlyhist[d],iohist_z,gr_width))
+						goto dohide;
+					break;
+				}
 			}
 		}
 		if (0) {
@@ -371,7 +503,9 @@ static inline int filter_view(struct xxxid_stats *s,int gr_width) {
 			if ((config.f.processes?s->blkio_val_p:s->blkio_val)<=0&&
 				(config.f.processes?s->swapin_val_p:s->swapin_val)<=0&&
 				(config.f.processes?s->read_val_p:s->read_val)<=0&&
-				(config.f.processes?s->write_val_p:s->write_val)<=0)
+				(config.f.processes?s->write_val_p:s->write_val)<=0&&
+				(!config.f.logical||((config.f.processes?s->lio_val_p[LIO_RCHAR]:s->lio_val[LIO_RCHAR])<=0&&
+				(config.f.processes?s->lio_val_p[LIO_WCHAR]:s->lio_val[LIO_WCHAR])<=0)))
 				return 1;
 		}
 	}
@@ -559,6 +693,37 @@ static inline void view_help(void) {
 				case '9':
 					sprintf(p->descr,p->t,!config.f.hidecmd?"on":"off");
 					break;
+				case 'w':
+					sprintf(p->descr,p->t,config.f.netwrite?"on":"off");
+					break;
+				case 'v':
+					sprintf(p->descr,p->t,config.f.logical?"on":"off");
+					break;
+				case 'y':
+					sprintf(p->descr,p->t,config.f.delays?"on":"off");
+					break;
+				case 'k':
+					sprintf(p->descr,p->t,config.f.devices?"on":"off");
+					break;
+				case 'm':
+					sprintf(p->descr,p->t,config.f.psi?"on":"off");
+					break;
+				case '#':
+					sprintf(p->descr,p->t,config.f.offenders?"on":"off");
+					break;
+				case '%': {
+					char pct[8];
+
+					snprintf(pct,sizeof pct,"P%d",config.f.pctl);
+					sprintf(p->descr,p->t,config.f.pctl?pct:"off");
+					break;
+				}
+				case 'j':
+					sprintf(p->descr,p->t,params.profile?"on":"off");
+					break;
+				case '{':
+					sprintf(p->descr,p->t,replay_speed(0));
+					break;
 				case 'g': {
 					char *grt;
 
@@ -579,6 +744,27 @@ static inline void view_help(void) {
 						case E_GR_SW:
 							grt="SW";
 							break;
+						case E_GR_NW:
+							grt="NW";
+							break;
+						case E_GR_CPU:
+							grt="CPU";
+							break;
+						case E_GR_MEM:
+							grt="MEM";
+							break;
+						case E_GR_THRASH:
+							grt="THRASH";
+							break;
+						case E_GR_COMPACT:
+							grt="COMPACT";
+							break;
+						case E_GR_WPCOPY:
+							grt="WPCOPY";
+							break;
+						case E_GR_IRQ:
+							grt="IRQ";
+							break;
 					}
 
 					sprintf(p->descr,p->t,grt);
@@ -627,6 +813,9 @@ static inline void view_help(void) {
 				case 'i':
 					sprintf(p->descr,p->t,config.f.norenice?" [DISABLED]":"");
 					break;
+				case 'z':
+					sprintf(p->descr,p->t,group_name());
+					break;
 			}
 	}
 
@@ -736,6 +925,130 @@ static inline void view_warning(void) {
 		wattroff(wtda,A_REVERSE|A_DIM);
 }
 
+static inline void view_profile(void) {
+	char buf[128];
+	int i;
+
+	if (config.f.inverse)
+		wattron(wprof,A_REVERSE);
+	else
+		wattroff(wprof,A_REVERSE);
+	mvwprintw(wprof,0,0,"%s",(has_unicode&&config.f.unicode)?"─":"_");
+	if (config.f.inverse)
+		wattroff(wprof,A_REVERSE);
+	else
+		wattron(wprof,A_REVERSE);
+	wprintw(wprof," profile ");
+	if (config.f.inverse)
+		wattron(wprof,A_REVERSE);
+	else
+		wattroff(wprof,A_REVERSE);
+	for (i=1+strlen(" profile ");i<pfw;i++)
+		wprintw(wprof,"%s",(has_unicode&&config.f.unicode)?"─":"_");
+	prof_line(buf,sizeof buf,PROF_MAX);
+	wattron(wprof,A_BOLD);
+	mvwprintw(wprof,1,0," %-*.*s ",pfw-2,pfw-2,buf);
+	wattroff(wprof,A_BOLD);
+	for (i=0;i<PROF_MAX;i++) {
+		prof_line(buf,sizeof buf,i);
+		mvwprintw(wprof,2+i,0," %-*.*s ",pfw-2,pfw-2,buf);
+	}
+	mvwprintw(wprof,pfh-1,0,"%s",(has_unicode&&config.f.unicode)?"─":"_");
+	for (i=1;i<pfw;i++)
+		wprintw(wprof,"%s",(has_unicode&&config.f.unicode)?"─":"_");
+	if (config.f.inverse) {
+		wattron(wprof,A_DIM);
+		wattroff(wprof,A_REVERSE);
+	} else
+		wattron(wprof,A_REVERSE|A_DIM);
+	mvwprintw(wprof,pfh-1,1," press j to hide ");
+	if (config.f.inverse) {
+		wattroff(wprof,A_DIM);
+		wattron(wprof,A_REVERSE);
+	} else
+		wattroff(wprof,A_REVERSE|A_DIM);
+}
+
+static inline uint64_t rc_mix(uint64_t h,uint64_t v) {
+	h=(h^v)*0x9e3779b97f4a7c15ULL;
+	return h^(h>>32);
+}
+
+static inline uint64_t rc_dbl(uint64_t h,double v) {
+	uint64_t u;
+
+	memcpy(&u,&v,sizeof u);
+	return rc_mix(h,u);
+}
+
+static inline uint64_t rc_mem(uint64_t h,const void *p,size_t len) {
+	const uint8_t *b=p;
+	uint64_t u;
+
+	for (;len>=sizeof u;b+=sizeof u,len-=sizeof u) {
+		memcpy(&u,b,sizeof u);
+		h=rc_mix(h,u);
+	}
+	u=0;
+	memcpy(&u,b,len);
+	return rc_mix(h,u^len);
+}
+
+static inline uint64_t rc_str(uint64_t h,const char *s) {
+	return s?rc_mem(h,s,strlen(s)):rc_mix(h,0);
+}
+
+// the n history values the GRAPH column of a row is drawn from
+static inline uint64_t rc_graph(uint64_t h,struct xxxid_stats *s,int n) {
+	int p=config.f.processes;
+
+	switch (masked_grtype(0)) {
+		case E_GR_IO:
+			return rc_mem(h,p?s->iohist_p:s->iohist,n);
+		case E_GR_R:
+			return rc_mem(h,p?s->readhist_p:s->readhist,n*sizeof *s->readhist);
+		case E_GR_W:
+			return rc_mem(h,p?s->writehist_p:s->writehist,n*sizeof *s->writehist);
+		case E_GR_RW:
+			h=rc_mem(h,p?s->readhist_p:s->readhist,n*sizeof *s->readhist);
+			return rc_mem(h,p?s->writehist_p:s->writehist,n*sizeof *s->writehist);
+		case E_GR_SW:
+			return rc_mem(h,p?s->sihist_p:s->sihist,n);
+		case E_GR_NW:
+			return rc_mem(h,p?s->netwhist_p:s->netwhist,n*sizeof *s->netwhist);
+		case E_GR_CPU:
+		case E_GR_MEM:
+		case E_GR_THRASH:
+		case E_GR_COMPACT:
+		case E_GR_WPCOPY:
+		case E_GR_IRQ:
+			return rc_mem(h,p?s->dlyhist_p[masked_grtype(0)-E_GR_CPU]:s->dlyhist[masked_grtype(0)-E_GR_CPU],n);
+	}
+	return h;
+}
+
+// make room for a hash per screen line, the new lines are not cached
+static inline void rc_size(int lines) {
+	uint64_t *t;
+
+	if (lines<=row_cache_sz)
+		return;
+	t=realloc(row_cache,lines*sizeof *t);
+	if (!t)
+		return;
+	memset(t+row_cache_sz,0,(lines-row_cache_sz)*sizeof *t);
+	row_cache=t;
+	row_cache_sz=lines;
+}
+
+// append a graph glyph without rescanning the string, returns the new end
+static inline char *gr_add(char *p,const char *g) {
+	while (*g)
+		*p++=*g++;
+	*p=0;
+	return p;
+}
+
 static inline void color_print_pc(double v) {
 	int cp=0;
 
@@ -755,6 +1068,107 @@ static inline void color_print_pc(double v) {
 	printw(" %% ");
 }
 
+#define DEVICE_WIDTH 82 // the columns before the graph
+
+// block device panel: a column header, a line per device and the memory
+// pressure from line on
+static inline void draw_devices(int line,int n,int maxx,int gr_width) {
+	int i,j;
+
+	if (config.f.inverse)
+		attroff(A_REVERSE);
+	else
+		attron(A_REVERSE);
+	mvhline(line,0,' ',maxx);
+	mvprintw(line,0,"%-10s %11s %11s %9s %9s %7s %8s %9s %s","DEVICE","READ","WRITE","R/s","W/s","AQU","UTIL","AWAIT",gr_width?"GRAPH[R+W]":"");
+	if (config.f.inverse)
+		attron(A_REVERSE);
+	else
+		attroff(A_REVERSE);
+
+	for (i=0;i<n-1;i++) {
+		struct dev_stats *d=diskstats_get(i);
+		char pg[HISTORY_POS*5]={0};
+		char *gp=pg;
+		double mx=1000.0;
+		char str_r[4],str_w[4];
+		double r,w;
+		int gs,ge,gi;
+
+		if (!d)
+			break;
+		r=d->read;
+		w=d->write;
+		humanize_val(&r,str_r,0);
+		humanize_val(&w,str_w,0);
+		for (j=0;j<((has_unicode&&config.f.unicode)?gr_width*2:gr_width);j++)
+			if (mx<d->hist[j])
+				mx=d->hist[j];
+		gs=config.f.reverse_graph?gr_width-1:0;
+		ge=config.f.reverse_graph?0:gr_width-1;
+		gi=config.f.reverse_graph?-1:1;
+		for (j=gs;gr_width&&(ge<gs?j>=ge:j<=ge);j+=gi)
+			if (has_unicode&&config.f.unicode)
+				gp=gr_add(gp,br_graph[value2scale(d->hist[j*2],mx)][value2scale(d->hist[j*2+gi],mx)]);
+			else
+				gp=gr_add(gp,as_graph[value2scale(d->hist[j],mx)]);
+
+		mvhline(line+1+i,0,' ',maxx);
+		mvprintw(line+1+i,0,"%-10.10s %7.2f %-3.3s %7.2f %-3.3s %9.1f %9.1f %7.2f ",d->name,r,str_r,w,str_w,d->rio,d->wio,d->aqu);
+		color_print_pc(d->util);
+		printw("%6.2f ms %s",d->await,pg);
+	}
+	if (i<n-1&&vm_pressure_get()) {
+		char vl[200];
+
+		vm_pressure_line(vl,sizeof vl,vm_pressure_get());
+		mvhline(line+1+i,0,' ',maxx);
+		mvprintw(line+1+i,0,"%.*s",maxx,vl);
+	}
+}
+
+#define OFFENDERS_WIDTH 81
+#define OFFENDERS_SHOWN 5 // keys shown below the total
+
+static inline void draw_offender(int line,int maxx,const char *key,const struct hh_stats *h) {
+	double v[4]={h->read,h->write,h->bytes,h->err};
+	int i;
+
+	mvhline(line,0,' ',maxx);
+	mvprintw(line,0,"%-24.24s %8llu",key,(unsigned long long)h->tasks);
+	for (i=0;i<4;i++) {
+		char u[4];
+
+		humanize_val(v+i,u,0);
+		printw(" %9.2f %c",v[i],u[0]);
+	}
+}
+
+// exited task panel: a column header, the total of all exited tasks and the
+// biggest keys from line on
+static inline void draw_offenders(int line,int n,int maxx) {
+	const struct hh_stats *h;
+	char title[32];
+	int i;
+
+	snprintf(title,sizeof title,"EXITED BY %s",hitters_key_name());
+	for (i=0;title[i];i++)
+		title[i]=toupper((unsigned char)title[i]);
+	if (config.f.inverse)
+		attroff(A_REVERSE);
+	else
+		attron(A_REVERSE);
+	mvhline(line,0,' ',maxx);
+	mvprintw(line,0,"%-24s %8s %11s %11s %11s %11s",title,"TASKS","READ","WRITE","TOTAL","ERROR");
+	if (config.f.inverse)
+		attron(A_REVERSE);
+	else
+		attroff(A_REVERSE);
+	draw_offender(line+1,maxx,"(all)",hitters_total());
+	for (i=0;i<n-2&&(h=hitters_get(i));i++)
+		draw_offender(line+2+i,maxx,h->key,h);
+}
+
 static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,struct act_stats *act,int roll) {
 	double time_s=timediff_in_s(act->ts_o,act->ts_c);
 	double total_read,total_write;
@@ -763,6 +1177,8 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 	char pg_t_w[HISTORY_POS*5]={0};
 	char pg_a_r[HISTORY_POS*5]={0};
 	char pg_a_w[HISTORY_POS*5]={0};
+	char *gp_t_r=pg_t_r+1,*gp_t_w=pg_t_w+1;
+	char *gp_a_r=pg_a_r+1,*gp_a_w=pg_a_w+1;
 	char str_read[4],str_write[4];
 	char str_a_read[4],str_a_write[4];
 	char *head1row_format="";
@@ -782,6 +1198,7 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 	int saveskip;
 	int gs,ge,gi;
 	int i,j,k;
+	uint64_t sig;
 	int maxy;
 	int maxx;
 	int skip;
@@ -807,10 +1224,25 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 		maxcmdline-=column_width[SORT_BY_READ];
 	if (!config.f.hidewrite)
 		maxcmdline-=column_width[SORT_BY_WRITE];
+	if (config.f.netwrite)
+		maxcmdline-=column_width[SORT_BY_NWRITE];
 	if (!config.f.hideswapin&&has_tda)
 		maxcmdline-=column_width[SORT_BY_SWAPIN];
 	if (!config.f.hideio&&has_tda)
 		maxcmdline-=column_width[SORT_BY_IO];
+	if (config.f.delays)
+		for (i=SORT_BY_DCPU;i<=SORT_BY_DIRQ;i++)
+			if (delay_shown(i-SORT_BY_DCPU))
+				maxcmdline-=column_width[i];
+	if (config.f.logical)
+		for (i=SORT_BY_LREAD;i<=SORT_BY_SYSCW;i++)
+			maxcmdline-=column_width[i];
+	if (!column_hidden(SORT_BY_PSI))
+		maxcmdline-=column_width[SORT_BY_PSI];
+	if (config.f.pctl)
+		for (i=SORT_BY_PREAD;i<=SORT_BY_PIO;i++)
+			if (i!=SORT_BY_PIO||has_tda)
+				maxcmdline-=column_width[i];
 	gr_width=maxcmdline/4;
 	if (gr_width<5)
 		gr_width=5;
@@ -821,8 +1253,9 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 	if (maxcmdline<0)
 		maxcmdline=0;
 
-	diff_len=create_diff(cs,ps,time_s,act->ts_c,filter_view,(has_unicode&&config.f.unicode)?gr_width*2:gr_width,&dispcount);
+	diff_len=create_diff(fetch_params(),cs,ps,time_s,act->ts_c,filter_view,(has_unicode&&config.f.unicode)?gr_width*2:gr_width,&dispcount);
 
+	trigger_check(cs,ps,act->ts_c);
 	calc_total(cs,&total_read,&total_write);
 	calc_a_total(act,&total_a_read,&total_a_write,time_s);
 
@@ -903,15 +1336,15 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 	gi=config.f.reverse_graph?-1:1;
 	for (j=gs;ge<gs?j>=ge:j<=ge;j+=gi) {
 		if (has_unicode&&config.f.unicode) {
-			strcat(pg_t_r,br_graph[value2scale(hist_t_r[j*2],mx_t_r)][value2scale(hist_t_r[j*2+gi],mx_t_r)]);
-			strcat(pg_t_w,br_graph[value2scale(hist_t_w[j*2],mx_t_w)][value2scale(hist_t_w[j*2+gi],mx_t_w)]);
-			strcat(pg_a_r,br_graph[value2scale(hist_a_r[j*2],mx_a_r)][value2scale(hist_a_r[j*2+gi],mx_a_r)]);
-			strcat(pg_a_w,br_graph[value2scale(hist_a_w[j*2],mx_a_w)][value2scale(hist_a_w[j*2+gi],mx_a_w)]);
+			gp_t_r=gr_add(gp_t_r,br_graph[value2scale(hist_t_r[j*2],mx_t_r)][value2scale(hist_t_r[j*2+gi],mx_t_r)]);
+			gp_t_w=gr_add(gp_t_w,br_graph[value2scale(hist_t_w[j*2],mx_t_w)][value2scale(hist_t_w[j*2+gi],mx_t_w)]);
+			gp_a_r=gr_add(gp_a_r,br_graph[value2scale(hist_a_r[j*2],mx_a_r)][value2scale(hist_a_r[j*2+gi],mx_a_r)]);
+			gp_a_w=gr_add(gp_a_w,br_graph[value2scale(hist_a_w[j*2],mx_a_w)][value2scale(hist_a_w[j*2+gi],mx_a_w)]);
 		} else {
-			strcat(pg_t_r,as_graph[value2scale(hist_t_r[j],mx_t_r)]);
-			strcat(pg_t_w,as_graph[value2scale(hist_t_w[j],mx_t_w)]);
-			strcat(pg_a_r,as_graph[value2scale(hist_a_r[j],mx_a_r)]);
-			strcat(pg_a_w,as_graph[value2scale(hist_a_w[j],mx_a_w)]);
+			gp_t_r=gr_add(gp_t_r,as_graph[value2scale(hist_t_r[j],mx_t_r)]);
+			gp_t_w=gr_add(gp_t_w,as_graph[value2scale(hist_t_w[j],mx_t_w)]);
+			gp_a_r=gr_add(gp_a_r,as_graph[value2scale(hist_a_r[j],mx_a_r)]);
+			gp_a_w=gr_add(gp_a_w,as_graph[value2scale(hist_a_w[j],mx_a_w)]);
 		}
 	}
 
@@ -940,12 +1373,57 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 		}
 	}
 
+	list_line=ionice_line;
+	if (config.f.psi&&!head1row&&psi_get(PSI_IO)&&psi_get(PSI_MEM)) {
+		const struct psi_stats *pi=psi_get(PSI_IO);
+		const struct psi_stats *pm=psi_get(PSI_MEM);
+		char pg_p_i[HISTORY_POS*5]={0};
+		char pg_p_m[HISTORY_POS*5]={0};
+		char *gp_p_i=pg_p_i+1,*gp_p_m=pg_p_m+1;
+
+		if (!config.f.hidegraph) {
+			strcpy(pg_p_i," ");
+			strcpy(pg_p_m," ");
+			for (j=gs;ge<gs?j>=ge:j<=ge;j+=gi)
+				if (has_unicode&&config.f.unicode) {
+					gp_p_i=gr_add(gp_p_i,br_graph[value2scale(pi->hist[j*2],100.0)][value2scale(pi->hist[j*2+gi],100.0)]);
+					gp_p_m=gr_add(gp_p_m,br_graph[value2scale(pm->hist[j*2],100.0)][value2scale(pm->hist[j*2+gi],100.0)]);
+				} else {
+					gp_p_i=gr_add(gp_p_i,as_graph[value2scale(pi->hist[j],100.0)]);
+					gp_p_m=gr_add(gp_p_m,as_graph[value2scale(pm->hist[j],100.0)]);
+				}
+		}
+		mvhline(ionice_line+1,0,' ',maxx);
+		mvprintw(ionice_line+1,0,PSI_FORMAT,pi->some,pi->full,pg_p_i,pm->some,pm->full,pg_p_m);
+		list_line++;
+	}
+	if (config.f.devices) {
+		int dev_lines=diskstats_count()+(vm_pressure_get()?2:1);
+
+		if (dev_lines>(maxy-list_line-4)/2) // keep most of the screen for the tasks
+			dev_lines=(maxy-list_line-4)/2;
+		if (dev_lines>=2&&maxx>DEVICE_WIDTH) {
+			draw_devices(list_line+1,dev_lines,maxx,gr_width<maxx-DEVICE_WIDTH-1?gr_width:maxx-DEVICE_WIDTH-1);
+			list_line+=dev_lines;
+		}
+	}
+	if (config.f.offenders) {
+		int hh_lines=2+(hitters_count()<OFFENDERS_SHOWN?hitters_count():OFFENDERS_SHOWN);
+
+		if (hh_lines>(maxy-list_line-4)/2)
+			hh_lines=(maxy-list_line-4)/2;
+		if (hh_lines>=2&&maxx>OFFENDERS_WIDTH) {
+			draw_offenders(list_line+1,hh_lines,maxx);
+			list_line+=hh_lines;
+		}
+	}
+
 	if (config.f.inverse)
 		attroff(A_REVERSE);
 	else
 		attron(A_REVERSE);
-	mvhline(ionice_line+1,0,' ',maxx);
-	move(ionice_line+1,0);
+	mvhline(list_line+1,0,' ',maxx);
+	move(list_line+1,0);
 
 	for (i=0;i<SORT_BY_MAX;i++) {
 		int wt,wi=column_width[i];
@@ -959,12 +1437,12 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 		if (i==SORT_BY_COMMAND)
 			wi=maxcmdline;
 
-		if (config.opts[&config.f.hidepid-config.opts+i])
+		if (column_hidden(i))
 			continue;
 		// mask swapin and io columns if there is no task_delayacct
-		if ((&config.f.hidepid-config.opts+i==&config.f.hideswapin-config.opts)&&!has_tda)
+		if ((i==SORT_BY_SWAPIN||i==SORT_BY_IO||i==SORT_BY_PIO)&&!has_tda)
 			continue;
-		if ((&config.f.hidepid-config.opts+i==&config.f.hideio-config.opts)&&!has_tda)
+		if (i>=SORT_BY_DCPU&&i<=SORT_BY_DIRQ&&!delay_shown(i-SORT_BY_DCPU))
 			continue;
 
 		wt=strlen(COLUMN_NAME(i));
@@ -1006,7 +1484,7 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 			else
 				attron(A_REVERSE);
 			attron(config.f.nocolor?A_BOLD:COLOR_PAIR(RED_PAIR));
-			mvprintw(ionice_line+1,xpos,"[T]");
+			mvprintw(list_line+1,xpos,"[T]");
 			attroff(config.f.nocolor?A_BOLD:COLOR_PAIR(RED_PAIR));
 			if (config.f.inverse)
 				attron(A_REVERSE);
@@ -1014,12 +1492,15 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 				attroff(A_REVERSE);
 		}
 		if (dontrefresh)
-			mvprintw(ionice_line+1,xpos+(has_tda?0:strlen("[T]")),"[frozen]");
+			mvprintw(list_line+1,xpos+(has_tda?0:strlen("[T]")),"[frozen]");
 		if (!config.f.hideclock) {
-			time_t t=time(NULL);
+			struct timespec wt;
 			struct tm *tm;
 			char ts[20];
+			time_t t;
 
+			wall_time(&wt);
+			t=wt.tv_sec;
 			tm=localtime(&t);
 			if (strftime(ts,sizeof ts,"(%H:%M:%S)",tm)==0)
 				strcpy(ts,"( error! )");
@@ -1027,7 +1508,7 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 				attroff(A_REVERSE);
 			else
 				attron(A_REVERSE);
-			mvprintw(ionice_line+1,xpos+(has_tda?0:strlen("[T]"))+(dontrefresh?strlen("[frozen]"):0),"%s",ts);
+			mvprintw(list_line+1,xpos+(has_tda?0:strlen("[T]"))+(dontrefresh?strlen("[frozen]"):0),"%s",ts);
 			if (config.f.inverse)
 				attron(A_REVERSE);
 			else
@@ -1035,7 +1516,7 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 		}
 	}
 	// easiest place to print debug info
-	//mvprintw(ionice_line+1,maxx-maxcmdline+strlen(COLUMN_L(0))+1," ... ",...);
+	//mvprintw(list_line+1,maxx-maxcmdline+strlen(COLUMN_L(0))+1," ... ",...);
 
 	maxcmdline--; // vertical scroller
 
@@ -1046,9 +1527,9 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 		noinlinehelp=1;
 	else
 		noinlinehelp=0;
-	line=ionice_line+2;
+	line=list_line+2;
 	lastline=line;
-	viewsizey=maxy-1-ionice_line-(noinlinehelp==0&&config.f.helptype==2?2:0);
+	viewsizey=maxy-1-list_line-(noinlinehelp==0&&config.f.helptype==2?2:0);
 	if (viewsizey<0)
 		viewsizey=0;
 	skip=scrollpos;
@@ -1058,13 +1539,13 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 		skip=0;
 	saveskip=skip;
 	if (ionice_pos!=-1) { // have some selected position
-		if (ionice_pos<ionice_line+2)
-			ionice_pos=ionice_line+2;
-		if (ionice_pos>=lastvisible&&lastvisible>ionice_line+2)
+		if (ionice_pos<list_line+2)
+			ionice_pos=list_line+2;
+		if (ionice_pos>=lastvisible&&lastvisible>list_line+2)
 			ionice_pos=lastvisible-1;
 	}
-	// get the maximum visible value, normalize all graphs according to that (R, W and R+W only)
-	if (masked_grtype(0)!=E_GR_IO&&masked_grtype(0)!=E_GR_SW&&!config.f.hidegraph) {
+	// get the maximum visible value, normalize all graphs according to that (R, W, R+W and NW only)
+	if (grtype_is_bw(masked_grtype(0))&&!config.f.hidegraph) {
 		int saveline=line;
 
 		for (i=0;cs->sor&&i<diff_len;i++) {
@@ -1113,6 +1594,13 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 						} else
 							maxvisible=mymax(maxvisible,s->readhist[j]+s->writehist[j]);
 					}
+					if (masked_grtype(0)==E_GR_NW) {
+						if (has_unicode&&config.f.unicode) {
+							maxvisible=mymax(maxvisible,s->netwhist[j*2]);
+							maxvisible=mymax(maxvisible,s->netwhist[j*2+1]);
+						} else
+							maxvisible=mymax(maxvisible,s->netwhist[j]);
+					}
 				}
 
 				if (line>maxy-1-(noinlinehelp==0&&config.f.helptype==2?2:0)) // do not draw out of screen
@@ -1123,21 +1611,34 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 		line=saveline;
 		skip=saveskip;
 	}
+	// a row is drawn from its values and the settings below; the rows with
+	// the same content on the same line are kept from the previous frame
+	rc_size(maxy);
+	for (i=0;i<line&&i<row_cache_sz;i++)
+		row_cache[i]=0;
+	sig=rc_mem(0,config.opts,sizeof config.opts);
+	sig=rc_mix(sig,maxx|(uint64_t)maxcmdline<<16|(uint64_t)gr_width<<32|(uint64_t)maxpidlen<<48);
+	sig=rc_mix(sig,has_unicode|has_tda<<1|in_ionice<<2|params.group<<3);
+	for (j=0;j<DLY_MAX;j++)
+		sig=rc_mix(sig,delay_shown(j));
+	sig=rc_dbl(sig,maxvisible);
 	for (i=0;cs->sor&&i<diff_len;i++) {
 		int th_prio_diff,th_first,th_have_filtered,th_first_id,th_last_id;
 		struct xxxid_stats *ms=cs->sor[i],*s;
-		char read_str[4],write_str[4];
+		char read_str[4],write_str[4],nwrite_str[4];
 		char graphstr[HISTORY_POS*5];
-		double read_val,write_val;
-		char *pw_name,*cmdline;
-		char *pwt,*cmdt;
+		double read_val,write_val,nwrite_val;
+		const char *pw_name,*cmdline;
+		const char *ss;
+		char *gp=graphstr;
 		int hrevpos;
+		uint64_t h;
 
 		// always start showing from processes, threads are kept on the main list for easier search
 		if (ms->pid!=ms->tid)
 			continue;
 		if (ms->threads)
-			if (!(masked_grtype(0)!=E_GR_IO&&masked_grtype(0)!=E_GR_SW&&!config.f.hidegraph))
+			if (!(grtype_is_bw(masked_grtype(0))&&!config.f.hidegraph))
 				arr_sort(ms->threads,iotop_sort_cb);
 		// check if threads use the same prio as the main process
 		// scan for hidden threads
@@ -1194,41 +1695,92 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 			if (config.f.accumbw) {
 				read_val=config.f.processes?s->read_val_abw_p:s->read_val_abw;
 				write_val=config.f.processes?s->write_val_abw_p:s->write_val_abw;
+				nwrite_val=config.f.processes?s->nwrite_val_abw_p:s->nwrite_val_abw;
 			} else if (config.f.accumulated) {
 				read_val=config.f.processes?s->read_val_acc_p:s->read_val_acc;
 				write_val=config.f.processes?s->write_val_acc_p:s->write_val_acc;
+				nwrite_val=config.f.processes?s->nwrite_val_acc_p:s->nwrite_val_acc;
 			} else {
 				if (s->exited) {
 					read_val=0.0;
 					write_val=0.0;
+					nwrite_val=0.0;
 				} else {
 					read_val=config.f.processes?s->read_val_p:s->read_val;
 					write_val=config.f.processes?s->write_val_p:s->write_val;
+					nwrite_val=config.f.processes?s->nwrite_val_p:s->nwrite_val;
 				}
 			}
 
 			humanize_val(&read_val,read_str,1);
 			humanize_val(&write_val,write_str,1);
+			humanize_val(&nwrite_val,nwrite_str,1);
+
+			ss=(has_unicode&&config.f.unicode)?th_lines_u[0]:th_lines_a[0];
+			if (ms->threads) {
+				if (config.f.processes) {
+					if (k==-1&&ms->threads->length)
+						ss=(has_unicode&&config.f.unicode)?th_lines_u[1]:th_lines_a[1];
+				} else
+					if (th_first_id!=th_last_id) {
+						if (k==th_first_id)
+							ss=(has_unicode&&config.f.unicode)?th_lines_u[2+3*th_have_filtered]:th_lines_a[2+3*th_have_filtered];
+						if (k!=th_first_id&&k!=th_last_id)
+							ss=(has_unicode&&config.f.unicode)?th_lines_u[3+3*th_have_filtered]:th_lines_a[3+3*th_have_filtered];
+						if (k==th_last_id)
+							ss=(has_unicode&&config.f.unicode)?th_lines_u[4+3*th_have_filtered]:th_lines_a[4+3*th_have_filtered];
+					}
+			}
+
+			if (in_ionice&&ionice_pos==line)
+				ionice_pos_data=s;
 
-			pwt=esc_low_ascii(s->pw_name);
-			pw_name=u8strpadt(pwt,9);
-			if (pwt)
-				free(pwt);
+			// hidden columns are hashed too, they only cost a redraw
+			h=rc_mix(sig,s->group?config.f.processes?s->procs:s->tasks:s->tid);
+			h=rc_mix(h,s->io_prio|s->error_i<<16|s->error_x<<17|(k==-1&&th_prio_diff)<<18|(in_ionice&&ionice_pos==line)<<19);
+			h=rc_mix(h,s->exited);
+			h=rc_str(h,s->pw_name);
+			h=rc_dbl(h,read_val);
+			h=rc_str(h,read_str);
+			h=rc_dbl(h,write_val);
+			h=rc_str(h,write_str);
+			h=rc_dbl(h,nwrite_val);
+			h=rc_str(h,nwrite_str);
+			h=rc_dbl(h,config.f.processes?s->swapin_val_p:s->swapin_val);
+			h=rc_dbl(h,config.f.processes?s->blkio_val_p:s->blkio_val);
+			for (j=0;j<DLY_MAX;j++)
+				h=rc_dbl(h,config.f.processes?s->delay_val_p[j]:s->delay_val[j]);
+			for (j=0;j<LIO_MAX;j++)
+				h=rc_dbl(h,lio_value(s,j));
+			h=rc_dbl(h,s->psi_val);
+			for (j=0;j<HG_MAX;j++)
+				h=rc_dbl(h,pctl_value(s,j));
+			if (!config.f.hidegraph)
+				h=rc_graph(h,s,(has_unicode&&config.f.unicode)?gr_width*2:gr_width);
+			h=rc_mix(h,(uintptr_t)ss);
+			h=rc_str(h,s->cmdline_comm);
+			h=rc_str(h,config.f.fullcmdline?s->cmdline_long:s->cmdline_short);
+			if (!h)
+				h=1;
+			if (line<row_cache_sz&&row_cache[line]==h)
+				goto rowdone;
+			if (line<row_cache_sz)
+				row_cache[line]=h;
+
+			pw_name=u8fmt(&fb_pw,s->pw_name,9,1);
 
 			if (config.f.fullcmdline&&s->cmdline_comm) { // append custom thread name before full cmdline
 				char tb[1+strlen(s->cmdline_comm)+1+strlen(s->cmdline_long)+1];
 
 				sprintf(tb,"[%s]%s",s->cmdline_comm,s->cmdline_long);
-				cmdt=esc_low_ascii(tb);
+				cmdline=u8fmt(&fb_cmd,tb,maxcmdline>1?maxcmdline-1:0,1); // -1 for thread/process link chars
 			} else
-				cmdt=esc_low_ascii(config.f.fullcmdline?s->cmdline_long:s->cmdline_short);
-			cmdline=u8strpadt(cmdt,maxcmdline-1); // -1 for thread/process link chars
-			if (cmdt)
-				free(cmdt);
+				cmdline=u8fmt(&fb_cmd,config.f.fullcmdline?s->cmdline_long:s->cmdline_short,maxcmdline>1?maxcmdline-1:0,1);
 
 			hrevpos=-1;
 			if (!config.f.hidegraph) {
-				*graphstr=0;
+				gp=graphstr;
+				*gp=0;
 				gs=config.f.reverse_graph?gr_width-1:0;
 				ge=config.f.reverse_graph?0:gr_width-1;
 				gi=config.f.reverse_graph?-1:1;
@@ -1271,45 +1823,65 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 							} else
 								v1=config.f.processes?s->sihist_p[j]:s->sihist[j];
 							break;
+						case E_GR_NW:
+							if (has_unicode&&config.f.unicode) {
+								v1=value2scale(config.f.processes?s->netwhist_p[j*2]:s->netwhist[j*2],maxvisible);
+								v2=value2scale(config.f.processes?s->netwhist_p[j*2+gi]:s->netwhist[j*2+gi],maxvisible);
+							} else
+								v1=value2scale(config.f.processes?s->netwhist_p[j]:s->netwhist[j],maxvisible);
+							break;
+						case E_GR_CPU:
+						case E_GR_MEM:
+						case E_GR_THRASH:
+						case E_GR_COMPACT:
+						case E_GR_WPCOPY:
+						case E_GR_IRQ: {
+							int d=masked_grtype(0)-E_GR_CPU;
+
+							if (has_unicode&&config.f.unicode) {
+								v1=config.f.processes?s->dlyhist_p[d][j*2]:s->dlyhist[d][j*2];
+								v2=config.f.processes?s->dlyhist_p[d][j*2+gi]:s->dlyhist[d][j*2+gi];
+							} else
+								v1=config.f.processes?s->dlyhist_p[d][j]:s->dlyhist[d][j];
+							break;
+						}
 					}
 					if (config.f.deadx) {
 						// +1 avoids stepping on a char with one valid and one invalid value
 						if (((has_unicode&&config.f.unicode)?j*2+1:j)<s->exited)
-							strcat(graphstr,"x");
+							gp=gr_add(gp,"x");
 						else {
 							if (has_unicode&&config.f.unicode)
-								strcat(graphstr,br_graph[v1][v2]);
+								gp=gr_add(gp,br_graph[v1][v2]);
 							else
-								strcat(graphstr,as_graph[v1]);
+								gp=gr_add(gp,as_graph[v1]);
 						}
 					} else {
 						// stepping on a char with one valid and one invalid value is not a problem with background
 						if (has_unicode&&config.f.unicode)
-							strcat(graphstr,br_graph[v1][v2]);
+							gp=gr_add(gp,br_graph[v1][v2]);
 						else
-							strcat(graphstr,as_graph[v1]);
+							gp=gr_add(gp,as_graph[v1]);
 						if (config.f.reverse_graph) {
 							if (((has_unicode&&config.f.unicode)?j*2:j)>=s->exited&&s->exited)
-								hrevpos=strlen(graphstr);
+								hrevpos=gp-graphstr;
 						} else {
 							if (((has_unicode&&config.f.unicode)?j*2:j)<s->exited&&s->exited)
-								hrevpos=strlen(graphstr);
+								hrevpos=gp-graphstr;
 						}
 					}
 				}
-				strcat(graphstr," ");
+				gp=gr_add(gp," ");
 			}
 
-			if (in_ionice&&ionice_pos==line) {
+			if (in_ionice&&ionice_pos==line)
 				attron(A_UNDERLINE);
-				ionice_pos_data=s;
-			}
 			if (s->exited)
 				attron(A_DIM);
 			mvhline(line,0,' ',maxx);
 			move(line,0);
 			if (!config.f.hidepid)
-				printw("%*lu  ",maxpidlen,(unsigned long)s->tid);
+				printw("%*lu  ",maxpidlen,(unsigned long)(s->group?config.f.processes?s->procs:s->tasks:s->tid));
 			if (!config.f.hideprio) {
 				char c=' ';
 
@@ -1340,6 +1912,14 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 				} else
 					printw("%7.2f %-3.3s ",write_val,write_str);
 			}
+			if (config.f.netwrite) {
+				if (s->error_x) {
+					attron(config.f.nocolor?A_ITALIC:COLOR_PAIR(RED_PAIR));
+					printw("   Error    ");
+					attroff(config.f.nocolor?A_ITALIC:COLOR_PAIR(RED_PAIR));
+				} else
+					printw("%7.2f %-3.3s ",nwrite_val,nwrite_str);
+			}
 			if (!config.f.hideswapin&&has_tda) {
 				if (s->error_x) {
 					attron(config.f.nocolor?A_ITALIC:COLOR_PAIR(RED_PAIR));
@@ -1364,9 +1944,56 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 						color_print_pc(config.f.processes?s->blkio_val_p:s->blkio_val);
 				}
 			}
+			if (config.f.delays) {
+				for (j=0;j<DLY_MAX;j++) {
+					if (!delay_shown(j))
+						continue;
+					if (s->error_x) {
+						attron(config.f.nocolor?A_ITALIC:COLOR_PAIR(RED_PAIR));
+						printw("  Error  ");
+						attroff(config.f.nocolor?A_ITALIC:COLOR_PAIR(RED_PAIR));
+					} else {
+						if (s->exited)
+							color_print_pc(0);
+						else
+							color_print_pc(config.f.processes?s->delay_val_p[j]:s->delay_val[j]);
+					}
+				}
+			}
+			if (config.f.logical) {
+				for (j=0;j<LIO_MAX;j++) {
+					double lv=s->exited&&!config.f.accumulated&&!config.f.accumbw?0.0:lio_value(s,j);
+					char lstr[4];
+
+					if (s->error_x) {
+						attron(config.f.nocolor?A_ITALIC:COLOR_PAIR(RED_PAIR));
+						printw("   Error    ");
+						attroff(config.f.nocolor?A_ITALIC:COLOR_PAIR(RED_PAIR));
+						continue;
+					}
+					if (j==LIO_RCHAR||j==LIO_WCHAR)
+						humanize_val(&lv,lstr,1);
+					else
+						humanize_cnt(&lv,lstr,1);
+					printw("%7.2f %-3.3s ",lv,lstr);
+				}
+			}
+			if (!column_hidden(SORT_BY_PSI))
+				color_print_pc(s->exited?0:s->psi_val);
+			if (config.f.pctl) { // exited tasks keep the percentiles of their life
+				for (j=HG_READ;j<=HG_WRITE;j++) {
+					double pv=pctl_value(s,j);
+					char pstr[4];
+
+					humanize_val(&pv,pstr,0);
+					printw("%7.2f %-3.3s ",pv,pstr);
+				}
+				if (has_tda)
+					color_print_pc(pctl_value(s,HG_BLKIO));
+			}
 			if (!config.f.hidegraph&&hrevpos>0) {
 				if (config.f.reverse_graph) {
-					graphstr[strlen(graphstr)-1]=0; // remove last space
+					gp[-1]=0; // remove last space
 					printw("%*.*s",hrevpos,hrevpos,graphstr);
 					if (config.f.inverse)
 						attroff(A_REVERSE);
@@ -1392,35 +2019,14 @@ static inline void view_curses(struct xxxid_stats_arr *cs,struct xxxid_stats_arr
 				}
 			} else
 				printw("%s",!config.f.hidegraph?graphstr:"");
-			if (!config.f.hidecmd) {
-				const char *ss=(has_unicode&&config.f.unicode)?th_lines_u[0]:th_lines_a[0];
-
-				if (ms->threads) {
-					if (config.f.processes) {
-						if (k==-1&&ms->threads->length)
-							ss=(has_unicode&&config.f.unicode)?th_lines_u[1]:th_lines_a[1];
-					} else
-						if (th_first_id!=th_last_id) {
-							if (k==th_first_id)
-								ss=(has_unicode&&config.f.unicode)?th_lines_u[2+3*th_have_filtered]:th_lines_a[2+3*th_have_filtered];
-							if (k!=th_first_id&&k!=th_last_id)
-								ss=(has_unicode&&config.f.unicode)?th_lines_u[3+3*th_have_filtered]:th_lines_a[3+3*th_have_filtered];
-							if (k==th_last_id)
-								ss=(has_unicode&&config.f.unicode)?th_lines_u[4+3*th_have_filtered]:th_lines_a[4+3*th_have_filtered];
-						}
-				}
+			if (!config.f.hidecmd)
 				printw("%s%s",ss,cmdline?cmdline:"(null)");
-			}
 			if (in_ionice&&ionice_pos==line)
 				attroff(A_UNDERLINE);
 
-			if (pw_name)
-				free(pw_name);
-			if (cmdline)
-				free(cmdline);
 			if (s->exited)
 				attroff(A_DIM);
-
+rowdone:
 			line++;
 			lastline=line;
 			if (line>maxy-1-(noinlinehelp==0&&config.f.helptype==2?2:0)) // do not draw out of screen
@@ -1431,8 +2037,30 @@ donedraw:
 	lastvisible=lastline; // last selectable screen line
 	for (line=lastline;line<=maxy-1-(noinlinehelp==0&&config.f.helptype==2?2:0);line++) // always draw empty lines
 		mvhline(line,0,' ',maxx);
+	for (line=lastline;line<row_cache_sz;line++)
+		row_cache[line]=0;
 
-	if (in_ionice) {
+	if (in_ionice&&params.group) {
+		mvhline(ionice_line,0,' ',maxx);
+		mvprintw(ionice_line,0,"%c%s: ",toupper(group_name()[0]),group_name()+1);
+		if (ionice_pos==-1||ionice_pos_data==NULL||ionice_pos_data->exited)
+			printw("(select by arrows)");
+		else {
+			attron(A_BOLD);
+			printw("%s",ionice_pos_data->cmdline_long);
+			attroff(A_BOLD);
+			printw(" ");
+			if (config.f.inverse)
+				attroff(A_REVERSE);
+			else
+				attron(A_REVERSE);
+			printw("[use arrows to select, enter to show its tasks]");
+			if (config.f.inverse)
+				attron(A_REVERSE);
+			else
+				attroff(A_REVERSE);
+		}
+	} else if (in_ionice) {
 		mvhline(ionice_line,0,' ',maxx);
 		mvprintw(ionice_line,0,"%s: ",COLUMN_NAME(0));
 
@@ -1668,7 +2296,7 @@ donedraw:
 				free(ss);
 		}
 	}
-	draw_vscroll(maxx-1,head1row?2:3,maxy-1-(noinlinehelp==0&&config.f.helptype==2?2:0),dispcount,saveskip);
+	draw_vscroll(maxx-1,list_line+2,maxy-1-(noinlinehelp==0&&config.f.helptype==2?2:0),dispcount,saveskip);
 	if (config.f.helptype==2) {
 		if (config.f.inverse)
 			attroff(A_REVERSE);
@@ -1701,7 +2329,7 @@ donedraw:
 		printw("i");
 		attroff(config.f.nocolor?A_ITALIC:COLOR_PAIR(CYAN_PAIR));
 		attroff(A_UNDERLINE);
-		printw(": ionice ");
+		printw(params.group?": select ":": ionice ");
 
 		attron(A_UNDERLINE);
 		attron(config.f.nocolor?A_ITALIC:COLOR_PAIR(CYAN_PAIR));
@@ -1816,7 +2444,24 @@ donedraw:
 		else
 			attroff(A_REVERSE);
 	}
+	touchwin(stdscr); // the cached rows are untouched but may be under a closed window
 	wnoutrefresh(stdscr);
+	if (params.profile) { // bottom right, above the inline help
+		int rph,rpw;
+
+		pfx=pfw+1>=maxx?0:maxx-1-pfw;
+		pfy=pfh+2>=maxy?0:maxy-2-pfh;
+		rpw=pfx+pfw>maxx?maxx-pfx:pfw;
+		rph=pfy+pfh>maxy?maxy-pfy:pfh;
+		if (rpw<=0)
+			rpw=1;
+		if (rph<=0)
+			rph=1;
+		wresize(wprof,rph,rpw);
+		mvwin(wprof,pfy,pfx);
+		view_profile();
+		wnoutrefresh(wprof);
+	}
 	if (config.f.helptype==1) {
 		int rhh,rhw;
 
@@ -2139,7 +2784,7 @@ static inline int curses_key(int ch) {
 				if (strlen(ionice_id))
 					ionice_cl=!ionice_cl;
 				else
-					if (ionice_pos!=-1)
+					if (ionice_pos!=-1&&!params.group)
 						ionice_col=(ionice_col+1)%3;
 			}
 			if (!in_ionice&&!in_filter) {
@@ -2153,7 +2798,7 @@ static inline int curses_key(int ch) {
 				if (strlen(ionice_id))
 					ionice_cl=!ionice_cl;
 				else
-					if (ionice_pos!=-1)
+					if (ionice_pos!=-1&&!params.group)
 						ionice_col=(ionice_col+3-1)%3;
 			}
 			if (!in_ionice&&!in_filter) {
@@ -2179,7 +2824,7 @@ static inline int curses_key(int ch) {
 						ionice_col=0;
 					switch (ionice_col) {
 						case 0:
-							if (ionice_pos>ionice_line+2) {
+							if (ionice_pos>list_line+2) {
 								ionice_id_changed=1;
 								ionice_pos--;
 							}
@@ -2222,7 +2867,7 @@ static inline int curses_key(int ch) {
 						case 0:
 							ionice_id_changed=1;
 							if (ionice_pos==-1)
-								ionice_pos=ionice_line+2;
+								ionice_pos=list_line+2;
 							else
 								if (ionice_pos+1<lastvisible)
 									ionice_pos++;
@@ -2315,7 +2960,7 @@ static inline int curses_key(int ch) {
 			break;
 		case 'i':
 		case 'I':
-			if (!config.f.norenice&&!in_filter) {
+			if ((!config.f.norenice||params.group)&&!in_filter) { // in a group view it selects a group
 				in_ionice=1;
 				ionice_id[0]=0;
 				ionice_cl=1;
@@ -2328,6 +2973,81 @@ static inline int curses_key(int ch) {
 		case 'E':
 			config.f.hideexited=!config.f.hideexited;
 			break;
+		case 'z': // roll group view forward
+		case 'Z': // roll group view backward
+			switch (params.group) {
+				case E_GRP_NONE:
+					params.group=ch=='z'?E_GRP_CGROUP:E_GRP_USER;
+					break;
+				case E_GRP_CGROUP:
+					params.group=ch=='z'?E_GRP_USER:E_GRP_NONE;
+					break;
+				case E_GRP_USER:
+					params.group=ch=='z'?E_GRP_NONE:E_GRP_CGROUP;
+					break;
+			}
+			if (params.group==E_GRP_CGROUP&&replaying()) // the cgroups are not recorded
+				params.group=ch=='z'?E_GRP_USER:E_GRP_NONE;
+			if (params.cgroup) // back from the tasks of a cgroup
+				free(params.cgroup);
+			params.cgroup=NULL;
+			in_ionice=0;
+			break;
+		case 'w':
+			config.f.netwrite=!config.f.netwrite;
+			break;
+		case 'v':
+		case 'V':
+			config.f.logical=!config.f.logical;
+			break;
+		case 'y':
+		case 'Y':
+			config.f.delays=!config.f.delays;
+			break;
+		case 'k':
+		case 'K':
+			config.f.devices=!config.f.devices;
+			break;
+		case 'm':
+		case 'M':
+			config.f.psi=!config.f.psi;
+			break;
+		case '#':
+			config.f.offenders=!config.f.offenders;
+			break;
+		case '!':
+			ring_flush();
+			break;
+		case '%':
+			switch (config.f.pctl) {
+				case 0:
+					config.f.pctl=50;
+					break;
+				case 50:
+					config.f.pctl=95;
+					break;
+				case 95:
+					config.f.pctl=99;
+					break;
+				default:
+					config.f.pctl=0;
+					break;
+			}
+			break;
+		case 'j':
+		case 'J':
+			params.profile=!params.profile;
+			break;
+		case '[':
+		case ']':
+			if (params.replay_file)
+				replay_seek(ch=='['?-REPLAY_SEEK:REPLAY_SEEK);
+			break;
+		case '{':
+		case '}':
+			if (params.replay_file)
+				replay_speed(ch=='{'?-1:1);
+			break;
 		case 'f':
 		case 'F':
 			if (!in_ionice) {
@@ -2385,6 +3105,11 @@ static inline int curses_key(int ch) {
 			break;
 		case KEY_RET: // CR
 		case KEY_ENTER:
+			if (in_ionice&&params.group) {
+				if (ionice_pos_data&&!ionice_pos_data->exited)
+					group_drill(ionice_pos_data);
+				in_ionice=0;
+			}
 			if (in_ionice&&strlen(ionice_id)) {
 				pid_t pgid=atoi(ionice_id);
 				int who=IOPRIO_WHO_PROCESS;
@@ -2424,7 +3149,7 @@ static inline int curses_key(int ch) {
 				if (strlen(ionice_id))
 					ionice_cl=!ionice_cl;
 				else
-					if (ionice_pos!=-1)
+					if (ionice_pos!=-1&&!params.group)
 						ionice_col=(ionice_col+1)%3;
 			}
 			if (in_filter)
@@ -2456,7 +3181,7 @@ static inline int curses_key(int ch) {
 			}
 			break;
 		case '0'...'9':
-			if (in_ionice) {
+			if (in_ionice&&!params.group) {
 				size_t idlen=strlen(ionice_id);
 
 				if (idlen<sizeof ionice_id-1) {
@@ -2487,6 +3212,9 @@ static inline int curses_key(int ch) {
 
 					for (i=1;i<=9;i++)
 						config.opts[&config.f.hidepid-config.opts+i-1]=0;
+					config.f.netwrite=1;
+					config.f.logical=1;
+					config.f.delays=1;
 				}
 			}
 			break;
@@ -2600,6 +3328,13 @@ inline void view_curses_init(void) {
 		fprintf(stderr,"Error: can not allocate warning window\n");
 		exit(1);
 	}
+	wprof=newwin(pfh,pfw,pfy,pfx);
+	if (!wprof) {
+		view_curses_fini();
+		nl_fini();
+		fprintf(stderr,"Error: can not allocate profile window\n");
+		exit(1);
+	}
 }
 
 inline void view_curses_fini(void) {
@@ -2607,7 +3342,16 @@ inline void view_curses_fini(void) {
 		delwin(whelp);
 	if (wtda)
 		delwin(wtda);
+	if (wprof)
+		delwin(wprof);
 	endwin();
+	free(row_cache);
+	row_cache=NULL;
+	row_cache_sz=0;
+	free(fb_pw.p);
+	free(fb_cmd.p);
+	memset(&fb_pw,0,sizeof fb_pw);
+	memset(&fb_cmd,0,sizeof fb_cmd);
 	if (params.search_str) {
 		free(params.search_str);
 		params.search_str=NULL;
@@ -2644,14 +3388,20 @@ inline void view_curses_loop(void) {
 	struct xxxid_stats_arr *ps=NULL;
 	struct xxxid_stats_arr *cs=NULL;
 	struct act_stats act={0,0,0,0,0,0,0,};
+	e_group group=params.group;
 	uint64_t bef=0;
 	int refresh=0;
 	int k=ERR;
 
 	for (;;) {
 		uint64_t now=monotime();
+		uint64_t period=replaying()?replay_period():trigger_period();
+		int seek=0;
 
-		if (!read_task_delayacct()) {
+		if (!collector->has_delays) { // nothing to enable
+			showtda=0;
+			has_tda=0;
+		} else if (!replaying()&&!read_task_delayacct()) {
 			if (has_tda)
 				showtda=1;
 			has_tda=0;
@@ -2659,7 +3409,24 @@ inline void view_curses_loop(void) {
 			showtda=0;
 			has_tda=1;
 		}
-		if (bef+1000*params.delay<now&&!dontrefresh) {
+		if (params.replay_file&&replay_seeked()) { // start over from the new position
+			if (cs)
+				arr_free(cs);
+			cs=NULL;
+			act.ts_c=0;
+			act.have_o=0;
+			seek=1;
+		}
+		if (params.group!=group) { // group rows and tasks do not mix, start over
+			group=params.group;
+			if (cs)
+				arr_free(cs);
+			cs=NULL;
+			act.ts_c=0;
+			act.have_o=0;
+			seek=1;
+		}
+		if (seek||(bef+period<now&&!dontrefresh&&!(replaying()&&replay_eof()))) {
 			bef=now;
 			if (ps)
 				arr_free(ps);
@@ -2671,15 +3438,23 @@ inline void view_curses_loop(void) {
 				act.have_o=1;
 			act.ts_o=act.ts_c;
 
-			cs=fetch_data(NULL);
+			cs=fetch_data(fetch_params(),NULL,ps);
 			if (!ps) {
 				ps=cs;
-				cs=fetch_data(NULL);
+				cs=fetch_data(fetch_params(),NULL,ps);
 			}
 			get_vm_counters(&act.read_bytes,&act.write_bytes);
-			act.ts_c=now;
+			if (config.f.devices) {
+				diskstats_update();
+				vm_pressure_update();
+			}
+			if (config.f.psi)
+				psi_update();
+			act.ts_c=replaying()?replay_time():now;
+			if (params.record_file||params.ring_file)
+				record_frame(cs,act.read_bytes,act.write_bytes,act.ts_c);
 			refresh=1;
-		} else if (bef+1000*params.delay<now&&dontrefresh&&!config.f.hideclock) {
+		} else if (bef+period<now&&dontrefresh&&!config.f.hideclock) {
 			bef=now;
 			refresh=1;
 		}
@@ -2691,7 +3466,10 @@ inline void view_curses_loop(void) {
 			if ((kres=curses_key(k))>0)
 				break;
 			if (kres==0) {
+				uint64_t t=prof_start();
+
 				view_curses(cs,ps,&act,refresh);
+				prof_end(PROF_RENDER,t);
 				refresh=0;
 			}
 		}
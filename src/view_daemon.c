@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+
+#include <time.h>
+#include <stdio.h>
+
+// --daemon: collect every --delay seconds and publish in shared memory; the
+// attached clients do all the filtering and rendering themselves
+
+inline void view_daemon_init(void) {
+	if (!collector->has_delays)
+		fprintf(stderr,"Warning: %s collector does not provide SWAPIN and IO\n",collector->name);
+	else if (!replaying()&&!read_task_delayacct())
+		fprintf(stderr,"Warning: task_delayacct is 0, enable by: echo 1 > /proc/sys/kernel/task_delayacct\n");
+}
+
+inline void view_daemon_fini(void) {
+	daemon_close();
+}
+
+inline void view_daemon_loop(void) {
+	struct xxxid_stats_arr *ps=NULL;
+	struct xxxid_stats_arr *cs=NULL;
+	int64_t next=monotime();
+	uint64_t ts_o=0;
+
+	for (;;) {
+		uint64_t pgin=0,pgou=0;
+		uint64_t ts;
+		int64_t now;
+
+		if (replaying()&&replay_eof())
+			break;
+		cs=fetch_data(fetch_params(),NULL,ps);
+		get_vm_counters(&pgin,&pgou);
+		ts=replaying()?replay_time():(uint64_t)monotime();
+		daemon_publish(cs,pgin,pgou,ts);
+		if (trigger_count()) { // the rules need the values of the interval
+			create_diff(fetch_params(),cs,ps,timediff_in_s(ts_o,ts),ts,NULL,0,NULL);
+			trigger_check(cs,ps,ts);
+		}
+		ts_o=ts;
+
+		if (ps)
+			arr_free(ps);
+		ps=cs;
+
+		if ((params.iter>-1)&&((--params.iter)==0))
+			break;
+
+		// keep the period regardless of the collection time
+		next+=trigger_period();
+		now=monotime();
+		if (next<now)
+			next=now;
+		else {
+			struct timespec ts;
+
+			ts.tv_sec=(next-now)/1000;
+			ts.tv_nsec=(next-now)%1000*1000000;
+			while (nanosleep(&ts,&ts))
+				;
+		}
+	}
+	arr_free(ps);
+}
@@ -0,0 +1,662 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+#include "iotop.h"
+
+#include <poll.h>
+#include <netdb.h>
+#include <errno.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+// --export: OpenMetrics text over HTTP; the data is collected every --delay
+// seconds and rendered once, the scrapes in between get the same buffer
+
+#define EXP_REQ_MAX 4096 // longest accepted request head
+#define EXP_IO_TIMEOUT 2000 // ms for a whole connection, request and reply
+
+enum {
+	EXC_READ,
+	EXC_WRITE,
+	EXC_CANCELLED,
+	EXC_RCHAR, // EXC_RCHAR..EXC_SYSCW are in the order of LIO_*
+	EXC_WCHAR,
+	EXC_SYSCR,
+	EXC_SYSCW,
+	EXC_SWAPIN,
+	EXC_BLKIO,
+	EXC_DCPU, // EXC_DCPU..EXC_DIRQ are in the order of DLY_*
+	EXC_DMEM,
+	EXC_DTHRASH,
+	EXC_DCOMPACT,
+	EXC_DWPCOPY,
+	EXC_DIRQ,
+	EXC_MAX
+};
+
+// the delays form one metric family and differ by kind
+static const struct {
+	const char *name;
+	const char *help;
+	const char *kind;
+} em[EXC_MAX]={
+	{"read_bytes","Bytes read from block devices",NULL},
+	{"write_bytes","Bytes written to block devices",NULL},
+	{"cancelled_write_bytes","Dirty page cache bytes that were truncated before writeback",NULL},
+	{"logical_read_bytes","Bytes read by syscalls including page cache hits",NULL},
+	{"logical_write_bytes","Bytes written by syscalls",NULL},
+	{"read_syscalls","Read syscalls",NULL},
+	{"write_syscalls","Write syscalls",NULL},
+	{"delay_seconds","Time spent waiting, summed over the threads","swapin"},
+	{"delay_seconds",NULL,"blkio"}, // the family is described by the swapin entry
+	{"delay_seconds",NULL,"cpu"},
+	{"delay_seconds",NULL,"mem"},
+	{"delay_seconds",NULL,"thrash"},
+	{"delay_seconds",NULL,"compact"},
+	{"delay_seconds",NULL,"wpcopy"},
+	{"delay_seconds",NULL,"irq"},
+};
+
+// per user totals are accumulated from the per process deltas so they stay
+// monotonic when processes exit
+struct exp_user {
+	int euid;
+	char *name;
+	uint64_t c[EXC_MAX];
+};
+
+// a process counter is its previous value plus the deltas of its threads,
+// so it does not go back when a thread exits, as the group rows in group.c
+struct exp_acc {
+	pid_t pid; // 0 marks an empty slot
+	uint64_t c[EXC_MAX];
+};
+
+struct exp_proc {
+	struct xxxid_stats *s;
+	uint64_t *c; // the exported counters
+	uint64_t dc[EXC_MAX]; // change since the previous collection
+	uint64_t d; // block I/O in the last interval, used for the top N
+	uint64_t l; // logical I/O in the last interval, breaks the ties
+};
+
+static int exp_fd=-1;
+static char *exp_path=NULL; // unix socket to remove on exit
+static char *exp_buf=NULL; // rendered metrics
+static size_t exp_len=0;
+static struct exp_user *eu=NULL;
+static int eu_len=0;
+static int eu_size=0;
+static uint64_t exp_other[EXC_MAX]; // processes outside of the top N
+static struct exp_acc *ea=NULL; // open addressing by pid, rebuilt on each collection
+static int ea_sz=0;
+
+static inline int exc_available(int i) {
+	if (i>=EXC_SWAPIN&&!collector->has_delays)
+		return 0;
+	if (i>=EXC_DCPU)
+		return delay_available(i-EXC_DCPU);
+	return 1;
+}
+
+static inline uint64_t exc_task(struct xxxid_stats *s,int i) {
+	switch (i) {
+		case EXC_READ:
+			return s->read_bytes;
+		case EXC_WRITE:
+			return s->write_bytes;
+		case EXC_CANCELLED:
+			return s->cancelled_write_bytes;
+		case EXC_RCHAR:
+		case EXC_WCHAR:
+		case EXC_SYSCR:
+		case EXC_SYSCW:
+			return lio_counter(s,i-EXC_RCHAR);
+		case EXC_SWAPIN:
+			return s->swapin_delay_total;
+		case EXC_BLKIO:
+			return s->blkio_delay_total;
+		default:
+			return s->delay_total[i-EXC_DCPU];
+	}
+}
+
+// change of a task since the previous collection, all of it for a new one
+static inline uint64_t exc_delta(struct xxxid_stats *t,struct xxxid_stats_arr *ps,int i) {
+	struct xxxid_stats *p=arr_find(ps,t->tid);
+	uint64_t c=exc_task(t,i);
+	uint64_t o;
+
+	if (!p||p->pid!=t->pid||p->error_x||t->error_x)
+		return c;
+	o=exc_task(p,i);
+	return c>=o?c-o:0; // counters never go back unless the tid is reused
+}
+
+// the deltas of the process and its threads; the _p delays are the maximum
+// over the threads which is right for a percentage but not for a counter
+static inline void exp_deltas(struct exp_proc *e,struct xxxid_stats_arr *ps) {
+	struct xxxid_stats *s=e->s;
+	int i,j;
+
+	for (i=0;i<EXC_MAX;i++) {
+		e->dc[i]=exc_delta(s,ps,i);
+		for (j=0;s->threads&&j<s->threads->length;j++)
+			e->dc[i]+=exc_delta(s->threads->arr[j],ps,i);
+	}
+}
+
+// a new process starts from the sum of the counters of its threads
+static inline uint64_t exc_proc(struct xxxid_stats *s,int i) {
+	uint64_t v=exc_task(s,i);
+	int j;
+
+	for (j=0;s->threads&&j<s->threads->length;j++)
+		v+=exc_task(s->threads->arr[j],i);
+	return v;
+}
+
+static inline struct exp_acc *ea_find(struct exp_acc *t,int sz,pid_t pid) {
+	unsigned h=(unsigned)pid*2654435761U;
+
+	for (;;h++) {
+		struct exp_acc *e=t+(h&(sz-1));
+
+		if (!e->pid||e->pid==pid)
+			return e;
+	}
+}
+
+static inline struct exp_user *exp_user(struct xxxid_stats *s) {
+	int i;
+
+	for (i=0;i<eu_len;i++)
+		if (eu[i].euid==s->euid)
+			return eu+i;
+	if (eu_len==eu_size) {
+		int ns=eu_size?eu_size*2:16;
+		struct exp_user *t=realloc(eu,ns*sizeof *eu);
+
+		if (!t)
+			return NULL;
+		eu=t;
+		eu_size=ns;
+	}
+	memset(eu+eu_len,0,sizeof *eu);
+	eu[eu_len].euid=s->euid;
+	eu[eu_len].name=strdup(s->pw_name?s->pw_name:"");
+	if (!eu[eu_len].name)
+		return NULL;
+	return eu+eu_len++;
+}
+
+static int exp_cmp(const void *a,const void *b) {
+	const struct exp_proc *pa=a;
+	const struct exp_proc *pb=b;
+
+	if (pa->d!=pb->d)
+		return pa->d<pb->d?1:-1;
+	if (pa->l!=pb->l)
+		return pa->l<pb->l?1:-1;
+	return pa->s->tid-pb->s->tid;
+}
+
+// label values escape backslash, double quote and newline
+static inline void exp_label(const char *n,const char *v) {
+	const char *b=v;
+
+	obuf_str(n);
+	obuf_put("=\"",2);
+	for (;*v;v++)
+		if (*v=='\\'||*v=='"'||*v=='\n') {
+			obuf_put(b,v-b);
+			obuf_chr('\\');
+			obuf_chr(*v=='\n'?'n':*v);
+			b=v+1;
+		}
+	obuf_put(b,v-b);
+	obuf_chr('"');
+}
+
+// closes the label set, kind goes last; open tells whether there are labels before it
+static inline void exp_value(int i,int open,uint64_t v) {
+	if (em[i].kind) {
+		obuf_str(open?",":"{");
+		exp_label("kind",em[i].kind);
+		open=1;
+	}
+	obuf_str(open?"} ":" ");
+	if (i<EXC_SWAPIN)
+		obuf_u64(v);
+	else { // nanoseconds to seconds, microsecond resolution
+		uint64_t f=v%1000000000/1000;
+		char t[7];
+		int j;
+
+		obuf_u64(v/1000000000);
+		for (j=6;j>0;j--) {
+			t[j]='0'+f%10;
+			f/=10;
+		}
+		t[0]='.';
+		obuf_put(t,sizeof t);
+	}
+	obuf_chr('\n');
+}
+
+static inline void exp_family(const char *scope,int i) {
+	if (!em[i].help)
+		return;
+	obuf_str("# TYPE iotop_");
+	obuf_str(scope);
+	obuf_chr('_');
+	obuf_str(em[i].name);
+	obuf_str(" counter\n# HELP iotop_");
+	obuf_str(scope);
+	obuf_chr('_');
+	obuf_str(em[i].name);
+	obuf_chr(' ');
+	obuf_str(em[i].help);
+	obuf_chr('\n');
+}
+
+static inline void exp_sample(const char *scope,int i) {
+	obuf_str("iotop_");
+	obuf_str(scope);
+	obuf_chr('_');
+	obuf_str(em[i].name);
+	obuf_str("_total");
+}
+
+static inline void exp_render(struct exp_proc *ep,int n,int np,uint64_t pgin,uint64_t pgou) {
+	int i,j;
+
+	obuf_capture();
+	obuf_str("# TYPE iotop_disk_read_bytes counter\n# HELP iotop_disk_read_bytes Bytes read from block devices by the whole system\n");
+	obuf_str("iotop_disk_read_bytes_total ");
+	obuf_u64(pgin);
+	obuf_str("\n# TYPE iotop_disk_write_bytes counter\n# HELP iotop_disk_write_bytes Bytes written to block devices by the whole system\n");
+	obuf_str("iotop_disk_write_bytes_total ");
+	obuf_u64(pgou);
+	obuf_str("\n# TYPE iotop_processes gauge\n# HELP iotop_processes Processes seen in the last collection\n");
+	obuf_str("iotop_processes ");
+	obuf_i64(np);
+	obuf_str("\n# TYPE iotop_exported_processes gauge\n# HELP iotop_exported_processes Processes exported individually, the rest is in iotop_other_*\n");
+	obuf_str("iotop_exported_processes ");
+	obuf_i64(n);
+	obuf_chr('\n');
+
+	for (i=0;i<EXC_MAX;i++) {
+		if (!exc_available(i))
+			continue;
+		exp_family("process",i);
+		for (j=0;j<n;j++) {
+			struct xxxid_stats *s=ep[j].s;
+			char pid[22];
+
+			sprintf(pid,"%d",s->pid);
+			exp_sample("process",i);
+			obuf_chr('{');
+			exp_label("pid",pid);
+			obuf_chr(',');
+			exp_label("user",s->pw_name?s->pw_name:"");
+			obuf_chr(',');
+			exp_label("comm",s->cmdline_comm?s->cmdline_comm:s->cmdline_short);
+			exp_value(i,1,ep[j].c[i]);
+		}
+	}
+	for (i=0;i<EXC_MAX;i++) {
+		if (!exc_available(i))
+			continue;
+		exp_family("user",i);
+		for (j=0;j<eu_len;j++) {
+			char uid[22];
+
+			sprintf(uid,"%d",eu[j].euid);
+			exp_sample("user",i);
+			obuf_chr('{');
+			exp_label("uid",uid);
+			obuf_chr(',');
+			exp_label("user",eu[j].name);
+			exp_value(i,1,eu[j].c[i]);
+		}
+	}
+	for (i=0;i<EXC_MAX;i++) {
+		if (!exc_available(i))
+			continue;
+		exp_family("other",i);
+		exp_sample("other",i);
+		exp_value(i,0,exp_other[i]);
+	}
+	obuf_str("# EOF\n");
+
+	{
+		size_t len;
+		char *b=obuf_captured(&len);
+
+		if (b) { // keep serving the previous data when out of memory
+			if (exp_buf)
+				free(exp_buf);
+			exp_buf=b;
+			exp_len=len;
+		}
+	}
+}
+
+static inline void exp_collect(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,uint64_t pgin,uint64_t pgou) {
+	struct exp_proc *ep;
+	struct exp_acc *na;
+	int i,j,n=0,sz;
+
+	ep=malloc((cs->length+1)*sizeof *ep);
+	if (!ep)
+		return;
+	for (sz=64;sz<cs->length*2;sz*=2)
+		;
+	na=calloc(sz,sizeof *na);
+	if (!na) {
+		free(ep);
+		return;
+	}
+
+	for (i=0;i<cs->length;i++) {
+		struct xxxid_stats *s=cs->arr[i];
+		struct exp_acc *o,*a;
+
+		if (s->pid!=s->tid)
+			continue;
+		ep[n].s=s;
+		exp_deltas(ep+n,ps);
+		o=ea&&arr_find(ps,s->tid)?ea_find(ea,ea_sz,s->pid):NULL; // the pid may be reused
+		a=ea_find(na,sz,s->pid);
+		a->pid=s->pid;
+		for (j=0;j<EXC_MAX;j++)
+			a->c[j]=o&&o->pid?o->c[j]+ep[n].dc[j]:exc_proc(s,j);
+		ep[n].c=a->c;
+		ep[n].d=ep[n].dc[EXC_READ]+ep[n].dc[EXC_WRITE];
+		ep[n].l=ep[n].dc[EXC_RCHAR]+ep[n].dc[EXC_WCHAR];
+		n++;
+	}
+	free(ea);
+	ea=na;
+	ea_sz=sz;
+	qsort(ep,n,sizeof *ep,exp_cmp);
+
+	// the first collection is the baseline for the per user and other totals
+	for (i=0;ps&&i<n;i++) {
+		struct exp_user *u=exp_user(ep[i].s);
+
+		for (j=0;j<EXC_MAX;j++) {
+			if (u)
+				u->c[j]+=ep[i].dc[j];
+			if (i>=params.export_top)
+				exp_other[j]+=ep[i].dc[j];
+		}
+	}
+
+	exp_render(ep,n<params.export_top?n:params.export_top,n,pgin,pgou);
+	free(ep);
+}
+
+// wait for fd to become ready until the deadline of the connection
+static inline int exp_wait(int fd,short ev,uint64_t end) {
+	for (;;) {
+		struct pollfd pfd={fd,ev,0};
+		uint64_t now=monotime_ns();
+		int r;
+
+		if (now>=end)
+			return 0;
+		r=poll(&pfd,1,(int)((end-now+999999)/1000000));
+		if (r==-1&&errno==EINTR)
+			continue;
+		return r>0;
+	}
+}
+
+static inline void exp_serve(void) {
+	static const char ok[]="HTTP/1.0 200 OK\r\nContent-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\nConnection: close\r\nContent-Length: ";
+	static const char nf[]="HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nConnection: close\r\nContent-Length: 10\r\n\r\nnot found\n";
+	char req[EXP_REQ_MAX+1];
+	size_t rl=0;
+	char hdr[sizeof ok+24];
+	const char *d[2];
+	size_t dl[2];
+	uint64_t end;
+	int fd,i;
+
+	fd=accept(exp_fd,NULL,NULL);
+	if (fd==-1)
+		return;
+	fcntl(fd,F_SETFD,FD_CLOEXEC);
+	// a slow client must not hold the main loop, the connection gets a
+	// single deadline and is closed when it passes
+	fcntl(fd,F_SETFL,fcntl(fd,F_GETFL)|O_NONBLOCK);
+	end=monotime_ns()+EXP_IO_TIMEOUT*1000000ULL;
+
+	// only the request line matters, the rest of the head is read and dropped
+	while (rl<EXP_REQ_MAX) {
+		ssize_t r=recv(fd,req+rl,EXP_REQ_MAX-rl,0);
+
+		if (r==-1&&errno==EINTR)
+			continue;
+		if (r==-1&&(errno==EAGAIN||errno==EWOULDBLOCK)) {
+			if (exp_wait(fd,POLLIN,end))
+				continue;
+			break;
+		}
+		if (r<=0)
+			break;
+		rl+=r;
+		req[rl]=0;
+		if (strstr(req,"\r\n\r\n")||strstr(req,"\n\n"))
+			break;
+	}
+	req[rl]=0;
+
+	if (!strncmp(req,"GET /metrics ",13)||!strncmp(req,"GET / ",6)) {
+		snprintf(hdr,sizeof hdr,"%s%lu\r\n\r\n",ok,(unsigned long)exp_len);
+		d[0]=hdr;
+		dl[0]=strlen(hdr);
+		d[1]=exp_buf;
+		dl[1]=exp_len;
+	} else {
+		d[0]=nf;
+		dl[0]=sizeof nf-1;
+		dl[1]=0;
+	}
+	for (i=0;i<2;i++)
+		while (dl[i]) {
+			ssize_t w=send(fd,d[i],dl[i],MSG_NOSIGNAL);
+
+			if (w==-1&&errno==EINTR)
+				continue;
+			if (w==-1&&(errno==EAGAIN||errno==EWOULDBLOCK)&&exp_wait(fd,POLLOUT,end))
+				continue;
+			if (w<=0) {
+				i=2;
+				break;
+			}
+			d[i]+=w;
+			dl[i]-=w;
+		}
+	close(fd);
+}
+
+// ADDR is unix:PATH, [HOST:]PORT or [IPV6]:PORT; HOST defaults to localhost
+inline int export_open(const char *addr) {
+	struct addrinfo hints,*res,*r;
+	char host[256];
+	const char *port;
+	int err,one=1;
+
+	if (!strncmp(addr,"unix:",5)) {
+		struct sockaddr_un sa;
+		struct stat st;
+
+		memset(&sa,0,sizeof sa);
+		sa.sun_family=AF_UNIX;
+		if (strlen(addr+5)>=sizeof sa.sun_path||!addr[5]) {
+			fprintf(stderr,"%s: invalid export socket path\n",addr);
+			return -1;
+		}
+		strcpy(sa.sun_path,addr+5);
+		// a stale socket from a previous run is replaced, anything else is not
+		if (!lstat(sa.sun_path,&st)&&S_ISSOCK(st.st_mode))
+			unlink(sa.sun_path);
+		exp_fd=socket(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0);
+		if (exp_fd==-1||bind(exp_fd,(struct sockaddr *)&sa,sizeof sa)||listen(exp_fd,16)) {
+			perror(addr);
+			if (exp_fd!=-1)
+				close(exp_fd);
+			exp_fd=-1;
+			return -1;
+		}
+		exp_path=strdup(sa.sun_path);
+		return 0;
+	}
+
+	port=strrchr(addr,':');
+	if (port) {
+		size_t hl=port-addr;
+
+		if (hl>=2&&addr[0]=='['&&addr[hl-1]==']') { // [::1]:9100
+			addr++;
+			hl-=2;
+		}
+		if (hl>=sizeof host) {
+			fprintf(stderr,"%s: invalid export address\n",addr);
+			return -1;
+		}
+		memcpy(host,addr,hl);
+		host[hl]=0;
+		port++;
+	} else {
+		strcpy(host,"localhost");
+		port=addr;
+	}
+	memset(&hints,0,sizeof hints);
+	hints.ai_family=AF_UNSPEC;
+	hints.ai_socktype=SOCK_STREAM;
+	hints.ai_flags=AI_PASSIVE;
+	err=getaddrinfo(*host?host:NULL,port,&hints,&res);
+	if (err) {
+		fprintf(stderr,"%s: %s\n",addr,gai_strerror(err));
+		return -1;
+	}
+	for (r=res;r;r=r->ai_next) {
+		exp_fd=socket(r->ai_family,r->ai_socktype|SOCK_CLOEXEC,r->ai_protocol);
+		if (exp_fd==-1)
+			continue;
+		setsockopt(exp_fd,SOL_SOCKET,SO_REUSEADDR,&one,sizeof one);
+		if (!bind(exp_fd,r->ai_addr,r->ai_addrlen)&&!listen(exp_fd,16))
+			break;
+		err=errno;
+		close(exp_fd);
+		exp_fd=-1;
+	}
+	freeaddrinfo(res);
+	if (exp_fd==-1) {
+		fprintf(stderr,"%s: %s\n",addr,strerror(err?err:EADDRNOTAVAIL));
+		return -1;
+	}
+	return 0;
+}
+
+inline void view_export_init(void) {
+	if (!collector->has_delays)
+		fprintf(stderr,"Warning: %s collector does not provide SWAPIN and IO\n",collector->name);
+	else if (!replaying()&&!read_task_delayacct())
+		fprintf(stderr,"Warning: task_delayacct is 0, enable by: echo 1 > /proc/sys/kernel/task_delayacct\n");
+}
+
+inline void view_export_fini(void) {
+	int i;
+
+	if (exp_fd!=-1)
+		close(exp_fd);
+	exp_fd=-1;
+	if (exp_path) {
+		unlink(exp_path);
+		free(exp_path);
+		exp_path=NULL;
+	}
+	if (exp_buf)
+		free(exp_buf);
+	exp_buf=NULL;
+	for (i=0;i<eu_len;i++)
+		free(eu[i].name);
+	if (eu)
+		free(eu);
+	eu=NULL;
+	eu_len=eu_size=0;
+	free(ea);
+	ea=NULL;
+	ea_sz=0;
+}
+
+inline void view_export_loop(void) {
+	struct xxxid_stats_arr *ps=NULL;
+	struct xxxid_stats_arr *cs=NULL;
+	struct pollfd pfd;
+	uint64_t ts_o=0;
+
+	pfd.fd=exp_fd;
+	pfd.events=POLLIN;
+	for (;;) {
+		uint64_t pgin=0,pgou=0;
+		uint64_t ts;
+		int64_t next;
+
+		if (replaying()&&replay_eof())
+			break;
+		cs=fetch_data(fetch_params(),filter1,ps);
+		if (!cs)
+			break;
+		get_vm_counters(&pgin,&pgou);
+		ts=replaying()?replay_time():(uint64_t)monotime();
+		if (params.record_file||params.ring_file)
+			record_frame(cs,pgin,pgou,ts);
+		exp_collect(cs,ps,pgin,pgou);
+		if (trigger_count()) { // the rules need the values of the interval
+			create_diff(fetch_params(),cs,ps,timediff_in_s(ts_o,ts),ts,NULL,0,NULL);
+			trigger_check(cs,ps,ts);
+		}
+		ts_o=ts;
+
+		if (ps)
+			arr_free(ps);
+		ps=cs;
+
+		if ((params.iter>-1)&&((--params.iter)==0))
+			break;
+
+		// scrapes are served from the rendered buffer until the next collection
+		next=monotime()+(int64_t)(replaying()?replay_period():trigger_period());
+		for (;;) {
+			int64_t now=monotime();
+
+			if (now>=next)
+				break;
+			if (poll(&pfd,1,next-now)>0&&(pfd.revents&POLLIN))
+				exp_serve();
+		}
+	}
+	arr_free(cs);
+}
@@ -63,6 +63,22 @@ inline void calc_a_total(struct act_stats *act,double *read,double *write,double
 	}
 }
 
+// the memory pressure line of the device panel
+inline void vm_pressure_line(char *buf,size_t len,const struct vm_pressure *p) {
+	double si=p->swapin,so=p->swapout;
+	double di=p->dirty,wb=p->writeback;
+	char str_si[4],str_so[4];
+	char str_di[4],str_wb[4];
+
+	humanize_val(&si,str_si,0);
+	humanize_val(&so,str_so,0);
+	humanize_val(&di,str_di,0);
+	humanize_val(&wb,str_wb,0);
+	str_di[1]=0; // sizes, not rates
+	str_wb[1]=0;
+	snprintf(buf,len,VMSTAT_FORMAT,si,str_si,so,str_so,p->majfault,di,str_di,wb,str_wb);
+}
+
 inline int value2scale(double val,double mx) {
 	val=100.0*val/mx;
 
@@ -77,16 +93,26 @@ inline int value2scale(double val,double mx) {
 	return 0;
 }
 
-inline int create_diff(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,double time_s,uint64_t ts_c,filter_callback_w cb,int width,int *cnt) {
+inline int create_diff(const struct fetch_ctx *f,struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,double time_s,uint64_t ts_c,filter_callback_w cb,int width,int *cnt) {
+	uint64_t t=prof_start();
 	int n=0;
 
 	if (cnt)
 		*cnt=0;
+	// the tasks left after the idle ones, for trigger_check; without the
+	// list it falls back to all tasks
+	cs->act_len=0;
+	if (cs->act_size<cs->length) {
+		free(cs->act);
+		cs->act=malloc(cs->length*sizeof *cs->act);
+		cs->act_size=cs->act?cs->length:0;
+	}
 	for (n=0;cs->arr&&n<cs->length;n++) {
 		struct xxxid_stats *c;
 		struct xxxid_stats *p;
-		double rv,wv;
+		double rv,wv,nv,cv,tt;
 		char temp[12];
+		int i;
 
 		c=cs->arr[n];
 		p=arr_find(ps,c->tid);
@@ -100,6 +126,15 @@ inline int create_diff(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,dou
 			c->write_val_acc=0;
 			c->read_val_abw=0;
 			c->write_val_abw=0;
+			c->nwrite_val=0;
+			c->cwrite_val=0;
+			c->nwrite_val_acc=0;
+			c->nwrite_val_abw=0;
+			memset(c->delay_val,0,sizeof c->delay_val);
+			c->psi_val=0;
+			memset(c->lio_val,0,sizeof c->lio_val);
+			memset(c->lio_acc,0,sizeof c->lio_acc);
+			memset(c->lio_abw,0,sizeof c->lio_abw);
 			c->ts_s=ts_c; // keep start ts
 			c->ts_e=ts_c; // keep end ts
 
@@ -110,26 +145,66 @@ inline int create_diff(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,dou
 		c->ts_s=p->ts_s; // update end ts
 		c->ts_e=ts_c; // update end ts
 
+		// with --sampling the task may have been queried cycles ago
+		tt=time_s;
+		if (f->sampling&&p->ts_smp&&c->ts_smp!=p->ts_smp)
+			tt=timediff_in_s(p->ts_smp,c->ts_smp);
+		if (c->read_bytes==p->read_bytes&&c->write_bytes==p->write_bytes&&c->blkio_delay_total==p->blkio_delay_total&&c->swapin_delay_total==p->swapin_delay_total)
+			c->idle=p->idle+1;
+		else
+			c->idle=0;
+		if (!c->idle&&!c->exited&&cs->act)
+			cs->act[cs->act_len++]=c;
+
 		// round robin value
-		c->blkio_val=(double)rrv(c->blkio_delay_total,p->blkio_delay_total)/(time_s*10000000.0);
+		c->blkio_val=(double)rrv(c->blkio_delay_total,p->blkio_delay_total)/(tt*10000000.0);
 		if (c->blkio_val>100)
 			c->blkio_val=100;
 
-		c->swapin_val=(double)rrv(c->swapin_delay_total,p->swapin_delay_total)/(time_s*10000000.0);
+		c->swapin_val=(double)rrv(c->swapin_delay_total,p->swapin_delay_total)/(tt*10000000.0);
 		if (c->swapin_val>100)
 			c->swapin_val=100;
 
 		rv=(double)rrv(c->read_bytes,p->read_bytes);
 		wv=(double)rrv(c->write_bytes,p->write_bytes);
+		// writes of dirty pages truncated before writeback never reach the disk
+		cv=(double)rrv(c->cancelled_write_bytes,p->cancelled_write_bytes);
+		nv=wv-cv;
+		if (nv<0)
+			nv=0;
 
-		c->read_val=rv/time_s;
-		c->write_val=wv/time_s;
+		c->read_val=rv/tt;
+		c->write_val=wv/tt;
+		c->nwrite_val=nv/tt;
+		c->cwrite_val=cv/tt;
 
 		c->read_val_acc=p->read_val_acc+rv;
 		c->write_val_acc=p->write_val_acc+wv;
+		c->nwrite_val_acc=p->nwrite_val_acc+nv;
 
 		c->read_val_abw=c->read_val_acc/timediff_in_s(c->ts_s,c->ts_e);
 		c->write_val_abw=c->write_val_acc/timediff_in_s(c->ts_s,c->ts_e);
+		c->nwrite_val_abw=c->nwrite_val_acc/timediff_in_s(c->ts_s,c->ts_e);
+
+		for (i=0;i<DLY_MAX;i++) {
+			c->delay_val[i]=(double)rrv(c->delay_total[i],p->delay_total[i])/(tt*10000000.0);
+			if (c->delay_val[i]>100)
+				c->delay_val[i]=100;
+			memcpy(c->dlyhist[i]+1,p->dlyhist[i],sizeof c->dlyhist[i]-sizeof *c->dlyhist[i]);
+			c->dlyhist[i][0]=value2scale(c->delay_val[i],100.0);
+		}
+
+		c->psi_val=p->psi_total?(double)rrv(c->psi_total,p->psi_total)/(tt*10000.0):0; // us over s in percent
+		if (c->psi_val>100)
+			c->psi_val=100;
+
+		for (i=0;i<LIO_MAX;i++) {
+			double lv=(double)rrv(lio_counter(c,i),lio_counter(p,i));
+
+			c->lio_val[i]=lv/tt;
+			c->lio_acc[i]=p->lio_acc[i]+lv;
+			c->lio_abw[i]=c->lio_acc[i]/timediff_in_s(c->ts_s,c->ts_e);
+		}
 
 		memcpy(c->iohist+1,p->iohist,sizeof c->iohist-sizeof *c->iohist);
 		c->iohist[0]=value2scale(c->blkio_val,100.0);
@@ -139,7 +214,13 @@ inline int create_diff(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,dou
 		c->readhist[0]=rv;
 		memcpy(c->writehist+1,p->writehist,sizeof c->writehist-sizeof *c->writehist);
 		c->writehist[0]=wv;
+		memcpy(c->netwhist+1,p->netwhist,sizeof c->netwhist-sizeof *c->netwhist);
+		c->netwhist[0]=nv;
 
+		// the aggregate holds the threads queried in this cycle, so its
+		// interval is the cycle even when the main thread itself is sampled;
+		// a thread queried again after k cycles adds its k cycles of I/O at
+		// once, the spike is documented under --sampling in iotop.8
 		if (c->pid==c->tid) {
 			c->blkio_val_p=(double)rrv(c->blkio_delay_total_p,p->blkio_delay_total_p)/(time_s*10000000.0);
 			if (c->blkio_val_p>100)
@@ -151,15 +232,39 @@ inline int create_diff(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,dou
 
 			rv=(double)rrv(c->read_bytes_p,p->read_bytes_p);
 			wv=(double)rrv(c->write_bytes_p,p->write_bytes_p);
+			cv=(double)rrv(c->cancelled_write_bytes_p,p->cancelled_write_bytes_p);
+			nv=wv-cv;
+			if (nv<0)
+				nv=0;
 
 			c->read_val_p=rv/time_s;
 			c->write_val_p=wv/time_s;
+			c->nwrite_val_p=nv/time_s;
+			c->cwrite_val_p=cv/time_s;
 
 			c->read_val_acc_p=p->read_val_acc_p+rv;
 			c->write_val_acc_p=p->write_val_acc_p+wv;
+			c->nwrite_val_acc_p=p->nwrite_val_acc_p+nv;
 
 			c->read_val_abw_p=c->read_val_acc_p/timediff_in_s(c->ts_s,c->ts_e);
 			c->write_val_abw_p=c->write_val_acc_p/timediff_in_s(c->ts_s,c->ts_e);
+			c->nwrite_val_abw_p=c->nwrite_val_acc_p/timediff_in_s(c->ts_s,c->ts_e);
+
+			for (i=0;i<DLY_MAX;i++) {
+				c->delay_val_p[i]=(double)rrv(c->delay_total_p[i],p->delay_total_p[i])/(time_s*10000000.0);
+				if (c->delay_val_p[i]>100)
+					c->delay_val_p[i]=100;
+				memcpy(c->dlyhist_p[i]+1,p->dlyhist_p[i],sizeof c->dlyhist_p[i]-sizeof *c->dlyhist_p[i]);
+				c->dlyhist_p[i][0]=value2scale(c->delay_val_p[i],100.0);
+			}
+
+			for (i=0;i<LIO_MAX;i++) {
+				double lv=(double)rrv(c->lio_p[i],p->lio_p[i]);
+
+				c->lio_val_p[i]=lv/time_s;
+				c->lio_acc_p[i]=p->lio_acc_p[i]+lv;
+				c->lio_abw_p[i]=c->lio_acc_p[i]/timediff_in_s(c->ts_s,c->ts_e);
+			}
 
 			memcpy(c->iohist_p+1,p->iohist_p,sizeof c->iohist_p-sizeof *c->iohist_p);
 			c->iohist_p[0]=value2scale(c->blkio_val_p,100.0);
@@ -169,6 +274,30 @@ inline int create_diff(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,dou
 			c->readhist_p[0]=rv;
 			memcpy(c->writehist_p+1,p->writehist_p,sizeof c->writehist_p-sizeof *c->writehist_p);
 			c->writehist_p[0]=wv;
+			memcpy(c->netwhist_p+1,p->netwhist_p,sizeof c->netwhist_p-sizeof *c->netwhist_p);
+			c->netwhist_p[0]=nv;
+		}
+
+		// the histograms move on with the task, p loses them; a redraw of
+		// the same data does not count the interval again
+		if (!c->hist) {
+			c->hist=p->hist;
+			p->hist=NULL;
+		}
+		if (!c->hist_p) {
+			c->hist_p=p->hist_p;
+			p->hist_p=NULL;
+		}
+		if (f->pctl&&!c->hist_in) {
+			if (!c->stale) // a task not queried in this cycle has no interval of its own
+				histo_add(&c->hist,c->read_val,c->write_val,c->blkio_val);
+			if (c->pid==c->tid)
+				histo_add(&c->hist_p,c->read_val_p,c->write_val_p,c->blkio_val_p);
+		}
+		c->hist_in=1;
+		for (i=0;f->pctl&&i<HG_MAX;i++) {
+			c->pctl_val[i]=histo_pct(c->hist,i,f->pctl);
+			c->pctl_val_p[i]=histo_pct(c->hist_p,i,f->pctl);
 		}
 
 		snprintf(temp,sizeof temp,"%i",c->tid);
@@ -177,20 +306,28 @@ inline int create_diff(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,dou
 	for (n=0;ps&&ps->arr&&n<ps->length;n++) { // copy old data for exited processes
 		if (ps->arr[n]->exited||!arr_find(cs,ps->arr[n]->tid)) {
 			struct xxxid_stats *p;
+			int i;
 
-			ps->arr[n]->exited++;
-			if (ps->arr[n]->exited>HISTORY_CNT)
+			// ps may be still in use (libiotop snapshots), its values are
+			// left as they are; only hist and hist_p move over to cs
+			if (ps->arr[n]->exited+1>HISTORY_CNT)
 				continue;
-			// last state is zero, only history remains
-			ps->arr[n]->blkio_val=0;
-			ps->arr[n]->swapin_val=0;
-			ps->arr[n]->read_val=0;
-			ps->arr[n]->write_val=0;
 			// copy process data to cs
 			p=malloc(sizeof *p);
 			if (p) {
 				*p=*ps->arr[n]; // WARNING - all dynamic data inside should always be initialized below
 				p->threads=NULL;
+				p->hist_in=1; // exited tasks add no intervals, hist and hist_p are taken over below
+				p->exited++;
+				// last state is zero, only history remains
+				p->blkio_val=0;
+				p->swapin_val=0;
+				p->read_val=0;
+				p->write_val=0;
+				p->nwrite_val=0;
+				p->cwrite_val=0;
+				memset(p->delay_val,0,sizeof p->delay_val);
+				memset(p->lio_val,0,sizeof p->lio_val);
 				// copy dynamic data to avoid double free; in the unlikely event when strdup fails, filter1 will skip this item
 				if (p->cmdline_short)
 					p->cmdline_short=strdup(ps->arr[n]->cmdline_short);
@@ -209,6 +346,12 @@ inline int create_diff(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,dou
 				p->readhist[0]=0.0;
 				memmove(p->writehist+1,p->writehist,sizeof p->writehist-sizeof *p->writehist);
 				p->writehist[0]=0.0;
+				memmove(p->netwhist+1,p->netwhist,sizeof p->netwhist-sizeof *p->netwhist);
+				p->netwhist[0]=0.0;
+				for (i=0;i<DLY_MAX;i++) {
+					memmove(p->dlyhist[i]+1,p->dlyhist[i],sizeof p->dlyhist[i]-sizeof *p->dlyhist[i]);
+					p->dlyhist[i][0]=0;
+				}
 				if (p->tid==p->pid) { // shift process aggregated data, only for main process
 					memmove(p->iohist_p+1,p->iohist_p,sizeof p->iohist_p-sizeof *p->iohist_p);
 					p->iohist_p[0]=0;
@@ -218,6 +361,12 @@ inline int create_diff(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,dou
 					p->readhist_p[0]=0.0;
 					memmove(p->writehist_p+1,p->writehist_p,sizeof p->writehist_p-sizeof *p->writehist_p);
 					p->writehist_p[0]=0.0;
+					memmove(p->netwhist_p+1,p->netwhist_p,sizeof p->netwhist_p-sizeof *p->netwhist_p);
+					p->netwhist_p[0]=0.0;
+					for (i=0;i<DLY_MAX;i++) {
+						memmove(p->dlyhist_p[i]+1,p->dlyhist_p[i],sizeof p->dlyhist_p[i]-sizeof *p->dlyhist_p[i]);
+						p->dlyhist_p[i][0]=0;
+					}
 				}
 				if (arr_add(cs,p)) { // free the data in case add fails
 					if (p->cmdline_short)
@@ -229,7 +378,8 @@ inline int create_diff(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,dou
 					if (p->pw_name)
 						free(p->pw_name);
 					free(p);
-				}
+				} else
+					ps->arr[n]->hist=ps->arr[n]->hist_p=NULL;
 			}
 		}
 	}
@@ -250,11 +400,17 @@ inline int create_diff(struct xxxid_stats_arr *cs,struct xxxid_stats_arr *ps,dou
 				continue;
 			arr_add(p->threads,c);
 		}
-		if (cb&&!cb(c,width))
-			if (cnt)
+		if (cb) {
+			uint64_t t=prof_start();
+			int skip=cb(c,width);
+
+			prof_end(PROF_FILTER,t);
+			if (!skip&&cnt)
 				(*cnt)++;
+		}
 	}
 
+	prof_end(PROF_DIFF,t);
 	return cs->length;
 }
 
@@ -278,145 +434,90 @@ inline void humanize_val(double *value,char *str,int allow_accum) {
 	snprintf(str,4,"%c%s",u[p],config.f.accumulated&&allow_accum?"  ":"/s");
 }
 
-inline int iotop_sort_cb(const void *a,const void *b) {
-	int order=config.f.sort_order?1:-1; // SORT_ASC is bit 0=1, else should reverse sort
-	struct xxxid_stats **ppa=(struct xxxid_stats **)a;
-	struct xxxid_stats **ppb=(struct xxxid_stats **)b;
-	struct xxxid_stats *pa,*pb;
-	static int grlen=0;
-	int res=0;
+// same as humanize_val for counts, always with SI units
+inline void humanize_cnt(double *value,char *str,int allow_accum) {
+	const char *u=" kMGTPEZY";
+	size_t p=0;
 
-	if (!a) {
-		grlen=(long)b;
-		return 0;
+	while (*value>1000.0*config.f.threshold) {
+		if (p+1<strlen(u)) {
+			*value/=1000.0;
+			p++;
+		} else
+			break;
 	}
 
-	pa=*ppa;
-	pb=*ppb;
+	snprintf(str,4,"%c%s",u[p],config.f.accumulated&&allow_accum?"  ":"/s");
+}
 
-	switch (masked_sort_by(0)) {
-		case SORT_BY_GRAPH: {
-			double da=0,db=0;
-			int aa=0,ab=0;
-			int i;
+// logical I/O value according to the accumulated and processes settings
+inline double lio_value(const struct xxxid_stats *s,int i) {
+	if (config.f.accumbw)
+		return config.f.processes?s->lio_abw_p[i]:s->lio_abw[i];
+	if (config.f.accumulated)
+		return config.f.processes?s->lio_acc_p[i]:s->lio_acc[i];
+	return config.f.processes?s->lio_val_p[i]:s->lio_val[i];
+}
 
-			switch (masked_grtype(0)) {
-				case E_GR_IO:
-					if (grlen==0)
-						grlen=HISTORY_CNT;
-					for (i=0;i<grlen;i++) {
-						aa+=config.f.processes?pa->iohist_p[i]:pa->iohist[i];
-						ab+=config.f.processes?pb->iohist_p[i]:pb->iohist[i];
-					}
-					res=aa-ab;
-					break;
-				case E_GR_R:
-					if (grlen==0)
-						grlen=HISTORY_CNT;
-					for (i=0;i<grlen;i++) {
-						da+=config.f.processes?pa->readhist_p[i]:pa->readhist[i];
-						db+=config.f.processes?pb->readhist_p[i]:pb->readhist[i];
-					}
-					if (da>db)
-						res=1;
-					else if (da<db)
-						res=-1;
-					else
-						res=0;
-					break;
-				case E_GR_W:
-					if (grlen==0)
-						grlen=HISTORY_CNT;
-					for (i=0;i<grlen;i++) {
-						da+=config.f.processes?pa->writehist_p[i]:pa->writehist[i];
-						db+=config.f.processes?pb->writehist_p[i]:pb->writehist[i];
-					}
-					if (da>db)
-						res=1;
-					else if (da<db)
-						res=-1;
-					else
-						res=0;
-					break;
-				case E_GR_RW:
-					if (grlen==0)
-						grlen=HISTORY_CNT;
-					for (i=0;i<grlen;i++) {
-						da+=config.f.processes?pa->readhist_p[i]:pa->readhist[i];
-						db+=config.f.processes?pb->readhist_p[i]:pb->readhist[i];
-						da+=config.f.processes?pa->writehist_p[i]:pa->writehist[i];
-						db+=config.f.processes?pb->writehist_p[i]:pb->writehist[i];
-					}
-					if (da>db)
-						res=1;
-					else if (da<db)
-						res=-1;
-					else
-						res=0;
-					break;
-				case E_GR_SW:
-					if (grlen==0)
-						grlen=HISTORY_CNT;
-					for (i=0;i<grlen;i++) {
-						aa+=config.f.processes?pa->sihist_p[i]:pa->sihist[i];
-						ab+=config.f.processes?pb->sihist_p[i]:pb->sihist[i];
-					}
-					res=aa-ab;
-					break;
-			}
-			break;
-		}
-		case SORT_BY_PRIO:
-			res=pa->io_prio-pb->io_prio;
-			break;
-		case SORT_BY_COMMAND:
-			res=strcmp(config.f.fullcmdline?pa->cmdline_long:pa->cmdline_short,config.f.fullcmdline?pb->cmdline_long:pb->cmdline_short);
-			break;
+// the percentile of the intervals so far according to the processes setting
+inline double pctl_value(const struct xxxid_stats *s,int i) {
+	return config.f.processes?s->pctl_val_p[i]:s->pctl_val[i];
+}
+
+// hidepid..hidecmd are kept in the order of the first columns, NET WRITE
+// has its own flag and the delay, logical I/O and percentile columns are
+// shown or hidden in groups; IO PSI is only known for cgroup rows
+inline int column_hidden(int col) {
+	switch (col) {
 		case SORT_BY_TID:
-			res=pa->tid-pb->tid;
-			break;
+			return config.f.hidepid;
+		case SORT_BY_PRIO:
+			return config.f.hideprio;
 		case SORT_BY_USER:
-			res=strcmp(pa->pw_name,pb->pw_name);
-			break;
+			return config.f.hideuser;
 		case SORT_BY_READ:
-			if (config.f.accumbw)
-				res=(config.f.processes?pa->read_val_abw_p:pa->read_val_abw)>(config.f.processes?pb->read_val_abw_p:pb->read_val_abw)?1:
-					(config.f.processes?pa->read_val_abw_p:pa->read_val_abw)<(config.f.processes?pb->read_val_abw_p:pb->read_val_abw)?-1:0;
-			else if (config.f.accumulated)
-				res=(config.f.processes?pa->read_val_acc_p:pa->read_val_acc)>(config.f.processes?pb->read_val_acc_p:pb->read_val_acc)?1:
-					(config.f.processes?pa->read_val_acc_p:pa->read_val_acc)<(config.f.processes?pb->read_val_acc_p:pb->read_val_acc)?-1:0;
-			else
-				res=(config.f.processes?pa->read_val_p:pa->read_val)>(config.f.processes?pb->read_val_p:pb->read_val)?1:
-					(config.f.processes?pa->read_val_p:pa->read_val)<(config.f.processes?pb->read_val_p:pb->read_val)?-1:0;
-			break;
+			return config.f.hideread;
 		case SORT_BY_WRITE:
-			if (config.f.accumbw)
-				res=(config.f.processes?pa->write_val_abw_p:pa->write_val_abw)>(config.f.processes?pb->write_val_abw_p:pb->write_val_abw)?1:
-					(config.f.processes?pa->write_val_abw_p:pa->write_val_abw)<(config.f.processes?pb->write_val_abw_p:pb->write_val_abw)?-1:0;
-			else if (config.f.accumulated)
-				res=(config.f.processes?pa->write_val_acc_p:pa->write_val_acc)>(config.f.processes?pb->write_val_acc_p:pb->write_val_acc)?1:
-					(config.f.processes?pa->write_val_acc_p:pa->write_val_acc)<(config.f.processes?pb->write_val_acc_p:pb->write_val_acc)?-1:0;
-			else
-				res=(config.f.processes?pa->write_val_p:pa->write_val)>(config.f.processes?pb->write_val_p:pb->write_val)?1:
-					(config.f.processes?pa->write_val_p:pa->write_val)<(config.f.processes?pb->write_val_p:pb->write_val)?-1:0;
-			break;
+			return config.f.hidewrite;
+		case SORT_BY_NWRITE:
+			return !config.f.netwrite;
 		case SORT_BY_SWAPIN:
-			res=(config.f.processes?pa->swapin_val_p:pa->swapin_val)>(config.f.processes?pb->swapin_val_p:pb->swapin_val)?1:
-				(config.f.processes?pa->swapin_val_p:pa->swapin_val)<(config.f.processes?pb->swapin_val_p:pb->swapin_val)?-1:0;
-			break;
+			return config.f.hideswapin;
 		case SORT_BY_IO:
-			res=(config.f.processes?pa->blkio_val_p:pa->blkio_val)>(config.f.processes?pb->blkio_val_p:pb->blkio_val)?1:
-				(config.f.processes?pa->blkio_val_p:pa->blkio_val)<(config.f.processes?pb->blkio_val_p:pb->blkio_val)?-1:0;
-			break;
+			return config.f.hideio;
+		case SORT_BY_DCPU:
+		case SORT_BY_DMEM:
+		case SORT_BY_DTHRASH:
+		case SORT_BY_DCOMPACT:
+		case SORT_BY_DWPCOPY:
+		case SORT_BY_DIRQ:
+			return !config.f.delays;
+		case SORT_BY_LREAD:
+		case SORT_BY_LWRITE:
+		case SORT_BY_SYSCR:
+		case SORT_BY_SYSCW:
+			return !config.f.logical;
+		case SORT_BY_PSI:
+			return !config.f.psi||params.group!=E_GRP_CGROUP;
+		case SORT_BY_PREAD:
+		case SORT_BY_PWRITE:
+		case SORT_BY_PIO:
+			return !config.f.pctl;
+		case SORT_BY_GRAPH:
+			return config.f.hidegraph;
+		case SORT_BY_COMMAND:
+			return config.f.hidecmd;
 	}
-	res*=order;
-	return res;
+	return 1;
 }
 
 inline int filter1(struct xxxid_stats *s) {
 	if (!s->cmdline_long||!s->cmdline_short) // if strdup fails during copy, those may become NULL
 		return 1;
 
+	if (s->group) // the tasks of group rows are already filtered
+		return 0;
+
 	if ((params.user_id!=-1)&&(s->euid!=params.user_id))
 		return 1;
 
@@ -18,78 +18,150 @@ You should have received a copy of the GNU General Public License along with thi
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/stat.h>
-#include <sys/types.h>
 
 #define BSIZ 4096
-#define PGIN "\npgpgin "
-#define PGOU "\npgpgout "
 
-inline int get_vm_counters(uint64_t *pgpgin,uint64_t *pgpgou) {
-	ssize_t bs=BSIZ,bp=0;
-	char *buf,*pi,*po,*t;
-	int fd;
+// the extracted counters and their scale to bytes (0 for plain counts, -1 for
+// pages); the table is scanned for each line of /proc/vmstat
+static const struct {
+	const char *name;
+	size_t len;
+	int scale;
+} vm_name[VM_MAX]={
+	[VM_PGPGIN]={"pgpgin",6,1024},
+	[VM_PGPGOUT]={"pgpgout",7,1024},
+	[VM_PSWPIN]={"pswpin",6,-1},
+	[VM_PSWPOUT]={"pswpout",7,-1},
+	[VM_PGMAJFAULT]={"pgmajfault",10,0},
+	[VM_DIRTY]={"nr_dirty",8,-1},
+	[VM_WRITEBACK]={"nr_writeback",12,-1},
+};
 
-	if (!pgpgin||!pgpgou)
-		return EINVAL;
+static int vm_fd=-1; // kept open, reread from the start on each call
+static char *vm_buf=NULL; // grown until the whole file fits, then reused
+static ssize_t vm_bs=0;
+static uint64_t vm_last[VM_MAX]; // values of the last get_vm_stats
+static int vm_have_last=0;
+static struct vm_pressure vm_p;
+static uint64_t vm_p_o[VM_MAX]; // values of the last vm_pressure_update
+static int64_t vm_p_ts=0;
+static int vm_p_ok=0;
 
-	if (-1==(fd=open("/proc/vmstat",O_RDONLY)))
-		return ENOENT;
+static inline double vm_delta(uint64_t c,uint64_t p) {
+	return c>=p?c-p:0;
+}
 
-	buf=malloc(bs);
-	if (!buf) {
-		close(fd);
-		return ENOMEM;
-	}
+inline int get_vm_stats(uint64_t *v) {
+	long pgsz=sysconf(_SC_PAGESIZE);
+	unsigned found=0;
+	ssize_t bp;
+	char *l,*e;
+	int i;
 
-	for (;;) {
-		ssize_t l=read(fd,buf+bp,bs-bp);
+	if (vm_fd==-1)
+		vm_fd=open("/proc/vmstat",O_RDONLY|O_CLOEXEC);
+	if (vm_fd==-1)
+		return ENOENT;
+	for (bp=0;;) {
+		ssize_t r;
 
-		if (l<=0)
-			break;
-		if (l==bs-bp) {
-			t=realloc(buf,bs+BSIZ);
-
-			if (!t) {
-				// it requires hell of an effort to silence a bogus warning...
-				#pragma GCC diagnostic push
-				// silence gcc about unknown -Wunknown-warning-option
-				#pragma GCC diagnostic ignored "-Wpragmas"
-				// silence clang about unknown -Wuse-after-free
-				#pragma GCC diagnostic ignored "-Wunknown-warning-option"
-				// silence the warning itself
-				#pragma GCC diagnostic ignored "-Wuse-after-free"
-				free(buf); // gcc-13 yields false positive -Wuse-after-free here
-				#pragma GCC diagnostic pop
-				close(fd);
+		if (bp==vm_bs) {
+			l=realloc(vm_buf,vm_bs+BSIZ+1);
+			if (!l)
 				return ENOMEM;
-			}
-			buf=t;
-			bs+=BSIZ;
+			vm_buf=l;
+			vm_bs+=BSIZ;
 		}
-		bp+=l;
+		r=pread(vm_fd,vm_buf+bp,vm_bs-bp,bp);
+		if (r<0)
+			return ENOENT;
+		if (!r)
+			break;
+		bp+=r;
 	}
-	buf[bp]=0;
-	pi=strstr(buf,PGIN);
-	po=strstr(buf,PGOU);
-	if (!pi||!po) {
-		free(buf);
-		close(fd);
-		return ENOENT;
+	vm_buf[bp]=0;
+
+	for (l=vm_buf;*l;l=e) {
+		e=strchr(l,'\n');
+		if (e)
+			e++;
+		else
+			e=l+strlen(l);
+		for (i=0;i<VM_MAX;i++)
+			if (!(found&(1U<<i))&&!strncmp(l,vm_name[i].name,vm_name[i].len)&&l[vm_name[i].len]==' ') {
+				v[i]=strtoull(l+vm_name[i].len+1,NULL,10);
+				if (vm_name[i].scale>0)
+					v[i]*=vm_name[i].scale;
+				if (vm_name[i].scale<0)
+					v[i]*=pgsz>0?pgsz:4096;
+				found|=1U<<i;
+				break;
+			}
 	}
-	*pgpgin=1024*strtoull(pi+strlen(PGIN),&t,10);
-	if (*t!='\n') {
-		free(buf);
-		close(fd);
+	if ((found&((1U<<VM_PGPGIN)|(1U<<VM_PGPGOUT)))!=((1U<<VM_PGPGIN)|(1U<<VM_PGPGOUT)))
 		return ENOENT;
+	for (i=0;i<VM_MAX;i++)
+		if (!(found&(1U<<i)))
+			v[i]=0;
+	memcpy(vm_last,v,sizeof vm_last);
+	vm_have_last=1;
+	return 0;
+}
+
+inline int get_vm_counters(uint64_t *pgpgin,uint64_t *pgpgou) {
+	uint64_t v[VM_MAX];
+	int rc;
+
+	if (!pgpgin||!pgpgou)
+		return EINVAL;
+
+	if (replaying())
+		return replay_vm_counters(pgpgin,pgpgou);
+	if (params.bench)
+		return synth_vm_counters(pgpgin,pgpgou);
+
+	rc=get_vm_stats(v);
+	if (rc)
+		return rc;
+	*pgpgin=v[VM_PGPGIN];
+	*pgpgou=v[VM_PGPGOUT];
+	return 0;
+}
+
+// the rates since the previous call from the values of the last
+// get_vm_stats, so /proc/vmstat is not read again for them
+inline void vm_pressure_update(void) {
+	int64_t now=monotime();
+	double time_s=timediff_in_s(vm_p_ts,now);
+
+	if (replaying()||!vm_have_last) { // not recorded
+		vm_p_ok=0;
+		return;
 	}
-	*pgpgou=1024*strtoull(po+strlen(PGOU),&t,10);
-	if (*t!='\n') {
-		free(buf);
-		close(fd);
-		return ENOENT;
+	if (vm_p_ts) {
+		vm_p.swapin=vm_delta(vm_last[VM_PSWPIN],vm_p_o[VM_PSWPIN])/time_s;
+		vm_p.swapout=vm_delta(vm_last[VM_PSWPOUT],vm_p_o[VM_PSWPOUT])/time_s;
+		vm_p.majfault=vm_delta(vm_last[VM_PGMAJFAULT],vm_p_o[VM_PGMAJFAULT])/time_s;
 	}
-	free(buf);
-	close(fd);
-	return 0;
+	vm_p.dirty=vm_last[VM_DIRTY];
+	vm_p.writeback=vm_last[VM_WRITEBACK];
+	memcpy(vm_p_o,vm_last,sizeof vm_p_o);
+	vm_p_ts=now;
+	vm_p_ok=1;
+}
+
+inline const struct vm_pressure *vm_pressure_get(void) {
+	return vm_p_ok?&vm_p:NULL;
+}
+
+inline void vmstat_fini(void) {
+	if (vm_fd!=-1)
+		close(vm_fd);
+	vm_fd=-1;
+	free(vm_buf);
+	vm_buf=NULL;
+	vm_bs=0;
+	vm_have_last=0;
+	vm_p_ok=0;
+	vm_p_ts=0;
 }
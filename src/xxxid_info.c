@@ -51,6 +51,10 @@ struct msgtemplate {
 
 static int nl_sock=-1;
 static int nl_fam_id=0;
+static unsigned nl_ts_ver=0; // struct taskstats version of the last reply
+
+// struct taskstats version that introduced each DLY_* field
+static const unsigned dly_minver[DLY_MAX]={1,7,9,11,13,14};
 
 inline int send_cmd(int sock_fd,__u16 nlmsg_type,__u32 nlmsg_pid,__u8 genl_cmd,__u16 nla_type,void *nla_data,int nla_len) {
 	struct nlattr *na;
@@ -117,9 +121,11 @@ inline int get_family_id(int sock_fd) {
 	return id;
 }
 
-inline void nl_init(void) {
+static const char *nl_err=NULL; // reason for nl_init failure
+
+inline int nl_init(void) {
 	struct sockaddr_nl addr;
-	int sock_fd=socket(PF_NETLINK,SOCK_RAW,NETLINK_GENERIC);
+	int sock_fd=socket(PF_NETLINK,SOCK_RAW|SOCK_CLOEXEC,NETLINK_GENERIC);
 
 	if (sock_fd<0)
 		goto error;
@@ -130,21 +136,21 @@ inline void nl_init(void) {
 	if (bind(sock_fd,(struct sockaddr *)&addr,sizeof addr)<0)
 		goto error;
 
-	nl_sock=sock_fd;
 	nl_fam_id=get_family_id(sock_fd);
 	if (!nl_fam_id) {
-		fprintf(stderr,"nl_init: couldn't get netlink family id\n");
-		exit(EXIT_FAILURE);
+		close(sock_fd);
+		nl_err="couldn't get netlink family id";
+		return -1;
 	}
+	nl_sock=sock_fd;
 
-	return;
+	return 0;
 
 error:
+	nl_err=strerror(errno);
 	if (sock_fd>-1)
 		close(sock_fd);
-
-	fprintf(stderr,"nl_init: %s\n",strerror(errno));
-	exit(EXIT_FAILURE);
+	return -1;
 }
 
 inline int nl_xxxid_info(pid_t tid,pid_t pid,struct xxxid_stats *stats) {
@@ -208,16 +214,47 @@ inline int nl_xxxid_info(pid_t tid,pid_t pid,struct xxxid_stats *stats) {
 					else if (ts->version!=15) { // use v14 for v4..v14 & v16 onwards
 						stats->read_bytes=t14->read_bytes;
 						stats->write_bytes=t14->write_bytes;
+						stats->read_char=t14->read_char;
+						stats->write_char=t14->write_char;
+						stats->read_syscalls=t14->read_syscalls;
+						stats->write_syscalls=t14->write_syscalls;
+						stats->cancelled_write_bytes=t14->cancelled_write_bytes;
+						stats->delay_total[DLY_CPU]=t14->cpu_delay_total;
+						stats->delay_total[DLY_MEM]=t14->freepages_delay_total;
+						stats->delay_total[DLY_THRASH]=t14->thrashing_delay_total;
+						stats->delay_total[DLY_COMPACT]=t14->compact_delay_total;
+						stats->delay_total[DLY_WPCOPY]=t14->wpcopy_delay_total;
+						stats->delay_total[DLY_IRQ]=t14->irq_delay_total;
 						stats->swapin_delay_total=t14->swapin_delay_total;
 						stats->blkio_delay_total=t14->blkio_delay_total;
 						stats->euid=t14->ac_uid;
 					} else { // exception for v15 only
 						stats->read_bytes=t15->read_bytes;
 						stats->write_bytes=t15->write_bytes;
+						stats->read_char=t15->read_char;
+						stats->write_char=t15->write_char;
+						stats->read_syscalls=t15->read_syscalls;
+						stats->write_syscalls=t15->write_syscalls;
+						stats->cancelled_write_bytes=t15->cancelled_write_bytes;
+						stats->delay_total[DLY_CPU]=t15->cpu_delay_total;
+						stats->delay_total[DLY_MEM]=t15->freepages_delay_total;
+						stats->delay_total[DLY_THRASH]=t15->thrashing_delay_total;
+						stats->delay_total[DLY_COMPACT]=t15->compact_delay_total;
+						stats->delay_total[DLY_WPCOPY]=t15->wpcopy_delay_total;
+						stats->delay_total[DLY_IRQ]=t15->irq_delay_total;
 						stats->swapin_delay_total=t15->swapin_delay_total;
 						stats->blkio_delay_total=t15->blkio_delay_total;
 						stats->euid=t15->ac_uid;
 					}
+					if (ts->version>=IOTOP_TASKSTATS_MINVER) {
+						int i;
+
+						// fields past the end of an older struct are not there
+						for (i=0;i<DLY_MAX;i++)
+							if (ts->version<dly_minver[i])
+								stats->delay_total[i]=0;
+						nl_ts_ver=ts->version;
+					}
 				}
 				len2+=NLA_ALIGN(na->nla_len);
 				na=(struct nlattr *)((char *)na+len2);
@@ -232,6 +269,99 @@ inline int nl_xxxid_info(pid_t tid,pid_t pid,struct xxxid_stats *stats) {
 inline void nl_fini(void) {
 	if (nl_sock>-1)
 		close(nl_sock);
+	nl_sock=-1;
+}
+
+// taskstats rounds the syscall counts down to a multiple of 1024, the
+// netlink collector takes them from /proc/<pid>/task/<tid>/io when it can
+static int nl_procio=0;
+static int nl_ref=0; // libiotop contexts share the socket
+
+static inline int nl_col_init(void) {
+	if (nl_ref) {
+		nl_ref++;
+		return 0;
+	}
+	if (nl_init())
+		return -1;
+	nl_procio=!procio_init();
+	nl_ref=1;
+	return 0;
+}
+
+static inline void nl_col_fini(void) {
+	if (!nl_ref||--nl_ref)
+		return;
+	if (nl_procio)
+		procio_fini();
+	nl_procio=0;
+	nl_fini();
+}
+
+static inline void nl_col_cycle(void) {
+	if (nl_procio)
+		procio_cycle();
+}
+
+static struct fetch_ctx *fetch_cur=NULL; // the settings of the fetch_data in progress
+
+static inline int nl_col_info(pid_t tid,pid_t pid,struct xxxid_stats *stats) {
+	if (nl_xxxid_info(tid,pid,stats))
+		return -1;
+	if (nl_procio&&fetch_cur&&fetch_cur->syscalls) // keep the rounded counts if the file is not readable
+		procio_syscalls(tid,pid,stats);
+	return 0;
+}
+
+static const struct collector collectors[]={
+	[E_COL_NETLINK]={"netlink",nl_col_init,nl_col_fini,nl_col_cycle,nl_col_info,1},
+	[E_COL_PROCIO]={"procio",procio_init,procio_fini,procio_cycle,procio_xxxid_info,0},
+};
+
+const struct collector *collector=NULL;
+
+// a system collector, the caller closes it with its fini
+inline const struct collector *collector_open(e_collector c) {
+	switch (c) {
+		case E_COL_AUTO:
+			if (!collectors[E_COL_NETLINK].init())
+				return collectors+E_COL_NETLINK;
+			// fall through
+		case E_COL_PROCIO:
+			if (!procio_init())
+				return collectors+E_COL_PROCIO;
+			fprintf(stderr,"procio_init: /proc/<pid>/io is not available\n");
+			if (c==E_COL_AUTO&&nl_err)
+				fprintf(stderr,"nl_init: %s\n",nl_err);
+			break;
+		case E_COL_NETLINK:
+			if (!collectors[E_COL_NETLINK].init())
+				return collectors+E_COL_NETLINK;
+			fprintf(stderr,"nl_init: %s\n",nl_err);
+			break;
+	}
+	return NULL;
+}
+
+inline int collector_start(void) {
+	if (replaying())
+		collector=params.attach?attach_open(params.attach):replay_open(params.replay_file);
+	else if (params.bench)
+		collector=synth_open(params.bench);
+	else
+		collector=collector_open(params.collector);
+	return collector?0:-1;
+}
+
+inline void collector_init(void) {
+	if (collector_start())
+		exit(EXIT_FAILURE);
+}
+
+inline void collector_fini(void) {
+	if (collector)
+		collector->fini();
+	collector=NULL;
 }
 
 inline void free_stats(struct xxxid_stats *s) {
@@ -243,15 +373,18 @@ inline void free_stats(struct xxxid_stats *s) {
 		free(s->cmdline_comm);
 	if (s->pw_name)
 		free(s->pw_name);
+	free(s->hist);
+	free(s->hist_p);
 	arr_free_noitem(s->threads);
 
 	free(s);
 }
 
-inline struct xxxid_stats *make_stats(pid_t tid,pid_t pid) {
+inline struct xxxid_stats *make_stats(const struct collector *col,pid_t tid,pid_t pid) {
 	static const char unknown[]="<unknown>";
 	struct xxxid_stats *s;
 	struct passwd *pwd;
+	uint64_t t;
 	int prio;
 
 	if (!is_a_process(tid))
@@ -261,8 +394,11 @@ inline struct xxxid_stats *make_stats(pid_t tid,pid_t pid) {
 	if (!s)
 		return NULL;
 
-	if (nl_xxxid_info(tid,pid,s))
+	t=prof_start();
+	if (col->info(tid,pid,s))
 		s->error_x=1;
+	prof_end(PROF_COLLECT,t);
+	s->ts_smp=monotime();
 
 
 	prio=get_ioprio(tid);
@@ -272,7 +408,9 @@ inline struct xxxid_stats *make_stats(pid_t tid,pid_t pid) {
 	} else
 		s->io_prio=prio;
 
+	t=prof_start();
 	read_cmdlines(tid,&s->cmdline_long,&s->cmdline_short,&s->cmdline_comm);
+	prof_end(PROF_CMDLINE,t);
 
 	if (!s->cmdline_long)
 		s->cmdline_long=strdup(unknown);
@@ -289,32 +427,280 @@ inline struct xxxid_stats *make_stats(pid_t tid,pid_t pid) {
 	return s;
 }
 
+// --sampling: idle tasks are re-queried less often, the longer they are idle
+// the less often; see sample_skip for the exact schedule
+#define SAMPLE_IDLE_MIN 3 // cycles without I/O before a task is considered idle
+#define SAMPLE_IDLE_STEP 4 // grow the requery period by one every that many idle cycles
+#define SAMPLE_PERIOD_MAX 16 // an idle task is requeried at least every that many cycles
+#define SAMPLE_SLACK (256*1024) // block I/O that may stay unattributed to sampled tasks
+
+static struct xxxid_stats_arr *sample_ps=NULL; // previous cycle data for the current fetch_data
+
+static inline int sample_skip(struct xxxid_stats *p) {
+	unsigned long period;
+
+	if (!p||p->exited||p->error_x||p->error_i)
+		return 0;
+	if (p->idle<SAMPLE_IDLE_MIN)
+		return 0;
+	period=1+(p->idle-SAMPLE_IDLE_MIN)/SAMPLE_IDLE_STEP;
+	if (period>SAMPLE_PERIOD_MAX)
+		period=SAMPLE_PERIOD_MAX;
+	return (fetch_cur->sample_cycle+p->tid)%period!=0;
+}
+
+// reuse the data from the previous cycle instead of querying an idle task
+static inline struct xxxid_stats *clone_stats(struct xxxid_stats *p,pid_t pid) {
+	struct xxxid_stats *s=malloc(sizeof *s);
+
+	if (!s)
+		return NULL;
+	*s=*p; // WARNING - all dynamic data inside should always be initialized below
+	s->pid=pid;
+	s->threads=NULL;
+	s->hist=s->hist_p=NULL; // create_diff moves them over from p
+	s->hist_in=0;
+	s->exited=0;
+	s->stale=1;
+	s->cmdline_long=p->cmdline_long?strdup(p->cmdline_long):NULL;
+	s->cmdline_short=p->cmdline_short?strdup(p->cmdline_short):NULL;
+	s->cmdline_comm=p->cmdline_comm?strdup(p->cmdline_comm):NULL;
+	s->pw_name=p->pw_name?strdup(p->pw_name):NULL;
+	if (!s->cmdline_long||!s->cmdline_short||!s->pw_name||(p->cmdline_comm&&!s->cmdline_comm)) {
+		free_stats(s);
+		return NULL;
+	}
+	return s;
+}
+
+inline uint64_t lio_counter(const struct xxxid_stats *s,int i) {
+	switch (i) {
+		case LIO_RCHAR:
+			return s->read_char;
+		case LIO_WCHAR:
+			return s->write_char;
+		case LIO_SYSCR:
+			return s->read_syscalls;
+		case LIO_SYSCW:
+			return s->write_syscalls;
+	}
+	return 0;
+}
+
+// the delay is provided by the collector and the running kernel
+inline int delay_available(int i) {
+	if (!collector||!collector->has_delays)
+		return 0;
+	return delay_kernel(i);
+}
+
+inline int delay_kernel(int i) {
+	return nl_ts_ver>=dly_minver[i];
+}
+
+inline unsigned taskstats_version(void) {
+	return nl_ts_ver;
+}
+
+// the recorded version is used when replaying
+inline void taskstats_version_set(unsigned v) {
+	nl_ts_ver=v;
+}
+
+static inline void init_aggr(struct xxxid_stats *s) {
+	if (s->pid==s->tid) { // main process, copy own data to aggregated process data
+		int i;
+
+		s->swapin_delay_total_p=s->swapin_delay_total;
+		s->blkio_delay_total_p=s->blkio_delay_total;
+		s->read_bytes_p=s->read_bytes;
+		s->write_bytes_p=s->write_bytes;
+		s->cancelled_write_bytes_p=s->cancelled_write_bytes;
+		for (i=0;i<DLY_MAX;i++)
+			s->delay_total_p[i]=s->delay_total[i];
+		for (i=0;i<LIO_MAX;i++)
+			s->lio_p[i]=lio_counter(s,i);
+	}
+}
+
+static inline void pid_add(struct xxxid_stats_arr *a,struct xxxid_stats *s,filter_callback filter) {
+	uint64_t t=prof_start();
+	int skip=filter&&filter(s);
+
+	prof_end(PROF_FILTER,t);
+	if (skip)
+		free_stats(s);
+	else {
+		init_aggr(s);
+		arr_add(a,s);
+	}
+}
+
 static void pid_cb(pid_t pid,pid_t tid,struct xxxid_stats_arr *a,filter_callback filter) {
-	struct xxxid_stats *s=make_stats(tid,pid);
-
-	if (s) {
-		if (filter&&filter(s))
-			free_stats(s);
-		else {
-			if (s->pid==s->tid) { // main process, copy own data to aggregated process data
-				s->swapin_delay_total_p=s->swapin_delay_total;
-				s->blkio_delay_total_p=s->blkio_delay_total;
-				s->read_bytes_p=s->read_bytes;
-				s->write_bytes_p=s->write_bytes;
-			}
-			arr_add(a,s);
+	struct xxxid_stats *s=NULL;
+
+	if (sample_ps) {
+		struct xxxid_stats *p=arr_find(sample_ps,tid);
+
+		if (sample_skip(p)) {
+			s=clone_stats(p,pid);
+			if (s)
+				fetch_cur->sample_skipped++;
 		}
 	}
+	if (!s)
+		s=make_stats(fetch_cur->col,tid,pid);
+	if (s)
+		pid_add(a,s,filter);
 }
 
-inline struct xxxid_stats_arr *fetch_data(filter_callback filter) {
-	struct xxxid_stats_arr *a=arr_alloc();
+// cross check the sampled tasks against the global block I/O counters; when
+// there is more block I/O than the queried tasks account for, the skipped
+// tasks are promoted and queried in the same cycle
+static inline void sample_reconcile(struct fetch_ctx *f,struct xxxid_stats_arr *a,filter_callback filter) {
+	uint64_t pgin,pgou,vmd,tkd=0;
 	int i;
 
+	if (get_vm_counters(&pgin,&pgou))
+		return;
+	vmd=(pgin-f->sample_pgin)+(pgou-f->sample_pgou);
+	f->sample_pgin=pgin;
+	f->sample_pgou=pgou;
+	if (!f->sample_have_vm) {
+		f->sample_have_vm=1;
+		return;
+	}
+	if (!f->sample_skipped||vmd<=SAMPLE_SLACK)
+		return;
+
+	for (i=0;i<a->length;i++) {
+		struct xxxid_stats *s=a->arr[i];
+		struct xxxid_stats *p;
+
+		if (s->stale||!(p=arr_find(sample_ps,s->tid)))
+			continue;
+		if (s->read_bytes>p->read_bytes)
+			tkd+=s->read_bytes-p->read_bytes;
+		if (s->write_bytes>p->write_bytes)
+			tkd+=s->write_bytes-p->write_bytes;
+	}
+	if (vmd<=2*tkd)
+		return;
+
+	for (i=0;i<a->length;i++) {
+		struct xxxid_stats *s=a->arr[i];
+		struct xxxid_stats *n;
+
+		if (!s->stale)
+			continue;
+		n=make_stats(f->col,s->tid,s->pid);
+		if (!n)
+			continue;
+		if (filter&&filter(n)) {
+			free_stats(n);
+			continue;
+		}
+		init_aggr(n);
+		free_stats(s);
+		a->arr[i]=n; // same tid, the array stays sorted
+	}
+}
+
+// with --cgroup only the tasks of that cgroup remain, the array stays sorted
+static inline void cgroup_only(const char *cgroup,struct xxxid_stats_arr *a) {
+	int id=cgroup_find(cgroup);
+	int i,n=0;
+
+	for (i=0;i<a->length;i++)
+		if (id&&a->arr[i]->cgroup==id)
+			a->arr[n++]=a->arr[i];
+		else
+			free_stats(a->arr[i]);
+	a->length=n;
+}
+
+// the tasks of pt that are not in a any more; both are sorted by tid
+static inline void account_exits(struct xxxid_stats_arr *a,struct xxxid_stats_arr *pt) {
+	int i,j=0;
+
+	for (i=0;pt&&i<pt->length;i++) {
+		struct xxxid_stats *p=pt->arr[i];
+
+		while (j<a->length&&a->arr[j]->tid<p->tid)
+			j++;
+		if (!p->exited&&(j==a->length||a->arr[j]->tid!=p->tid))
+			hitters_exit(p);
+	}
+}
+
+struct fetch_ctx fetch_main={0}; // the one of iotop
+
+inline struct fetch_ctx *fetch_params(void) {
+	struct fetch_ctx *f=&fetch_main;
+
+	f->col=collector;
+	f->sampling=config.f.sampling;
+	f->pctl=config.f.pctl;
+	// the extra read per task is paid only when the counts are shown or stored
+	f->syscalls=config.f.logical||params.format!=E_FMT_TEXT||params.export_addr||params.record_file||params.ring_file||params.daemon_name;
+	f->offenders=config.f.offenders;
+	f->hh_key=params.hh_key;
+	f->group=params.group;
+	f->cgroup=params.cgroup;
+	f->cgroup_iostat=params.cgroup_iostat;
+	f->psi=config.f.psi;
+	return f;
+}
+
+inline void fetch_fini(struct fetch_ctx *f) {
+	if (f->group_tasks)
+		arr_free(f->group_tasks);
+	f->group_tasks=NULL;
+}
+
+inline struct xxxid_stats_arr *fetch_data(struct fetch_ctx *f,filter_callback filter,struct xxxid_stats_arr *ps) {
+	struct xxxid_stats_arr *a=arr_alloc();
+	struct xxxid_stats_arr *pt; // previous tasks
+	struct xxxid_stats_arr *g;
+	int i,j;
+
 	if (!a)
 		return NULL;
 
-	pidgen_cb(pid_cb,a,filter);
+	pt=f->group?f->group_tasks:ps;
+	if (pt&&pt->length&&pt->arr[0]->group) // group rows and tasks do not mix
+		pt=NULL;
+	if (replaying())
+		replay_fill(a,filter,pid_add);
+	else if (params.bench) {
+		uint64_t t=prof_start();
+
+		f->col->cycle();
+		synth_fill(a,filter,pid_add);
+		prof_end(PROF_PIDGEN,t);
+	} else {
+		uint64_t t;
+
+		fetch_cur=f;
+		sample_ps=f->sampling?pt:NULL;
+		f->sample_skipped=0;
+		f->sample_cycle++;
+		if (f->col->cycle)
+			f->col->cycle();
+		t=prof_start();
+		pidgen_cb(pid_cb,a,filter);
+		prof_end(PROF_PIDGEN,t);
+		if (sample_ps)
+			sample_reconcile(f,a,filter);
+		sample_ps=NULL;
+		fetch_cur=NULL;
+	}
+	if (f->group==E_GRP_CGROUP||f->cgroup||(f->offenders&&f->hh_key==E_HH_CGROUP))
+		cgroup_resolve(a,pt);
+	if (f->cgroup)
+		cgroup_only(f->cgroup,a);
+	if (f->offenders)
+		account_exits(a,pt);
 
 	for (i=0;a->arr&&i<a->length;i++) {
 		struct xxxid_stats *s=a->arr[i];
@@ -332,10 +718,145 @@ inline struct xxxid_stats_arr *fetch_data(filter_callback filter) {
 					p->blkio_delay_total_p=mymax(p->blkio_delay_total_p,s->blkio_delay_total);
 					p->read_bytes_p+=s->read_bytes;
 					p->write_bytes_p+=s->write_bytes;
+					p->cancelled_write_bytes_p+=s->cancelled_write_bytes;
+					for (j=0;j<DLY_MAX;j++)
+						p->delay_total_p[j]=mymax(p->delay_total_p[j],s->delay_total[j]);
+					for (j=0;j<LIO_MAX;j++)
+						p->lio_p[j]+=lio_counter(s,j);
 				}
 			}
 		}
 	}
-	return a;
+	if (!f->group) {
+		fetch_fini(f);
+		return a;
+	}
+
+	g=group_data(f,a,pt,ps);
+	fetch_fini(f);
+	f->group_tasks=a;
+	return g;
+}
+
+// the tasks of the data returned by fetch_data to iotop, for recording them
+inline struct xxxid_stats_arr *task_data(struct xxxid_stats_arr *cs) {
+	if (fetch_main.group&&fetch_main.group_tasks)
+		return fetch_main.group_tasks;
+	return cs;
+}
+
+// --collector-bench: query every task with each available collector, report
+// the cost per task and cross-check the counters that both of them provide
+#define BENCH_ROUNDS 5
+
+static pid_t *bench_ids=NULL; // pid,tid pairs
+static int bench_cnt=0;
+static int bench_sz=0;
+
+static void bench_cb(pid_t pid,pid_t tid,struct xxxid_stats_arr *a,filter_callback filter) {
+	(void)a;
+	(void)filter;
+
+	if (bench_cnt==bench_sz) {
+		int nsz=bench_sz?bench_sz*2:PROC_LIST_SZ_INC;
+		pid_t *n=realloc(bench_ids,nsz*2*sizeof *n);
+
+		if (!n)
+			return;
+		bench_ids=n;
+		bench_sz=nsz;
+	}
+	bench_ids[bench_cnt*2]=pid;
+	bench_ids[bench_cnt*2+1]=tid;
+	bench_cnt++;
 }
 
+static inline void bench_run(const struct collector *c) {
+	uint64_t first=0,rest=0;
+	struct xxxid_stats s;
+	int errs=0;
+	int r,i;
+
+	for (r=0;r<BENCH_ROUNDS;r++) {
+		uint64_t t=monotime_ns();
+
+		if (c->cycle)
+			c->cycle();
+		for (i=0;i<bench_cnt;i++) {
+			memset(&s,0,sizeof s);
+			if (c->info(bench_ids[i*2+1],bench_ids[i*2],&s)&&r==0)
+				errs++;
+		}
+		t=monotime_ns()-t;
+		if (r==0)
+			first=t;
+		else
+			rest+=t;
+	}
+	printf("%-8s %12.1f %12.1f %8d\n",c->name,(double)first/bench_cnt,(double)rest/(BENCH_ROUNDS-1)/bench_cnt,errs);
+}
+
+// the bare taskstats query, without the syscall counts from procio
+static const struct collector bench_nl={"netlink",nl_init,nl_fini,NULL,nl_xxxid_info,1};
+
+inline void collector_bench(void) {
+	const struct collector *nl=&bench_nl;
+	const struct collector *pi=collectors+E_COL_PROCIO;
+	int diff=0,only_nl=0,only_pi=0,both=0;
+	int have_nl=!nl->init();
+	int have_pi=!pi->init();
+	int i;
+
+	pidgen_cb(bench_cb,NULL,NULL);
+	if (!bench_cnt) {
+		fprintf(stderr,"%s: no tasks found\n",__func__);
+		exit(EXIT_FAILURE);
+	}
+
+	printf("%d tasks, %d rounds\n",bench_cnt,BENCH_ROUNDS);
+	printf("%-8s %12s %12s %8s\n","BACKEND","NS/TASK 1ST","NS/TASK","ERRORS");
+	if (have_nl)
+		bench_run(nl);
+	else
+		printf("%-8s unavailable: %s\n",nl->name,nl_err);
+	if (have_pi)
+		bench_run(pi);
+	else
+		printf("%-8s unavailable\n",pi->name);
+
+	if (have_nl&&have_pi) {
+		for (i=0;i<bench_cnt;i++) {
+			struct xxxid_stats a,b;
+			int ea,eb;
+
+			memset(&a,0,sizeof a);
+			memset(&b,0,sizeof b);
+			ea=nl->info(bench_ids[i*2+1],bench_ids[i*2],&a);
+			eb=pi->info(bench_ids[i*2+1],bench_ids[i*2],&b);
+			if (ea&&eb)
+				continue;
+			if (eb) {
+				only_nl++;
+				continue;
+			}
+			if (ea) {
+				only_pi++;
+				continue;
+			}
+			both++;
+			// tasks doing I/O right now may legitimately differ; taskstats
+			// rounds rchar, wchar, syscr and syscw down to a multiple of 1024
+			if (a.read_bytes!=b.read_bytes||a.write_bytes!=b.write_bytes||(a.read_char&~1023ULL)!=(b.read_char&~1023ULL)||(a.write_char&~1023ULL)!=(b.write_char&~1023ULL)||(a.read_syscalls&~1023ULL)!=(b.read_syscalls&~1023ULL)||(a.write_syscalls&~1023ULL)!=(b.write_syscalls&~1023ULL)||a.cancelled_write_bytes!=b.cancelled_write_bytes)
+				diff++;
+		}
+		printf("cross-check: %d tasks compared, %d differ, %d netlink only, %d procio only\n",both,diff,only_nl,only_pi);
+	}
+
+	if (have_nl)
+		nl->fini();
+	if (have_pi)
+		pi->fini();
+	free(bench_ids);
+	bench_ids=NULL;
+	bench_cnt=bench_sz=0;
+}
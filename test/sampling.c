@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+
+Copyright (C) 2014  Vyacheslav Trushkin
+Copyright (C) 2020-2026  Boian Bonev
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+*/
+
+// -P --sampling: an idle main thread is requeried after 16 cycles while its
+// worker is queried in each one; the process rates are of the last cycle
+
+#include "iotop.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAIN_TID 100
+#define WORK_TID 101
+#define MIB (1024*1024)
+
+static struct xxxid_stats *task(pid_t tid,uint64_t ts_smp,uint64_t read,uint64_t read_p) {
+	struct xxxid_stats *s=calloc(1,sizeof *s);
+
+	if (!s) {
+		perror("calloc");
+		exit(EXIT_FAILURE);
+	}
+	s->tid=tid;
+	s->pid=MAIN_TID;
+	s->ts_smp=ts_smp;
+	s->read_bytes=read;
+	s->read_bytes_p=read_p;
+	return s;
+}
+
+static int check(const char *what,double v,double want) {
+	if (fabs(v-want)<=want*1e-9)
+		return 0;
+	fprintf(stderr,"%s is %.0f, want %.0f\n",what,v,want);
+	return 1;
+}
+
+int main(void) {
+	struct xxxid_stats_arr *ps=arr_alloc();
+	struct xxxid_stats_arr *cs=arr_alloc();
+	struct fetch_ctx f={0};
+	struct xxxid_stats *m,*w;
+	int err=0;
+
+	if (!ps||!cs) {
+		perror("arr_alloc");
+		return EXIT_FAILURE;
+	}
+	config.f.processes=1;
+	f.sampling=1;
+
+	// the main thread was last queried at 1 s, the worker at 16 s
+	m=task(MAIN_TID,1000,0,20*MIB);
+	m->idle=16;
+	arr_add(ps,m);
+	arr_add(ps,task(WORK_TID,16000,20*MIB,0));
+	// at 17 s both are queried, the worker read 1 MiB in the last second
+	arr_add(cs,task(MAIN_TID,17000,0,21*MIB));
+	arr_add(cs,task(WORK_TID,17000,21*MIB,0));
+
+	create_diff(&f,cs,ps,1.0,17000,NULL,0,NULL);
+	m=arr_find(cs,MAIN_TID);
+	w=arr_find(cs,WORK_TID);
+	err|=check("worker read",w->read_val,MIB);
+	err|=check("main thread read",m->read_val,0);
+	err|=check("process read",m->read_val_p,MIB);
+
+	arr_free(cs);
+	arr_free(ps);
+	if (err)
+		return EXIT_FAILURE;
+	printf("sampling: ok\n");
+	return EXIT_SUCCESS;
+}